@@ -122,6 +122,8 @@ void help()
   printf(" scan                        :Outputs the current status of all Dynamixels\n");
   printf(" ping [ID] [ID] ...          :Outputs the current status of [ID]s \n");
   printf(" bp                          :Broadcast ping (Dynamixel Protocol 2.0 only)\n");
+  printf(" autobaud [MAX_ID]           :Finds the baudrates and protocols of all Dynamixels\n");
+  printf("                               and changes baudrate to the first one found\n");
   printf(" \n");
   printf(" ==================== Commands for Dynamixel Protocol 1.0 ====================\n");
   printf(" \n");
@@ -515,6 +517,36 @@ int main(int argc, char *argv[])
         fprintf(stderr, " Invalid parameters! \n");
       }
     }
+    else if (strcmp(cmd, "autobaud") == 0)
+    {
+      if (num_param <= 1)
+      {
+        dynamixel::BaudScanner scanner(portHandler);
+        std::vector<dynamixel::BaudScanResult> results;
+
+        if (num_param == 1)
+          scanner.setMaxID(atoi(param[0]));
+
+        int dxl_comm_result = scanner.scan(results);
+        if (dxl_comm_result != COMM_SUCCESS) printf("%s\n", packetHandler2->getTxRxResult(dxl_comm_result));
+
+        for (unsigned int i = 0; i < results.size(); i++)
+        {
+          fprintf(stderr, " [BAUD RATE: %d] Protocol %.1f :", results[i].baudrate, results[i].protocol_version);
+          for (unsigned int j = 0; j < results[i].id_list.size(); j++)
+            fprintf(stderr, " %d", results[i].id_list.at(j));
+          fprintf(stderr, "\n");
+        }
+
+        if (results.size() > 0 && portHandler->setBaudRate(results[0].baudrate) == true)
+          fprintf(stderr, " Success to change baudrate! [ BAUD RATE: %d ]\n", results[0].baudrate);
+        printf("\n");
+      }
+      else
+      {
+        fprintf(stderr, " Invalid parameters! \n");
+      }
+    }
     else if (strcmp(cmd, "wrb1") == 0 || strcmp(cmd, "w1") == 0)
     {
       if (num_param == 3)
@@ -0,0 +1,173 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// *********     Loopback Benchmark Example      *********
+//
+//
+// This example needs no Dynamixel. It runs the transactions of the SDK on the simulated Dynamixels
+// through the in-memory loopback port "loop://", which moves the bytes without the kernel or the bus,
+// and prints the transactions per second. The numbers are the floor of the time the SDK itself takes
+// to build, send and parse the packets on a core.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "dynamixel_sdk.h"                                  // Uses Dynamixel SDK library
+
+// Control table address
+#define ADDR_PRO_GOAL_POSITION          116
+#define ADDR_PRO_PRESENT_POSITION       132
+
+// Data Byte Length
+#define LEN_PRO_GOAL_POSITION           4
+#define LEN_PRO_PRESENT_POSITION        4
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_COUNT                       4                   // Simulated Dynamixel ID: 1 ~ DXL_COUNT
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define CHANNEL_NAME                    "benchmark"
+#define DEVICENAME                      "loop://" CHANNEL_NAME
+
+#define BENCHMARK_TIME                  1.0                 // sec for each transaction
+
+enum Transaction
+{
+  PING,
+  READ,
+  WRITE,
+  SYNC_READ,
+  SYNC_WRITE,
+  BULK_READ,
+  TRANSACTION_COUNT
+};
+
+static const char *transaction_name[TRANSACTION_COUNT] =
+{
+  "ping",
+  "read 4 bytes",
+  "write 4 bytes",
+  "sync read",
+  "sync write",
+  "bulk read"
+};
+
+double getTime()
+{
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return (double)tv.tv_sec + (double)tv.tv_nsec * 0.000000001;
+}
+
+int main()
+{
+  // Put the simulated Dynamixels on the bus, and let the loopback channel answer by them
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(CHANNEL_NAME);
+  for (int id = 1; id <= DXL_COUNT; id++)
+    bus->addDevice(id, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE);
+
+  dynamixel::LoopbackChannel *channel = dynamixel::LoopbackChannel::getChannel(CHANNEL_NAME);
+  if (channel->attachBus(bus) == false)
+  {
+    printf("Failed to attach the bus!\n");
+    return 0;
+  }
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(DEVICENAME);
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+
+  dynamixel::GroupSyncWrite groupSyncWrite(portHandler, packetHandler, ADDR_PRO_GOAL_POSITION, LEN_PRO_GOAL_POSITION);
+  dynamixel::GroupSyncRead groupSyncRead(portHandler, packetHandler, ADDR_PRO_PRESENT_POSITION, LEN_PRO_PRESENT_POSITION);
+  dynamixel::GroupBulkRead groupBulkRead(portHandler, packetHandler);
+
+  uint8_t dxl_error = 0;
+  uint16_t dxl_model_number;
+  uint32_t dxl_present_position;
+  uint8_t param_goal_position[LEN_PRO_GOAL_POSITION] = { 0, 0, 0, 0 };
+
+  if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+  {
+    printf("Failed to open the port!\n");
+    return 0;
+  }
+
+  for (int id = 1; id <= DXL_COUNT; id++)
+  {
+    groupSyncWrite.addParam(id, param_goal_position);
+    groupSyncRead.addParam(id);
+    groupBulkRead.addParam(id, ADDR_PRO_PRESENT_POSITION, LEN_PRO_PRESENT_POSITION);
+  }
+
+  printf("%d simulated Dynamixels on %s\n", DXL_COUNT, DEVICENAME);
+  printf("%-16s %12s %12s %8s\n", "transaction", "per sec", "usec each", "failed");
+
+  for (int transaction = 0; transaction < TRANSACTION_COUNT; transaction++)
+  {
+    int count = 0, failed = 0;
+    double start = getTime(), elapsed;
+
+    do
+    {
+      // check the time every 100 transactions not to measure clock_gettime()
+      for (int i = 0; i < 100; i++)
+      {
+        int dxl_comm_result = COMM_TX_FAIL;
+        switch (transaction)
+        {
+          case PING:
+            dxl_comm_result = packetHandler->ping(portHandler, 1, &dxl_model_number, &dxl_error);
+            break;
+          case READ:
+            dxl_comm_result = packetHandler->read4ByteTxRx(portHandler, 1, ADDR_PRO_PRESENT_POSITION, &dxl_present_position, &dxl_error);
+            break;
+          case WRITE:
+            dxl_comm_result = packetHandler->write4ByteTxRx(portHandler, 1, ADDR_PRO_GOAL_POSITION, 0, &dxl_error);
+            break;
+          case SYNC_READ:
+            dxl_comm_result = groupSyncRead.txRxPacket();
+            break;
+          case SYNC_WRITE:
+            dxl_comm_result = groupSyncWrite.txPacket();
+            break;
+          case BULK_READ:
+            dxl_comm_result = groupBulkRead.txRxPacket();
+            break;
+        }
+        count++;
+        if (dxl_comm_result != COMM_SUCCESS)
+          failed++;
+      }
+      elapsed = getTime() - start;
+    } while (elapsed < BENCHMARK_TIME);
+
+    printf("%-16s %12.0f %12.2f %8d\n", transaction_name[transaction], count / elapsed, elapsed * 1000000.0 / count, failed);
+  }
+
+  // Close port
+  portHandler->closePort();
+
+  channel->detachBus();
+  dynamixel::LoopbackChannel::removeChannel(CHANNEL_NAME);
+  dynamixel::SimulatedBus::removeBus(CHANNEL_NAME);
+
+  return 0;
+}
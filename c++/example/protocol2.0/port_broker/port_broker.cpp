@@ -0,0 +1,108 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// *********     Port Broker Example      *********
+//
+//
+// This example shares one serial bus with the other processes. It opens the port, and runs a PortBroker
+// on a Unix domain socket until Ctrl+C is pressed. The processes use the bus by the port name
+// "unix:///tmp/dynamixel.sock" in place of the device name, as "unix:///tmp/dynamixel.sock?priority=255"
+// for the control loop, whose transactions go before the ones of the diagnostics tools and loggers.
+//
+// Usage: port_broker [device name] [baudrate] [socket path]
+// The device name "sim://broker" runs the broker on a simulated bus, without any Dynamixel.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "dynamixel_sdk.h"                                  // Uses Dynamixel SDK library
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define BAUDRATE                        57600
+#define DEVICENAME                      "/dev/ttyUSB0"      // Check which port is being used on your controller
+                                                            // ex) Windows: "COM1"   Linux: "/dev/ttyUSB0" Mac: "/dev/tty.usbserial-*"
+#define SOCKET_PATH                     "/tmp/dynamixel.sock"
+
+#define SIM_PREFIX                      "sim://"
+#define SIM_DXL_COUNT                   4                   // Simulated Dynamixel ID: 1 ~ SIM_DXL_COUNT
+#define SIM_DXL_MODEL_NUMBER            1060
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+  running = 0;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *device_name = (argc > 1) ? argv[1] : DEVICENAME;
+  int         baudrate    = (argc > 2) ? atoi(argv[2]) : BAUDRATE;
+  const char *socket_path = (argc > 3) ? argv[3] : SOCKET_PATH;
+
+  // Put the simulated Dynamixels on the bus of the name after "sim://"
+  if (strncmp(device_name, SIM_PREFIX, strlen(SIM_PREFIX)) == 0)
+  {
+    dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(device_name + strlen(SIM_PREFIX));
+    for (int id = 1; id <= SIM_DXL_COUNT; id++)
+      bus->addDevice(id, PROTOCOL_VERSION, SIM_DXL_MODEL_NUMBER, baudrate);
+  }
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(device_name);
+
+  if (portHandler->openPort() == false || portHandler->setBaudRate(baudrate) == false)
+  {
+    printf("Failed to open the port!\n");
+    return 0;
+  }
+
+  dynamixel::PortBroker broker(portHandler, socket_path);
+  if (broker.start() == false)
+  {
+    printf("Failed to start the broker!\n");
+    portHandler->closePort();
+    return 0;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  printf("Sharing %s at %d bps on unix://%s (Ctrl+C to quit)\n", device_name, baudrate, socket_path);
+
+  while (running)
+  {
+    sleep(1);
+
+    dynamixel::PortBrokerStats stats = broker.getStats();
+    printf("[clients:%d] holds:%llu writes:%llu expired holds:%llu longest wait:%.2f msec\n",
+           stats.clients, (unsigned long long)stats.holds, (unsigned long long)stats.writes,
+           (unsigned long long)stats.expired_holds, (double)stats.max_queue_ns / 1000000.0);
+  }
+
+  broker.stop();
+
+  // Close port
+  portHandler->closePort();
+
+  return 0;
+}
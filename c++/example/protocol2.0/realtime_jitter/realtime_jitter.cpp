@@ -0,0 +1,62 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// *********     Realtime Jitter Example      *********
+//
+//
+// This example needs no Dynamixel. It measures how late a 1 kHz control loop wakes up,
+// applies the real-time profile to the thread, and measures it again.
+// Without privileges (CAP_SYS_NICE, RLIMIT_RTPRIO and RLIMIT_MEMLOCK) some steps are not applied,
+// and the report tells which and why.
+// Usage: realtime_jitter [cpu]
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "dynamixel_sdk.h"                                  // Uses Dynamixel SDK library
+
+// Default setting
+#define LOOP_PERIOD                     1000000             // nsec: 1 kHz
+#define LOOP_COUNT                      5000
+
+void printJitter(const char *title, dynamixel::JitterStats stats)
+{
+  printf("%-18s min %8.1f  mean %8.1f  p99 %8.1f  max %8.1f usec\n", title,
+         stats.min_ns / 1000.0, stats.mean_ns / 1000.0, stats.p99_ns / 1000.0, stats.max_ns / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+  dynamixel::RealtimeProfile profile;
+  char report[512];
+
+  if (argc > 1)
+    profile.setCpu(atoi(argv[1]));
+
+  printf("%d periods of %d usec\n", LOOP_COUNT, LOOP_PERIOD / 1000);
+  printJitter("default thread", dynamixel::RealtimeProfile::measureJitter(LOOP_PERIOD, LOOP_COUNT));
+
+  if (profile.apply() == false)
+    printf("Some steps of the real-time profile were not applied.\n");
+  profile.getReport(report, sizeof(report));
+  printf("%s", report);
+
+  printJitter("real-time profile", dynamixel::RealtimeProfile::measureJitter(LOOP_PERIOD, LOOP_COUNT));
+
+  return 0;
+}
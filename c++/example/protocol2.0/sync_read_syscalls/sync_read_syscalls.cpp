@@ -0,0 +1,118 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// *********     Sync Read Syscalls Example      *********
+//
+//
+// This example needs no Dynamixel. It serves 20 simulated Dynamixels on a pseudo-terminal,
+// reads their present position by GroupSyncRead through the serial port handler,
+// and prints the system calls which each sync read takes, from PortHandler::getIoStats().
+// The receive buffer of PortHandlerLinux drains what the kernel has in one read(),
+// where the status packets were read by a header probe and the rest of each packet before:
+// at least 2 read() and 1 ioctl(FIONREAD) a Dynamixel.
+// It runs on Linux only.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "dynamixel_sdk.h"                                  // Uses Dynamixel SDK library
+
+// Control table address
+#define ADDR_PRO_PRESENT_POSITION       132
+
+// Data Byte Length
+#define LEN_PRO_PRESENT_POSITION        4
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_COUNT                       20                  // Simulated Dynamixel ID: 1 ~ DXL_COUNT
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define BUS_NAME                        "sync_read_syscalls"
+
+#define TRANSACTION_COUNT               1000
+
+double getTime()
+{
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return (double)tv.tv_sec + (double)tv.tv_nsec * 0.000000001;
+}
+
+int main()
+{
+#if defined(__linux__)
+  char pty_name[100];
+
+  // Serve the simulated Dynamixels on a pseudo-terminal, answering at once
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  for (int id = 1; id <= DXL_COUNT; id++)
+    bus->addDevice(id, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE)->setReturnDelayTime(0);
+  if (bus->openPty(pty_name, sizeof(pty_name)) == false)
+  {
+    printf("Failed to open the pseudo-terminal!\n");
+    return 0;
+  }
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(pty_name);
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+
+  dynamixel::GroupSyncRead groupSyncRead(portHandler, packetHandler, ADDR_PRO_PRESENT_POSITION, LEN_PRO_PRESENT_POSITION);
+
+  if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+  {
+    printf("Failed to open the port!\n");
+    return 0;
+  }
+
+  for (int id = 1; id <= DXL_COUNT; id++)
+    groupSyncRead.addParam(id);
+
+  int failed = 0;
+  portHandler->resetIoStats();
+  double start = getTime();
+  for (int i = 0; i < TRANSACTION_COUNT; i++)
+  {
+    if (groupSyncRead.txRxPacket() != COMM_SUCCESS)
+      failed++;
+  }
+  double elapsed = getTime() - start;
+  dynamixel::PortIoStats io = portHandler->getIoStats();
+
+  printf("%d sync reads of %d Dynamixels on %s, %d failed, %.0f usec each\n",
+         TRANSACTION_COUNT, DXL_COUNT, pty_name, failed, elapsed * 1000000.0 / TRANSACTION_COUNT);
+  printf("each sync read: %.2f read() (%.2f of them empty), %.2f write(), %.2f ioctl(), %.0f bytes in\n",
+         (double)io.reads / TRANSACTION_COUNT, (double)io.zero_reads / TRANSACTION_COUNT,
+         (double)io.writes / TRANSACTION_COUNT, (double)io.ioctls / TRANSACTION_COUNT,
+         (double)io.bytes_in / TRANSACTION_COUNT);
+  printf("without the receive buffer: at least %d read() and %d ioctl()\n", 2 * DXL_COUNT, DXL_COUNT);
+
+  // Close port
+  portHandler->closePort();
+  delete portHandler;
+
+  bus->closeServer();
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+#else
+  printf("This example runs on Linux only.\n");
+#endif
+  return 0;
+}
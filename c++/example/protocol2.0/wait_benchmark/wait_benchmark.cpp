@@ -0,0 +1,140 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// *********     Wait Benchmark Example      *********
+//
+//
+// This example needs no Dynamixel. It reads a simulated Dynamixel through a pseudo-terminal,
+// which the serial port handler of Linux opens as a USB serial, and compares how the port waits
+// for the status packets: blocked in ppoll() (PortHandler::WAIT_BLOCK_), spinning on the port
+// as the packet handlers did before waitPort() (PortHandler::WAIT_SPIN_), and both (PortHandler::WAIT_HYBRID_).
+// It prints the processor time each transaction takes, and the wall time, whose difference to the spin
+// is the latency added by waking up from ppoll().
+// The device is served by a thread of this process, which the spin lets run by yielding the processor
+// at each pass, so that the spin and the hybrid do not hold it back on a single processor.
+// It runs on Linux only.
+// Usage: wait_benchmark [return delay time in usec]
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+
+#include "dynamixel_sdk.h"                                  // Uses Dynamixel SDK library
+
+// Control table address
+#define ADDR_PRO_PRESENT_POSITION       132
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_ID                          1
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define BUS_NAME                        "wait_benchmark"
+
+#define RETURN_DELAY_TIME               500                 // usec
+#define TRANSACTION_COUNT               2000
+
+double getTime(clockid_t clock)
+{
+  struct timespec tv;
+  clock_gettime(clock, &tv);
+  return (double)tv.tv_sec + (double)tv.tv_nsec * 0.000000001;
+}
+
+int main(int argc, char *argv[])
+{
+#if defined(__linux__)
+  int  return_delay_time = (argc > 1) ? atoi(argv[1]) : RETURN_DELAY_TIME;
+  char pty_name[100];
+
+  // Serve a simulated Dynamixel on a pseudo-terminal
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  bus->addDevice(DXL_ID, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE)->setReturnDelayTime((uint8_t)(return_delay_time / 2));
+  if (bus->openPty(pty_name, sizeof(pty_name)) == false)
+  {
+    printf("Failed to open the pseudo-terminal!\n");
+    return 0;
+  }
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(pty_name);
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+
+  uint8_t dxl_error = 0;
+  uint32_t dxl_present_position;
+  double *wall_time = (double *)malloc(TRANSACTION_COUNT * sizeof(double));
+
+  if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+  {
+    printf("Failed to open the port!\n");
+    return 0;
+  }
+
+  const int   strategy[3]       = { dynamixel::PortHandler::WAIT_SPIN_, dynamixel::PortHandler::WAIT_BLOCK_, dynamixel::PortHandler::WAIT_HYBRID_ };
+  const char *strategy_name[3]  = { "spin", "block (ppoll)", "hybrid" };
+  double      spin_mean = 0.0;
+
+  printf("%d read4ByteTxRx on %s, return delay time %d usec\n", TRANSACTION_COUNT, pty_name, return_delay_time);
+  printf("%-14s %10s %10s %10s %12s %8s\n", "wait", "cpu usec", "wall usec", "p99 usec", "wake usec", "failed");
+
+  for (int s = 0; s < 3; s++)
+  {
+    int failed = 0;
+
+    portHandler->setWaitStrategy(strategy[s]);
+    portHandler->resetIoStats();
+
+    // the processor time of this thread alone, without the thread which serves the pseudo-terminal as the device
+    double cpu_start = getTime(CLOCK_THREAD_CPUTIME_ID);
+    for (int i = 0; i < TRANSACTION_COUNT; i++)
+    {
+      double start = getTime(CLOCK_MONOTONIC);
+      if (packetHandler->read4ByteTxRx(portHandler, DXL_ID, ADDR_PRO_PRESENT_POSITION, &dxl_present_position, &dxl_error) != COMM_SUCCESS)
+        failed++;
+      wall_time[i] = getTime(CLOCK_MONOTONIC) - start;
+    }
+    double cpu = getTime(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+
+    double wall = 0.0;
+    for (int i = 0; i < TRANSACTION_COUNT; i++)
+      wall += wall_time[i];
+    wall /= TRANSACTION_COUNT;
+    std::sort(wall_time, wall_time + TRANSACTION_COUNT);
+    if (strategy[s] == dynamixel::PortHandler::WAIT_SPIN_)
+      spin_mean = wall;
+
+    printf("%-14s %10.1f %10.1f %10.1f %12.1f %8d\n", strategy_name[s],
+           cpu * 1000000.0 / TRANSACTION_COUNT, wall * 1000000.0, wall_time[TRANSACTION_COUNT * 99 / 100] * 1000000.0,
+           (wall - spin_mean) * 1000000.0, failed);
+  }
+
+  // Close port
+  portHandler->closePort();
+  delete portHandler;
+  free(wall_time);
+
+  bus->closeServer();
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+#else
+  printf("This example runs on Linux only.\n");
+#endif
+
+  return 0;
+}
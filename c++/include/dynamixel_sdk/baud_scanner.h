@@ -0,0 +1,133 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for finding the baudrates and the protocols of the Dynamixels on a bus
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_BAUDSCANNER_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_BAUDSCANNER_H_
+
+
+#include <vector>
+#include "port_handler.h"
+#include "packet_handler.h"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the Dynamixels found by BaudScanner::scan() with a baudrate and a protocol
+////////////////////////////////////////////////////////////////////////////////
+struct BaudScanResult
+{
+  int       baudrate;             ///< baudrate
+  float     protocol_version;     ///< protocol version (1.0 or 2.0)
+  std::vector<uint8_t> id_list;   ///< IDs which answered, in ascending order
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for finding the baudrates and the protocols of the Dynamixels on a bus
+/// @description BaudScanner::scan() changes the baudrate of the port in place to each candidate baudrate, and pings the bus:
+/// @description by a broadcast ping in Protocol 2.0, and by the pings to all IDs sent one after another without waiting
+/// @description for the status packets in Protocol 1.0, which has no broadcast ping.
+/// @description The time given to each baudrate comes from the time the packets take on the wire at the baudrate,
+/// @description and the return delay time of the Dynamixels, instead of the packet timeout of a single transaction.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC BaudScanner
+{
+ public:
+  static const int DEFAULT_RETURN_DELAY_ = 500;   ///< Return delay time assumed for each Dynamixel in usec
+
+ private:
+  PortHandler    *port_;
+  PacketHandler  *packet_handler_;   // Protocol 2.0, which the broadcast ping is sent by
+
+  std::vector<int> baudrates_;
+  bool      protocol1_;
+  bool      protocol2_;
+  uint8_t   max_id_;
+  int       return_delay_us_;
+  bool      stop_at_first_;
+
+  int64_t   getWireNs(int length);
+  void      scanProtocol1(std::vector<uint8_t> &id_list);
+  void      scanProtocol2(std::vector<uint8_t> &id_list);
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes the scanner of the port
+  /// @description The scanner tries the baudrates of Dynamixel, from the most common one,
+  /// @description with both protocols and the IDs up to 252.
+  /// @param port PortHandler instance
+  ////////////////////////////////////////////////////////////////////////////////
+  BaudScanner(PortHandler *port);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the baudrates tried, in the order they are tried
+  /// @param baudrates Baudrates
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setBaudRates(const std::vector<int> &baudrates) { baudrates_ = baudrates; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the baudrates tried
+  ////////////////////////////////////////////////////////////////////////////////
+  std::vector<int> getBaudRates() { return baudrates_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the protocols tried at each baudrate
+  /// @param protocol1 Whether Protocol 1.0 is tried
+  /// @param protocol2 Whether Protocol 2.0 is tried
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setProtocols(bool protocol1, bool protocol2);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the largest ID expected on the bus
+  /// @description A smaller ID shortens the time for each baudrate, since fewer Dynamixels can answer.
+  /// @param max_id Largest ID, up to 252
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setMaxID(uint8_t max_id);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the return delay time assumed for each Dynamixel
+  /// @description The default is 500 usec, which is the default return delay time of most Dynamixels.
+  /// @param usec Return delay time in usec
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setReturnDelay(int usec) { return_delay_us_ = usec; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets whether the scan stops at the first baudrate where Dynamixels answer
+  /// @param enable Whether the scan stops
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setStopAtFirst(bool enable) { stop_at_first_ = enable; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that finds the Dynamixels on the bus
+  /// @description The function holds the port during the scan, and sets the baudrate of the port back when it ends.
+  /// @param results Baudrates, protocols and IDs found, in the order they were tried
+  /// @return COMM_PORT_BUSY
+  /// @return   when the port is held by another thread
+  /// @return COMM_RX_TIMEOUT
+  /// @return   when no Dynamixel answered
+  /// @return or COMM_SUCCESS
+  ////////////////////////////////////////////////////////////////////////////////
+  int       scan(std::vector<BaudScanResult> &results);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_BAUDSCANNER_H_ */
@@ -50,23 +50,233 @@
 namespace dynamixel
 {
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for a segment of bytes written by PortHandler::writePortV()
+////////////////////////////////////////////////////////////////////////////////
+struct PortSegment
+{
+  uint8_t *data;    ///< bytes of the segment
+  int      length;  ///< length of the segment
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the contention statistics of the lock of a port
+////////////////////////////////////////////////////////////////////////////////
+struct PortLockStats
+{
+  uint64_t acquisitions;      ///< times the port was taken
+  uint64_t contentions;       ///< times the port was taken after waiting for another thread
+  uint64_t busy_rejections;   ///< times the port was refused, at once or after the lock timeout
+  int64_t  total_wait_ns;     ///< time spent waiting for the port by the acquisitions
+  int64_t  max_wait_ns;       ///< longest wait of an acquisition
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the bytes left in the port before the instruction packets, by the stale byte policy
+////////////////////////////////////////////////////////////////////////////////
+struct StaleStats
+{
+  uint64_t flushes;           ///< times the port was flushed before an instruction packet
+  uint64_t drains;            ///< times the bytes left in the port were parsed before an instruction packet
+  uint64_t stale_packets;     ///< status packets received after the transaction which waited for them
+  uint64_t late_packets;      ///< stale packets from the ID whose status packet the last transaction waited for
+  uint64_t stale_bytes;       ///< bytes received out of a valid status packet, such as noise or a corrupt packet
+  uint8_t  last_stale_id;     ///< ID of the last stale packet
+};
+
+#define WAIT_HISTOGRAM_SIZE   16
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the waits of PortHandler::waitPort() by a wait strategy
+/// @description The time of a wait is from the call of PortHandler::waitPort() until it returns with bytes to read.
+////////////////////////////////////////////////////////////////////////////////
+struct PortWaitStats
+{
+  uint64_t waits;             ///< calls of PortHandler::waitPort()
+  uint64_t wakeups;           ///< waits ended by bytes to read
+  uint64_t spin_wakeups;      ///< wakeups found by spinning, without sleeping
+  uint64_t timeouts;          ///< waits ended by the packet timeout
+  int64_t  max_wait_ns;       ///< longest wait ended by bytes to read
+  int64_t  max_overshoot_ns;  ///< latest return after the packet timeout
+  uint64_t histogram[WAIT_HISTOGRAM_SIZE];  ///< wakeups by time of the wait: [0] under 1 usec, [i] under 2^i usec, and the last one longer
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the system calls of a port and the bytes through them
+/// @description The counters are always on, and each is a relaxed atomic increment, so that they cost nothing to read
+/// @description in the hot path. The port handlers count the calls they make; PortHandlerLinux counts all of them.
+////////////////////////////////////////////////////////////////////////////////
+struct PortIoStats
+{
+  uint64_t bytes_in;          ///< bytes read from the device
+  uint64_t bytes_out;         ///< bytes written to the device
+  uint64_t reads;             ///< read system calls
+  uint64_t writes;            ///< write and writev system calls
+  uint64_t zero_reads;        ///< read system calls which returned no byte
+  uint64_t ioctls;            ///< ioctl system calls, as FIONREAD and TIOCOUTQ
+  uint64_t flushes;           ///< tcflush calls
+  uint64_t timeouts;          ///< waits of PortHandler::waitPort() ended by the packet timeout
+  uint64_t blocked_ns;        ///< time slept in the kernel for bytes to arrive
+  uint64_t spin_ns;           ///< time spun for bytes to arrive, without sleeping
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the latency of the status packets measured on a port, or for an ID
+/// @description The latency is the time from the instruction packet written until its status packet is received,
+/// @description less the time both packets take on the wire.
+////////////////////////////////////////////////////////////////////////////////
+struct LatencyEstimate
+{
+  int      samples;           ///< status packets measured
+  int      timeouts;          ///< status packets not received before the timeout
+  int      backoff;           ///< times the timeout is doubled, by the timeouts since the last status packet
+  int64_t  mean_ns;           ///< moving average of the latency, weighted 1/8 to each sample
+  int64_t  deviation_ns;      ///< moving average of the deviation from mean_ns, weighted 1/4 to each sample
+  int64_t  peak_ns;           ///< highest latency, decaying toward mean_ns by 1/16 at each sample
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the time which a port and its packet timeouts run on
+/// @description PortHandler::setClock() replaces the monotonic clock of the system, for example by VirtualClock
+/// @description for the ports whose bytes are simulated, so that their timeouts pass without waiting for them.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortClock
+{
+ public:
+  virtual ~PortClock() { }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the current time in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual int64_t getMonotonicNs() = 0;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until time_ns
+  /// @param time_ns Time on PortClock::getMonotonicNs() time base
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    sleepUntil(int64_t time_ns) = 0;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief The class for port control that inherits PortHandlerLinux, PortHandlerWindows, PortHandlerMac, or PortHandlerArduino
 ////////////////////////////////////////////////////////////////////////////////
 class WINDECLSPEC PortHandler
 {
+ protected:
+  int64_t packet_deadline_ns_;  ///< absolute packet deadline on the getMonotonicNs() time base
+  int     peek_length_;         ///< length returned by the last peekPort() until consumePort(): waitPort() waits for more bytes than these
+
+ private:
+  int           lock_state_;    // 0: free, 1: taken, 2: taken and waited for
+  uintptr_t     lock_owner_;    // thread which took the port, loaded and stored atomically
+  int           lock_depth_;    // times the owner took the port
+  bool          packet_hold_;   // the port is held from txPacket() until the status packet is received
+  double        lock_timeout_;
+  PortLockStats lock_stats_;
+
+  LatencyEstimate *latency_;    // the IDs, and the port at LATENCY_PORT_
+  int64_t       latency_margin_ns_;
+  int64_t       latency_floor_ns_;
+  bool          status_pending_;
+  uint8_t       status_id_;
+  int64_t       status_start_ns_;
+  int64_t       status_wire_ns_;
+
+  int           stale_policy_;
+  bool          stale_corrupt_; // bytes out of a status packet were received since the last flush
+  StaleStats    stale_stats_;
+
+  PortClock    *clock_;         // 0: the monotonic clock of the system
+
+  int           wait_strategy_;
+  int64_t       wait_spin_ns_;
+  PortWaitStats wait_stats_[3]; // by wait strategy
+
+  bool    lockPortUntil(int64_t deadline_ns);
+  int64_t getAdaptiveTimeout(uint8_t id);
+
+ protected:
+  PortIoStats   io_stats_;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that adds to a counter of PortHandler::io_stats_ by a relaxed atomic increment
+  /// @param counter Counter in io_stats_
+  /// @param amount Amount to add
+  ////////////////////////////////////////////////////////////////////////////////
+  void    countIo(uint64_t *counter, uint64_t amount = 1);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that spins until bytes are able to be read, or until_ns
+  /// @description The port handlers call it in waitPort() by the wait strategy, before they sleep.
+  /// @description The bytes already returned by peekPort() do not count.
+  /// @param until_ns Time on getMonotonicNs() time base
+  /// @return false
+  /// @return   when until_ns is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    spinPort(int64_t until_ns);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether the value of an option is true, as "1", "true" or "on"
+  ////////////////////////////////////////////////////////////////////////////////
+  static bool isOptionTrue(const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that adds a wait of waitPort() to the statistics of the wait strategy
+  /// @param start_ns Time the wait started on getMonotonicNs() time base
+  /// @param received Whether the wait ended by bytes to read, or false by the packet timeout
+  /// @param spun Whether the bytes were found by spinning
+  ////////////////////////////////////////////////////////////////////////////////
+  void    addWaitSample(int64_t start_ns, bool received, bool spun);
+
  public:
   static const int DEFAULT_BAUDRATE_ = 57600; ///< Default Baudrate
+  static const int LATENCY_PORT_ = 255;       ///< Index of the latency of the port in PortHandler::getLatencyEstimate()
+
+  static const int STALE_FLUSH_     = 0;      ///< Stale byte policy: flush the port before each instruction packet
+  static const int STALE_DRAIN_     = 1;      ///< Stale byte policy: parse the bytes left in the port, and never flush it
+  static const int STALE_ADAPTIVE_  = 2;      ///< Stale byte policy: parse the bytes left, and flush after a corrupt packet
+
+  static const int WAIT_BLOCK_      = 0;      ///< Wait strategy: sleep until bytes arrive
+  static const int WAIT_SPIN_       = 1;      ///< Wait strategy: spin until bytes arrive, without sleeping
+  static const int WAIT_HYBRID_     = 2;      ///< Wait strategy: spin for a while, and then sleep
+  static const int WAIT_SPIN_USEC_  = 20;     ///< Default time to spin by WAIT_HYBRID_, below the wake-up latency of the sleep
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The type of the function which creates the port handler of a scheme
+  /// @description The function is given the port name without the query string, with its scheme.
+  ////////////////////////////////////////////////////////////////////////////////
+  typedef PortHandler *(*PortFactory)(const char *port_name);
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that gets PortHandler class inheritance
   /// @description The function gets class inheritance (PortHandlerLinux / PortHandlerWindows / PortHandlerMac / PortHandlerArduino.
+  /// @description The port name is a device name, such as "/dev/ttyUSB0" or "COM3", or a URI of a registered scheme,
+  /// @description such as "tty:///dev/ttyUSB0", "tcp://host:port", "sim://bus", "loop://channel", "replay:///path/capture", "unix:///path/socket" or "uring:///dev/ttyUSB0".
+  /// @description A device name, or a URI of an unknown scheme, is given to the serial port of the platform.
+  /// @description A query string after '?' sets the options of the port by PortHandler::setOptions() before it is opened,
+  /// @description for example "/dev/ttyUSB0?baud=1000000&latency=1&wait=spin".
+  /// @param port_name Port name
   ////////////////////////////////////////////////////////////////////////////////
   static PortHandler *getPortHandler(const char *port_name);
 
-  bool   is_using_; ///< shows whether the port is in use
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that registers the port handler of a URI scheme for PortHandler::getPortHandler()
+  /// @description A scheme registered again replaces the factory registered before, including the schemes of the SDK.
+  /// @description Register the schemes before the ports are created by other threads.
+  /// @param scheme Scheme without "://", such as "tcp"
+  /// @param factory Function which creates the port handler
+  /// @return false
+  /// @return   when too many schemes are registered, or the scheme is too long
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  static bool registerPortHandler(const char *scheme, PortFactory factory);
+
+  bool   is_using_; ///< shows whether the port is in use, stored atomically for compatibility: PortHandler::isPortLocked() reads the lock itself
 
-  virtual ~PortHandler() { }
+  PortHandler();
+
+  virtual ~PortHandler();
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that opens the port
@@ -111,6 +321,28 @@ class WINDECLSPEC PortHandler
   ////////////////////////////////////////////////////////////////////////////////
   virtual bool    setBaudRate(const int baudrate) = 0;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description All ports take "wait" (block, spin or hybrid), "spin_us", "stale" (flush, drain or adaptive)
+  /// @description and "lock_timeout" in msec. The port handlers add their own, such as "baud", which sets the baudrate
+  /// @description used by the next openPort() when the port is not opened yet.
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual bool    setOption(const char *key, const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the options of the port from a query string
+  /// @param options Options in the form "key=value&key=value"
+  /// @return false
+  /// @return   when an option could not be set, which is printed and skipped
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOptions(const char *options);
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that returns current baudrate set into the port handler
   /// @description The function returns current baudrate set into the port handler.
@@ -150,6 +382,52 @@ class WINDECLSPEC PortHandler
   ////////////////////////////////////////////////////////////////////////////////
   virtual int     writePort(uint8_t *packet, int length) = 0;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes on the port buffer as a single packet
+  /// @description The function writes the segments in order,
+  /// @description and returns a number of bytes which are successfully written.
+  /// @description The default implementation gathers the segments into one buffer and calls PortHandler::writePort().
+  /// @param segments Segments which would be written on the port buffer
+  /// @param count Number of the segments
+  /// @return -1
+  /// @return   when error was occurred
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual int     writePortV(PortSegment *segments, int count);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function blocks the caller until the port buffer has bytes to read
+  /// @description or the packet timeout set by setPacketTimeout() is passed.
+  /// @description The packet handlers call it whenever the status packet is not complete yet,
+  /// @description so the port does not need to be polled by readPort() in a busy loop.
+  /// @description The default implementation returns immediately.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual bool    waitPort() { return true; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function points data to the bytes which are received but not read yet,
+  /// @description and returns the number. The bytes are kept in the port buffer until PortHandler::consumePort() is called.
+  /// @description Once the caller has seen all of them, as when it peeks again after waitPort(), the bytes received since are added.
+  /// @description The packet handlers parse status packets in place with it.
+  /// @description The default implementation has no receive buffer: it points data to 0 and returns 0,
+  /// @description and the packet handlers read the port by readPort() instead.
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual int     peekPort(uint8_t **data) { *data = 0; return 0; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandler::peekPort() from the port buffer
+  /// @description The bytes left are returned by the next peekPort() without reading the device again.
+  /// @param length Length of the bytes to remove
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    consumePort(int length) { }
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that sets and starts stopwatch for watching packet timeout
   /// @description The function sets the stopwatch by getting current time and the time of packet timeout with packet_length.
@@ -169,6 +447,363 @@ class WINDECLSPEC PortHandler
   /// @description The function checks whether current time is passed by the time of packet timeout from the time set by PortHandlerLinux::setPacketTimeout().
   ////////////////////////////////////////////////////////////////////////////////
   virtual bool    isPacketTimeout() = 0;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the current time of the clock used for packet timeout
+  /// @description The function returns monotonic time in nanoseconds (CLOCK_MONOTONIC in Linux).
+  /// @description It is not affected by system time changes, and can be shared with the control loop
+  /// @description to budget each cycle on the same time base as setPacketDeadline().
+  /// @return Current time in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual int64_t getMonotonicNs();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until time_ns on the clock of the port
+  /// @param time_ns Time on getMonotonicNs() time base
+  ////////////////////////////////////////////////////////////////////////////////
+  void    sleepUntil(int64_t time_ns);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the clock which the port and its packet timeouts run on
+  /// @description The clock is used by getMonotonicNs(), and so by the packet timeouts, the latency and wait statistics,
+  /// @description PortWorker and BaudScanner. The port handlers which wait for a device, such as PortHandlerLinux,
+  /// @description still wait for it in real time, so that a VirtualClock is only for PortHandlerSim.
+  /// @description The waits for the port held by another thread are always in real time.
+  /// @param clock Clock, which outlives the port, or 0 for the monotonic clock of the system
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setClock(PortClock *clock) { clock_ = clock; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the clock set by PortHandler::setClock(), or 0 for the clock of the system
+  ////////////////////////////////////////////////////////////////////////////////
+  PortClock *getClock() { return clock_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets absolute deadline for watching packet timeout
+  /// @description The function sets the time on getMonotonicNs() time base when the packet timeout is occurred.
+  /// @description The default implementation also starts the stopwatch of setPacketTimeout(double msec) with the time left.
+  /// @param deadline_ns Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    setPacketDeadline(int64_t deadline_ns);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns absolute deadline for watching packet timeout
+  /// @return Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual int64_t getPacketDeadline();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the time left until the packet timeout
+  /// @return Time left in nanoseconds, which is negative when the packet timeout is passed
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual int64_t getRemainingNs();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns when the bytes written so far are out on the wire
+  /// @description The packet timeouts start at that time, so that the time the instruction packet is still sent
+  /// @description is not taken from the time given to the status packet.
+  /// @return Time on getMonotonicNs() time base, which is not before the current time,
+  /// @return or 0 when the port does not know it
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual int64_t getTransmitEndNs() { return 0; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets whether the timeout of a status packet comes from the latency measured
+  /// @description The packet handlers measure the latency of each status packet they wait for, for the port and for each ID.
+  /// @description When it is enabled and 8 status packets are measured, the timeout is the time both packets take
+  /// @description on the wire, and the higher of mean + 4 * deviation and the decaying peak of the latency, plus margin_msec,
+  /// @description but not less than floor_msec. The latency of the ID is used, or that of the port until the ID has enough samples.
+  /// @description After each timeout the timeout of the ID doubles, and after 3 in a row the usual packet timeout of
+  /// @description PortHandler::setPacketTimeout(uint16_t packet_length) is used until a status packet is received.
+  /// @param enable Whether the adaptive timeout is used
+  /// @param margin_msec Time added to the latency
+  /// @param floor_msec Least timeout
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    setAdaptiveTimeout(bool enable, double margin_msec = 0.2, double floor_msec = 0.5);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether the adaptive timeout is used
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isAdaptiveTimeout() { return (latency_ != 0); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the latency measured for an ID or the port
+  /// @param index Dynamixel ID, or PortHandler::LATENCY_PORT_ for the port
+  /// @return Latency, all zero when the adaptive timeout is not used
+  ////////////////////////////////////////////////////////////////////////////////
+  LatencyEstimate getLatencyEstimate(int index);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the latency measured, as when the baudrate or the return delay time is changed
+  ////////////////////////////////////////////////////////////////////////////////
+  void    resetLatencyEstimates();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that starts the timeout of the status packet of an instruction packet just written
+  /// @description The function is called by the packet handlers instead of PortHandler::setPacketTimeout(uint16_t packet_length),
+  /// @description which it calls itself while the adaptive timeout is not used or has too few samples.
+  /// @param id ID of the instruction packet
+  /// @param instruction_length Length of the instruction packet
+  /// @param status_length Length of the status packet expected
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setStatusTimeout(uint8_t id, uint16_t instruction_length, uint16_t status_length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that ends the timeout started by PortHandler::setStatusTimeout()
+  /// @description The function adds the latency of the status packet received to the estimates,
+  /// @description or doubles the timeout of the ID when the status packet was not received.
+  /// @param id ID of the instruction packet
+  /// @param received Whether the status packet was received, or false when it timed out
+  ////////////////////////////////////////////////////////////////////////////////
+  void    updateStatusLatency(uint8_t id, bool received);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets what the packet handlers do with the bytes left in the port before an instruction packet
+  /// @description PortHandler::STALE_FLUSH_, the default, clears the port by PortHandler::clearPort() before each one.
+  /// @description PortHandler::STALE_DRAIN_ reads the bytes left instead, and counts the late status packets among them
+  /// @description in PortHandler::getStaleStats(), without the system call of the flush.
+  /// @description PortHandler::STALE_ADAPTIVE_ does the same, but flushes the port once after bytes out of a status packet,
+  /// @description such as a corrupt packet, were received.
+  /// @param policy Stale byte policy
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    setStalePolicy(int policy);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the stale byte policy
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getStalePolicy() { return stale_policy_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that prepares the port for an instruction packet by the stale byte policy
+  /// @description The function is called by the packet handlers before an instruction packet is written.
+  /// @return true
+  /// @return   when the port is flushed
+  /// @return or false when the packet handler reads the bytes left in the port
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    flushStale();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that counts a status packet received after its transaction
+  /// @param id ID of the status packet
+  ////////////////////////////////////////////////////////////////////////////////
+  void    addStalePacket(uint8_t id);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that counts bytes received out of a valid status packet
+  /// @description The next PortHandler::flushStale() flushes the port by PortHandler::STALE_ADAPTIVE_.
+  /// @param length Number of bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  void    addStaleBytes(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the statistics of the bytes left in the port
+  ////////////////////////////////////////////////////////////////////////////////
+  StaleStats getStaleStats() { return stale_stats_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the statistics of the bytes left in the port
+  ////////////////////////////////////////////////////////////////////////////////
+  void    resetStaleStats();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets how waitPort() waits for the status packets
+  /// @description PortHandler::WAIT_BLOCK_, the default, sleeps until bytes arrive, and leaves the processor to other threads.
+  /// @description PortHandler::WAIT_SPIN_ polls the port without sleeping, for the least latency on a processor of its own.
+  /// @description PortHandler::WAIT_HYBRID_ polls for spin_usec, and then sleeps, for the status packets which come quickly.
+  /// @description spin_usec is to be shorter than the wake-up latency of the sleep, some tens of usec:
+  /// @description the status packets which come later wait for the wake-up anyway, after the spin.
+  /// @description The strategy applies to the serial ports of Linux and the TCP ports. Set it while the port is held,
+  /// @description or use PortWaitScope for a single transaction.
+  /// @param strategy Wait strategy
+  /// @param spin_usec Time to spin by PortHandler::WAIT_HYBRID_ in usec
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    setWaitStrategy(int strategy, double spin_usec = WAIT_SPIN_USEC_);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the wait strategy
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getWaitStrategy() { return wait_strategy_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the time to spin by PortHandler::WAIT_HYBRID_ in usec
+  ////////////////////////////////////////////////////////////////////////////////
+  double  getWaitSpinTime() { return (double)wait_spin_ns_ / 1000.0; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the statistics of the waits by a wait strategy
+  /// @param strategy Wait strategy
+  /// @return Statistics, all zero for an unknown strategy
+  ////////////////////////////////////////////////////////////////////////////////
+  PortWaitStats getWaitStats(int strategy);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the statistics of the waits of all wait strategies
+  ////////////////////////////////////////////////////////////////////////////////
+  void    resetWaitStats();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns a snapshot of the system calls of the port
+  /// @description The snapshot can be taken from any thread while the port is used.
+  ////////////////////////////////////////////////////////////////////////////////
+  PortIoStats getIoStats();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the counters of the system calls of the port
+  ////////////////////////////////////////////////////////////////////////////////
+  void    resetIoStats();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks the port before a transaction takes it
+  /// @description The function is called by PortHandler::beginTransaction() before the port is taken.
+  /// @description The port handlers which can lose their device reopen it here. The default does nothing.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    checkPort() { }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that lets the port go when no thread has it any longer
+  /// @description The function is called by PortHandler::unlockPort() before the port is released.
+  /// @description The port handlers which share the bus with other processes give it back here. The default does nothing.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual void    releasePort() { }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that takes the port if no other thread has it
+  /// @description The lock is recursive: the thread which has the port can take it again,
+  /// @description and releases it by as many calls of PortHandler::unlockPort().
+  /// @return false
+  /// @return   when another thread has the port
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    tryLockPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that takes the port, and waits until no other thread has it
+  /// @return true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    lockPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that takes the port, and waits for msec at most until no other thread has it
+  /// @description The waiting thread sleeps on a futex in Linux, and yields the processor in the other platforms.
+  /// @param msec Time to wait, which is 0 not to wait, or negative to wait without limit
+  /// @return false
+  /// @return   when another thread has the port after msec
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    lockPort(double msec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that releases the port taken by the calling thread
+  /// @description The function does nothing when the calling thread does not have the port.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    unlockPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether a thread has the port
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isPortLocked();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets how long the packet handlers wait for the port held by another thread
+  /// @description The packet handlers return COMM_PORT_BUSY when the port is not taken within msec.
+  /// @description The default 0 returns COMM_PORT_BUSY at once, and negative msec waits without limit.
+  /// @param msec Time to wait
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setLockTimeout(double msec) { lock_timeout_ = msec; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns how long the packet handlers wait for the port held by another thread
+  ////////////////////////////////////////////////////////////////////////////////
+  double  getLockTimeout() { return lock_timeout_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that takes the port for the transaction started by PacketHandler::txPacket()
+  /// @description The port is held until PortHandler::endTransaction() after the status packet is received.
+  /// @return false
+  /// @return   when another thread has the port after the lock timeout,
+  /// @return   or the transaction of the calling thread is not ended yet
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    beginTransaction();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that releases the port taken by PortHandler::beginTransaction()
+  /// @description The function does nothing when the transaction is already ended.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    endTransaction();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns a snapshot of the contention statistics of the port
+  /// @description The snapshot can be taken from any thread while the port is used.
+  ////////////////////////////////////////////////////////////////////////////////
+  PortLockStats getLockStats();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the contention statistics of the port
+  ////////////////////////////////////////////////////////////////////////////////
+  void    resetLockStats();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class that holds a port for the lifetime of the instance
+/// @description The packets sent and received while the instance lives, such as an instruction packet and all the status
+/// @description packets answering it, are one unit which no other thread can interleave.
+/// @description The port is released when the instance goes out of scope.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortTransaction
+{
+ private:
+  PortHandler *port_;
+  bool         locked_;
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that takes the port, and waits for it by PortHandler::getLockTimeout()
+  /// @param port PortHandler instance
+  ////////////////////////////////////////////////////////////////////////////////
+  PortTransaction(PortHandler *port) : port_(port) { locked_ = port_->lockPort(port_->getLockTimeout()); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that takes the port, and waits for it by msec
+  /// @param port PortHandler instance
+  /// @param msec Time to wait, which is 0 not to wait, or negative to wait without limit
+  ////////////////////////////////////////////////////////////////////////////////
+  PortTransaction(PortHandler *port, double msec) : port_(port) { locked_ = port_->lockPort(msec); }
+
+  ~PortTransaction() { if (locked_) port_->unlockPort(); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether the port was taken
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isLocked() { return locked_; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class that sets the wait strategy of a port for the lifetime of the instance
+/// @description The strategy is set back when the instance is destroyed, so that a transaction can wait otherwise than
+/// @description the port: for example by spinning for the status packets of a sync read, and by sleeping for the others.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortWaitScope
+{
+ private:
+  PortHandler *port_;
+  int          strategy_;
+  double       spin_usec_;
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the wait strategy of the port
+  /// @param port PortHandler instance
+  /// @param strategy Wait strategy
+  /// @param spin_usec Time to spin by PortHandler::WAIT_HYBRID_ in usec
+  ////////////////////////////////////////////////////////////////////////////////
+  PortWaitScope(PortHandler *port, int strategy, double spin_usec = PortHandler::WAIT_SPIN_USEC_)
+    : port_(port), strategy_(port->getWaitStrategy()), spin_usec_(port->getWaitSpinTime())
+  {
+    port_->setWaitStrategy(strategy, spin_usec);
+  }
+
+  ~PortWaitScope() { port_->setWaitStrategy(strategy_, spin_usec_); }
 };
 
 }
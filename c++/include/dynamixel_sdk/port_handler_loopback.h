@@ -0,0 +1,393 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for port control on an in-memory loopback channel
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_LOOPBACK_PORTHANDLERLOOPBACK_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_LOOPBACK_PORTHANDLERLOOPBACK_H_
+
+
+#include <pthread.h>
+#include "port_handler.h"
+#include "simulated_bus.h"
+
+#define LOOPBACK_PORT_PREFIX "loop://"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the lock-free ring buffer of bytes between a single producer and a single consumer
+/// @description The producer thread calls only LoopbackRing::write(), LoopbackRing::writeV() and LoopbackRing::getRoom(),
+/// @description and the consumer thread calls only the others.
+/// @description Each side publishes its index by an atomic store, so that neither of them takes a lock or a system call.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC LoopbackRing
+{
+ public:
+  static const int SIZE_ = 4096;  ///< Size of the ring, which is a power of two
+
+ private:
+  uint8_t   buffer_[SIZE_];
+  uint8_t   peek_buffer_[SIZE_];  // the bytes wrapped around the end, copied in order by peek()
+  uint32_t  head_;                // advanced by the consumer
+  uint8_t   head_pad_[64 - sizeof(uint32_t)];
+  uint32_t  tail_;                // advanced by the producer
+  uint8_t   tail_pad_[64 - sizeof(uint32_t)];
+
+ public:
+  LoopbackRing() : head_(0), tail_(0) { }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes into the ring
+  /// @param data Bytes to write
+  /// @param length Length of the bytes
+  /// @return Length of bytes written, which is less than length when the ring is full
+  ////////////////////////////////////////////////////////////////////////////////
+  int       write(const uint8_t *data, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes into the ring, and publishes them at once
+  /// @param segments Segments to write
+  /// @param count Number of the segments
+  /// @return -1
+  /// @return   when the ring does not have room for all the segments
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int       writeV(PortSegment *segments, int count);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the number of bytes able to be written into the ring
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getRoom();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the number of bytes able to be read from the ring
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the ring
+  /// @param data Buffer for the bytes read
+  /// @param length Length of the buffer
+  /// @return Length of bytes read
+  ////////////////////////////////////////////////////////////////////////////////
+  int       read(uint8_t *data, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes in the ring without removing them
+  /// @description The function points data to all the bytes in the ring, and returns the number.
+  /// @description The bytes wrapped around the end of the buffer are copied in order to the consumer's side first.
+  /// @param data Pointer to be set to the bytes
+  /// @return Length of the bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int       peek(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes from the ring
+  /// @param length Length of the bytes to remove
+  ////////////////////////////////////////////////////////////////////////////////
+  void      consume(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes all bytes in the ring
+  ////////////////////////////////////////////////////////////////////////////////
+  void      clear();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the in-memory channel between PortHandlerLoopback and its peer
+/// @description The channel has a LoopbackRing for each direction. The peer is a SimulatedBus attached to the channel,
+/// @description which answers in a thread of the channel, or the code of the program which reads the bytes the port wrote
+/// @description from LoopbackChannel::getPeerRxRing() and writes the bytes the port reads into LoopbackChannel::getPeerTxRing().
+/// @description Bytes are exchanged without the time they take on the bus, so that the time of a transaction is
+/// @description the time the SDK takes to build and parse its packets.
+/// @description Channels are found by name, so that PortHandlerLoopback opened as "loop://<name>" uses the channel <name>.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC LoopbackChannel
+{
+ private:
+  char          name_[100];
+  LoopbackRing  to_peer_;
+  LoopbackRing  to_host_;
+  int           baudrate_;
+
+  SimulatedBus *bus_;
+  bool          bus_running_;
+  pthread_t     bus_thread_;
+
+  static void  *busThread(void *channel);
+  void          serveBus();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the channel of the name, which is created when it does not exist
+  /// @param name Name of the channel
+  /// @return LoopbackChannel instance
+  ////////////////////////////////////////////////////////////////////////////////
+  static LoopbackChannel *getChannel(const char *name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that deletes the channel of the name
+  /// @description The ports opened on the channel must be closed before.
+  /// @param name Name of the channel
+  ////////////////////////////////////////////////////////////////////////////////
+  static void removeChannel(const char *name);
+
+  LoopbackChannel(const char *name);
+
+  virtual ~LoopbackChannel();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the name of the channel
+  ////////////////////////////////////////////////////////////////////////////////
+  char         *getName() { return name_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the ring of bytes from the port to the peer
+  ////////////////////////////////////////////////////////////////////////////////
+  LoopbackRing *getPeerRxRing() { return &to_peer_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the ring of bytes from the peer to the port
+  ////////////////////////////////////////////////////////////////////////////////
+  LoopbackRing *getPeerTxRing() { return &to_host_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the baudrate which the port sends the instruction packets with
+  /// @description The attached SimulatedBus answers only by the devices at the baudrate.
+  /// @param baudrate Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  void          setBaudRate(int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the baudrate which the port sends the instruction packets with
+  ////////////////////////////////////////////////////////////////////////////////
+  int           getBaudRate();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that starts a thread which answers the instruction packets by the SimulatedBus
+  /// @description The thread passes every instruction packet to SimulatedBus::transfer() as soon as it is written,
+  /// @description and writes the status packets back at once, regardless of the time they take on the bus.
+  /// @description The bus must not be used by others while it is attached.
+  /// @param bus SimulatedBus instance
+  /// @return false
+  /// @return   when the thread could not be started
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool          attachBus(SimulatedBus *bus);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that stops the thread started by LoopbackChannel::attachBus()
+  ////////////////////////////////////////////////////////////////////////////////
+  void          detachBus();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for control port on the LoopbackChannel
+/// @description The port is selected by PortHandler::getPortHandler() with the port name "loop://<channel name>".
+/// @description Writes and reads are memory copies into and out of the rings of the channel, and waitPort() spins,
+/// @description so that the port measures the overhead of the SDK without the kernel or the bus.
+/// @description An instruction packet has to be written by a single writePort() or writePortV().
+////////////////////////////////////////////////////////////////////////////////
+class PortHandlerLoopback : public PortHandler
+{
+ private:
+  char             port_name_[100];
+  LoopbackChannel *channel_;
+  int              baudrate_;
+
+  double           tx_time_per_byte;
+
+  bool             waitRoom(int length);
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortHandler and gets port_name
+  /// @description The function initializes instance of PortHandler and gets port_name.
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerLoopback(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function calls PortHandlerLoopback::closePort() to close the port.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortHandlerLoopback() { closePort(); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that opens the port
+  /// @description The function connects the port to the LoopbackChannel of the name after "loop://".
+  /// @return true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    openPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function disconnects the port from the channel.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    closePort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the port
+  /// @description The function drops the bytes which the peer has written and are not read yet.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    clearPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets port name into the port handler
+  /// @description The function sets port name into the port handler.
+  /// @param port_name Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPortName(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns port name set into the port handler
+  /// @description The function returns current port name set into the port handler.
+  /// @return Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  char   *getPortName();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets baudrate into the port handler
+  /// @description The function sets baudrate into the channel, and opens the port when it is not opened.
+  /// @param baudrate Baudrate
+  /// @return true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setBaudRate(const int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns current baudrate set into the port handler
+  /// @description The function returns current baudrate set into the port handler.
+  /// @return Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBaudRate();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description The function takes "baud", and the options of PortHandler::setOption().
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOption(const char *key, const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the channel which the port is connected to
+  /// @return 0
+  /// @return   when the port is not opened
+  /// @return or LoopbackChannel instance
+  ////////////////////////////////////////////////////////////////////////////////
+  LoopbackChannel *getChannel() { return channel_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks how much bytes are able to be read from the port buffer
+  /// @description The function returns the number of bytes the peer has written.
+  /// @return Length of read-able bytes in the port buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBytesAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the port buffer
+  /// @description The function gets bytes the peer has written,
+  /// @description and returns a number of bytes read.
+  /// @param packet Buffer for the packet received
+  /// @param length Length of the buffer for read
+  /// @return Length of bytes read
+  ////////////////////////////////////////////////////////////////////////////////
+  int     readPort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes on the port buffer
+  /// @description The function writes bytes into the ring to the peer,
+  /// @description and returns a number of bytes which are successfully written.
+  /// @description As a write on the serial port, the function waits while the peer has not taken the bytes written before.
+  /// @param packet Buffer which would be written on the port buffer
+  /// @param length Length of the buffer for write
+  /// @return -1
+  /// @return   when the port is not opened
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes on the port buffer as a single packet
+  /// @description The function copies the segments into the ring to the peer, and publishes them at once.
+  /// @param segments Segments which would be written on the port buffer
+  /// @param count Number of the segments
+  /// @return -1
+  /// @return   when the port is not opened or the ring does not have room for the packet
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePortV(PortSegment *segments, int count);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function points data to the bytes the peer has written, and returns the number.
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandlerLoopback::peekPort() from the receive buffer
+  /// @param length Length of the bytes to remove
+  ////////////////////////////////////////////////////////////////////////////////
+  void    consumePort(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function spins, yielding the processor, until the peer writes bytes or the packet timeout is passed.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    waitPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with packet_length.
+  /// @param packet_length Length of the packet expected to be received
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(uint16_t packet_length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with msec.
+  /// @param msec Time of packet timeout in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(double msec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether packet timeout is occurred
+  /// @description The function checks whether current monotonic time is passed by the packet deadline.
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isPacketTimeout();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets absolute deadline for watching packet timeout
+  /// @param deadline_ns Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketDeadline(int64_t deadline_ns);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_LOOPBACK_PORTHANDLERLOOPBACK_H_ */
@@ -0,0 +1,220 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for recording the bytes of a port into a capture file
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_RECORD_PORTHANDLERRECORD_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_RECORD_PORTHANDLERRECORD_H_
+
+
+#include <stdio.h>
+#include <pthread.h>
+#include "port_handler.h"
+
+// capture file: CAPTURE_MAGIC, and the records one after another, each of which is
+// time_ns (int64), type (uint8), reserved (uint8) and length (uint16) in little endian, followed by length bytes
+#define CAPTURE_MAGIC         "DXLCAP1\n"
+#define CAPTURE_MAGIC_LENGTH  8
+#define CAPTURE_HEADER_LENGTH 12
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the records taken by PortHandlerRecord
+////////////////////////////////////////////////////////////////////////////////
+struct PortRecordStats
+{
+  uint64_t  records;        ///< records written into the capture file
+  uint64_t  dropped;        ///< records dropped since the writer thread was behind
+  uint64_t  bytes;          ///< bytes written into the capture file
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the port which records the bytes of another port into a capture file
+/// @description PortHandlerRecord passes every call to the port it wraps, and records each chunk written and read,
+/// @description and each baudrate set, with the monotonic time of the port.
+/// @description The records are put into a ring buffer without a lock or a system call, and a writer thread writes them
+/// @description into the capture file, so that the thread using the port is not held back by the file.
+/// @description A record which the ring has no room for is dropped and counted, instead of waiting for the writer thread.
+/// @description PortHandlerReplay plays the capture file back.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortHandlerRecord : public PortHandler
+{
+ public:
+  static const int DEFAULT_BUFFER_SIZE_ = 1 << 20;  ///< Size of the ring buffer of the records
+
+  static const int CAPTURE_WRITE_ = 1;   ///< Record of the bytes written on the port
+  static const int CAPTURE_READ_  = 2;   ///< Record of the bytes read from the port
+  static const int CAPTURE_BAUD_  = 3;   ///< Record of the baudrate set, in 4 bytes of little endian
+
+ private:
+  PortHandler  *port_;
+  FILE         *file_;
+  uint8_t      *peek_data_;
+
+  uint8_t      *ring_;
+  uint32_t      size_;              // power of two
+  uint32_t      head_;              // advanced by the writer thread
+  uint8_t       head_pad_[64 - sizeof(uint32_t)];
+  uint32_t      tail_;              // advanced by the thread using the port
+  uint8_t       tail_pad_[64 - sizeof(uint32_t)];
+
+  pthread_t     thread_;
+  bool          running_;
+
+  uint64_t      records_;
+  uint64_t      dropped_;
+  uint64_t      bytes_;
+
+  void          record(int type, PortSegment *segments, int count);
+  void          recordBaudRate(int baudrate);
+  int           drain();
+  void          copyTuning();
+
+  static void  *writerThread(void *recorder);
+  void          run();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes the recording of the port into the capture file
+  /// @description The function creates the capture file, and starts the writer thread.
+  /// @param port PortHandler instance, which outlives PortHandlerRecord and is not deleted by it
+  /// @param capture_path Path of the capture file
+  /// @param buffer_size Size of the ring buffer, which is rounded up to a power of two
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerRecord(PortHandler *port, const char *capture_path, int buffer_size = DEFAULT_BUFFER_SIZE_);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that stops the recording
+  /// @description The function writes the records left in the ring buffer, and closes the capture file.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortHandlerRecord();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns whether the capture file is being written
+  /// @return false
+  /// @return   when the capture file or the writer thread could not be created
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isRecording() { return running_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the port which is recorded
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandler *getPort() { return port_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the records taken, which the writer thread updates
+  ////////////////////////////////////////////////////////////////////////////////
+  PortRecordStats getStats();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The functions that pass the call to the port which is recorded
+  /// @description The time of the port, including its clock, is the time of the port which is recorded.
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    openPort();
+  void    closePort();
+  void    clearPort();
+
+  void    setPortName(const char *port_name);
+  char   *getPortName();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets baudrate into the port handler
+  /// @description The function sets the baudrate of the port, and records it when it is set.
+  /// @param baudrate Baudrate
+  /// @return Result of the port
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setBaudRate(const int baudrate);
+  int     getBaudRate();
+  bool    setOption(const char *key, const char *value);
+
+  int     getBytesAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the port buffer
+  /// @description The function reads the bytes from the port, and records them.
+  /// @param packet Buffer for the packet received
+  /// @param length Length of the buffer for read
+  /// @return Result of the port
+  ////////////////////////////////////////////////////////////////////////////////
+  int     readPort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes on the port buffer
+  /// @description The function writes the bytes on the port, and records them.
+  /// @param packet Buffer which would be written on the port buffer
+  /// @param length Length of the buffer for write
+  /// @return Result of the port
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes on the port buffer
+  /// @description The function writes the segments on the port, and records them as one chunk.
+  /// @param segments Segments to write
+  /// @param count Number of the segments
+  /// @return Result of the port
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePortV(PortSegment *segments, int count);
+
+  bool    waitPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function passes the bytes of the port, which are recorded when they are consumed.
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+  void    consumePort(int length);
+
+  void    setPacketTimeout(uint16_t packet_length);
+  void    setPacketTimeout(double msec);
+  bool    isPacketTimeout();
+
+  int64_t getMonotonicNs();
+  void    setPacketDeadline(int64_t deadline_ns);
+  int64_t getPacketDeadline();
+  int64_t getRemainingNs();
+  int64_t getTransmitEndNs();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The functions that pass the check and the release of the port to the port which is recorded
+  /// @description The port which is recorded reconnects its device, or gives the bus back, as when it is used alone.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    checkPort();
+  void    releasePort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The functions that set the tuning of both PortHandlerRecord and the port which is recorded
+  /// @description The packet handlers use the adaptive timeout and the stale byte policy of PortHandlerRecord,
+  /// @description and the port which is recorded waits by its own wait strategy, so that both are set alike.
+  /// @description PortHandlerRecord takes the tuning of the port when it is created, and when options are set.
+  /// @description The statistics of the waits and the system calls are those of PortHandlerRecord::getPort().
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setAdaptiveTimeout(bool enable, double margin_msec = 0.2, double floor_msec = 0.5);
+  void    setStalePolicy(int policy);
+  void    setWaitStrategy(int strategy, double spin_usec = WAIT_SPIN_USEC_);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_RECORD_PORTHANDLERRECORD_H_ */
@@ -0,0 +1,256 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for port control which plays a capture file back
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_REPLAY_PORTHANDLERREPLAY_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_REPLAY_PORTHANDLERREPLAY_H_
+
+
+#include "port_handler.h"
+#include "port_handler_record.h"
+
+#define REPLAY_PORT_PREFIX "replay://"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the port which plays back the bytes recorded by PortHandlerRecord
+/// @description The port name is the path of the capture file after "replay://".
+/// @description Each packet written on the port takes the place of the next chunk written in the capture,
+/// @description and the chunks read after that one arrive at their recorded time after it, divided by the speed.
+/// @description So the replay stays in step with the packets of the program, even when it does not run
+/// @description at the pace of the recording. A packet which is not the one recorded is counted as a mismatch.
+/// @description With a VirtualClock set by PortHandler::setClock(), the capture is played back without waiting for it.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortHandlerReplay : public PortHandler
+{
+ public:
+  static const int RX_BUFFER_SIZE_ = 4096; ///< Size of the receive buffer
+
+ private:
+  char          port_name_[256];
+  int           baudrate_;
+  double        speed_;             // 0: as fast as possible
+  double        tx_time_per_byte;
+
+  uint8_t      *capture_;
+  long          capture_length_;
+  long          cursor_;            // next record of the capture
+
+  int64_t       anchor_ns_;         // time of the last packet written
+  int64_t       anchor_capture_ns_; // time of its chunk in the capture
+
+  uint8_t       rx_buffer_[RX_BUFFER_SIZE_];
+  int           rx_head_;
+  int           rx_tail_;
+
+  uint64_t      packets_;
+  uint64_t      mismatches_;
+
+  bool          getRecord(long offset, int64_t *time_ns, int *type, int *length);
+  int64_t       getArrivalNs(int64_t time_ns);
+  int64_t       receive();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortHandler and gets port_name
+  /// @description The function initializes instance of PortHandler and gets port_name.
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerReplay(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function calls PortHandlerReplay::closePort() to close the port.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortHandlerReplay() { closePort(); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that opens the port
+  /// @description The function loads the capture file, and plays it back from the start.
+  /// @description The baudrate is the first one recorded, unless it is set before.
+  /// @return false
+  /// @return   when the capture file is not able to be read, or is not a capture
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    openPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function releases the capture.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    closePort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the port
+  /// @description The function drops the bytes which have arrived and are not read yet.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    clearPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets port name into the port handler
+  /// @description The function sets port name into the port handler.
+  /// @param port_name Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPortName(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns port name set into the port handler
+  /// @description The function returns current port name set into the port handler.
+  /// @return Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  char   *getPortName();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets baudrate into the port handler
+  /// @description The function sets baudrate which the packet timeouts are counted with,
+  /// @description and does not change the timing of the capture.
+  /// @param baudrate Baudrate
+  /// @return true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setBaudRate(const int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns current baudrate set into the port handler
+  /// @description The function returns current baudrate set into the port handler.
+  /// @return Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBaudRate();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description The function takes "baud", "speed", and the options of PortHandler::setOption().
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOption(const char *key, const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the speed of the playback
+  /// @param speed Times the speed of the recording, or 0 for the bytes to arrive as soon as the packet before them is written
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setSpeed(double speed) { speed_ = (speed < 0.0) ? 0.0 : speed; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the speed of the playback
+  ////////////////////////////////////////////////////////////////////////////////
+  double  getSpeed() { return speed_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns whether the whole capture has been played back
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isEndOfCapture();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the number of packets written on the port
+  ////////////////////////////////////////////////////////////////////////////////
+  uint64_t getPackets() { return packets_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the number of packets written which differ from the ones recorded
+  ////////////////////////////////////////////////////////////////////////////////
+  uint64_t getMismatches() { return mismatches_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks how much bytes are able to be read from the port buffer
+  /// @description The function returns the number of recorded bytes which have arrived.
+  /// @return Length of read-able bytes in the port buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBytesAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the port buffer
+  /// @description The function gets the recorded bytes which have arrived,
+  /// @description and returns a number of bytes read.
+  /// @param packet Buffer for the packet received
+  /// @param length Length of the buffer for read
+  /// @return Length of bytes read
+  ////////////////////////////////////////////////////////////////////////////////
+  int     readPort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes on the port buffer
+  /// @description The function moves the playback to the next chunk written in the capture,
+  /// @description and skips the bytes recorded before it which have not arrived yet.
+  /// @param packet Buffer which would be written on the port buffer
+  /// @param length Length of the buffer for write
+  /// @return -1
+  /// @return   when the port is not opened
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function points data to the recorded bytes which have arrived, and returns the number.
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandlerReplay::peekPort() from the receive buffer
+  /// @param length Length of the bytes to remove
+  ////////////////////////////////////////////////////////////////////////////////
+  void    consumePort(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function sleeps until the next recorded chunk arrives, or the packet timeout is passed.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    waitPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with packet_length,
+  /// @description as PortHandlerLinux does with the latency timer of the USB serial.
+  /// @param packet_length Length of the packet expected to be received
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(uint16_t packet_length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with msec.
+  /// @param msec Time of packet timeout in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(double msec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether packet timeout is occurred
+  /// @description The function checks whether current monotonic time is passed by the packet deadline.
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isPacketTimeout();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets absolute deadline for watching packet timeout
+  /// @param deadline_ns Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketDeadline(int64_t deadline_ns);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_REPLAY_PORTHANDLERREPLAY_H_ */
@@ -0,0 +1,224 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for port control on the simulated Dynamixel bus
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_SIM_PORTHANDLERSIM_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_SIM_PORTHANDLERSIM_H_
+
+
+#include "port_handler.h"
+#include "simulated_bus.h"
+
+#define SIM_PORT_PREFIX "sim://"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for control port on the SimulatedBus
+/// @description The port is selected by PortHandler::getPortHandler() with the port name "sim://<bus name>".
+/// @description Bytes written are sent to the devices on the bus at once, and the status bytes become readable
+/// @description at the time each of them arrives through the bus, so that the packet timeout, waiting and
+/// @description throughput behave as on the serial port without any hardware.
+////////////////////////////////////////////////////////////////////////////////
+class PortHandlerSim : public PortHandler
+{
+ public:
+  static const int RX_BUFFER_SIZE_ = 4096; ///< Size of the receive buffer
+
+ private:
+  char          port_name_[100];
+  SimulatedBus *bus_;
+  int           baudrate_;
+
+  uint8_t       rx_buffer_[RX_BUFFER_SIZE_];
+  int64_t       rx_arrival_ns_[RX_BUFFER_SIZE_];
+  int           rx_head_;
+  int           rx_tail_;
+
+  double        tx_time_per_byte;
+
+  int           getArrivedBytes();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortHandler and gets port_name
+  /// @description The function initializes instance of PortHandler and gets port_name.
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerSim(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function calls PortHandlerSim::closePort() to close the port.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortHandlerSim() { closePort(); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that opens the port
+  /// @description The function connects the port to the SimulatedBus of the name after "sim://".
+  /// @return true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    openPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function disconnects the port from the bus, and drops the bytes not read.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    closePort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the port
+  /// @description The function drops the bytes which have arrived and are not read yet.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    clearPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets port name into the port handler
+  /// @description The function sets port name into the port handler.
+  /// @param port_name Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPortName(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns port name set into the port handler
+  /// @description The function returns current port name set into the port handler.
+  /// @return Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  char   *getPortName();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets baudrate into the port handler
+  /// @description The function sets baudrate which the instruction packets are sent with,
+  /// @description and opens the port when it is not opened.
+  /// @param baudrate Baudrate
+  /// @return true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setBaudRate(const int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns current baudrate set into the port handler
+  /// @description The function returns current baudrate set into the port handler.
+  /// @return Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBaudRate();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description The function takes "baud", and the options of PortHandler::setOption().
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOption(const char *key, const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the bus which the port is connected to
+  /// @return 0
+  /// @return   when the port is not opened
+  /// @return or SimulatedBus instance
+  ////////////////////////////////////////////////////////////////////////////////
+  SimulatedBus *getBus() { return bus_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks how much bytes are able to be read from the port buffer
+  /// @description The function returns the number of status bytes which have arrived.
+  /// @return Length of read-able bytes in the port buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBytesAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the port buffer
+  /// @description The function gets the status bytes which have arrived,
+  /// @description and returns a number of bytes read.
+  /// @param packet Buffer for the packet received
+  /// @param length Length of the buffer for read
+  /// @return Length of bytes read
+  ////////////////////////////////////////////////////////////////////////////////
+  int     readPort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes on the port buffer
+  /// @description The function sends the bytes on the bus by SimulatedBus::transfer(),
+  /// @description and keeps the status bytes returned until they arrive.
+  /// @param packet Buffer which would be written on the port buffer
+  /// @param length Length of the buffer for write
+  /// @return -1
+  /// @return   when the port is not opened
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function points data to the status bytes which have arrived, and returns the number.
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandlerSim::peekPort() from the receive buffer
+  /// @param length Length of the bytes to remove
+  ////////////////////////////////////////////////////////////////////////////////
+  void    consumePort(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function sleeps until the status bytes sent back to back with the next one have arrived,
+  /// @description or the packet timeout is passed.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    waitPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with packet_length.
+  /// @description The transport delay of the bus is added to the latency timer of 1 msec, which PortHandlerLinux sets on the USB serial.
+  /// @param packet_length Length of the packet expected to be received
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(uint16_t packet_length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with msec.
+  /// @param msec Time of packet timeout in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(double msec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether packet timeout is occurred
+  /// @description The function checks whether current monotonic time is passed by the packet deadline.
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isPacketTimeout();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets absolute deadline for watching packet timeout
+  /// @param deadline_ns Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketDeadline(int64_t deadline_ns);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_SIM_PORTHANDLERSIM_H_ */
@@ -0,0 +1,260 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for port control through a TCP serial gateway
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_TCP_PORTHANDLERTCP_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_TCP_PORTHANDLERTCP_H_
+
+
+#include "port_handler.h"
+
+#define TCP_PORT_PREFIX "tcp://"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for control port through a serial-to-Ethernet gateway
+/// @description The port is selected by PortHandler::getPortHandler() with the port name "tcp://<host>:<port>",
+/// @description and exchanges raw bytes of the Dynamixel bus with the gateway over TCP with TCP_NODELAY.
+/// @description The baudrate of the bus is set on the gateway; the port uses it only for the packet timeout.
+////////////////////////////////////////////////////////////////////////////////
+class PortHandlerTcp : public PortHandler
+{
+ public:
+  static const int RX_BUFFER_SIZE_ = 4096; ///< Size of the receive buffer
+
+ private:
+  int     socket_fd_;
+  int     baudrate_;
+  char    port_name_[100];
+
+  uint8_t rx_buffer_[RX_BUFFER_SIZE_];
+  int     rx_head_;
+  int     rx_tail_;
+
+  double  gateway_latency_;
+  double  connect_rtt_;
+
+  double  tx_time_per_byte;
+
+  bool    connectSocket();
+  int     fillBuffer();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortHandler and gets port_name
+  /// @description The function initializes instance of PortHandler and gets port_name.
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerTcp(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function calls PortHandlerTcp::closePort() to close the port.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortHandlerTcp() { closePort(); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that opens the port
+  /// @description The function calls PortHandlerTcp::setBaudRate() to connect to the gateway.
+  /// @return communication results which come from PortHandlerTcp::setBaudRate()
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    openPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function closes the connection to the gateway.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    closePort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the port
+  /// @description The function drops the bytes which have been received and are not read yet.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    clearPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets port name into the port handler
+  /// @description The function sets port name into the port handler.
+  /// @param port_name Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPortName(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns port name set into the port handler
+  /// @description The function returns current port name set into the port handler.
+  /// @return Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  char   *getPortName();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets baudrate into the port handler
+  /// @description The function sets baudrate of the bus behind the gateway, which is used for the packet timeout,
+  /// @description and connects to the gateway when it is not connected.
+  /// @param baudrate Baudrate
+  /// @return false
+  /// @return   when error was occurred during connecting to the gateway
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setBaudRate(const int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns current baudrate set into the port handler
+  /// @description The function returns current baudrate set into the port handler.
+  /// @return Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBaudRate();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description The function takes "baud", and the options of PortHandler::setOption().
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOption(const char *key, const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the time the gateway holds the bytes from the bus before sending them
+  /// @description Serial-to-Ethernet gateways collect the bytes received from the bus by a packing interval.
+  /// @description The time takes the place of the latency timer of the USB serial in the packet timeout.
+  /// @param msec Gateway latency in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setGatewayLatency(double msec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the time the gateway holds the bytes from the bus before sending them
+  /// @return Gateway latency in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  double  getGatewayLatency();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the round trip time to the gateway used for the packet timeout
+  /// @description The function returns the smoothed round trip time and four times its variation
+  /// @description measured by the TCP stack (TCP_INFO in Linux), or the time taken to connect when it is not available.
+  /// @return Round trip time in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  double  getNetworkRtt();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks how much bytes are able to be read from the port buffer
+  /// @description The function returns the number of bytes in the receive buffer,
+  /// @description or asks the socket by FIONREAD only when the receive buffer is empty.
+  /// @return Length of read-able bytes in the port buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBytesAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the port buffer
+  /// @description The function gets bytes from the receive buffer,
+  /// @description and returns a number of bytes read.
+  /// @description When the receive buffer is empty, it is refilled with everything the socket has by a single recv().
+  /// @param packet Buffer for the packet received
+  /// @param length Length of the buffer for read
+  /// @return Length of bytes read
+  ////////////////////////////////////////////////////////////////////////////////
+  int     readPort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes on the port buffer
+  /// @description The function sends bytes to the gateway,
+  /// @description and returns a number of bytes which are successfully written.
+  /// @param packet Buffer which would be written on the port buffer
+  /// @param length Length of the buffer for write
+  /// @return -1
+  /// @return   when error was occurred
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes on the port buffer as a single packet
+  /// @description The function sends the segments by a single sendmsg() without copying them,
+  /// @description so that the packet goes out in one TCP segment.
+  /// @param segments Segments which would be written on the port buffer
+  /// @param count Number of the segments
+  /// @return -1
+  /// @return   when error was occurred
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePortV(PortSegment *segments, int count);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function points data to the received bytes, and returns the number.
+  /// @description The bytes are kept until PortHandlerTcp::consumePort() is called.
+  /// @description When the buffer is empty or the caller has seen all of it, the bytes left are moved to the front
+  /// @description and the room behind them is filled with everything the socket has by a single recv().
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandlerTcp::peekPort() from the receive buffer
+  /// @param length Length of the bytes to remove, which removes all of them when it is longer
+  ////////////////////////////////////////////////////////////////////////////////
+  void    consumePort(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function sleeps in poll() on the socket until bytes arrive
+  /// @description or the time left until the packet timeout is passed.
+  /// @description It polls the socket without sleeping before, as PortHandler::setWaitStrategy() sets.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    waitPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with packet_length.
+  /// @description The timeout is the time of packet_length on the bus, the round trip time to the gateway,
+  /// @description and the gateway latency.
+  /// @param packet_length Length of the packet expected to be received
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(uint16_t packet_length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with msec.
+  /// @param msec Time of packet timeout in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(double msec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether packet timeout is occurred
+  /// @description The function checks whether current monotonic time is passed by the packet deadline.
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isPacketTimeout();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets absolute deadline for watching packet timeout
+  /// @param deadline_ns Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketDeadline(int64_t deadline_ns);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_TCP_PORTHANDLERTCP_H_ */
@@ -0,0 +1,323 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for port control in Linux through io_uring
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_LINUX_PORTHANDLERURING_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_LINUX_PORTHANDLERURING_H_
+
+
+#include <vector>
+#include "port_handler_linux.h"
+
+#define URING_PORT_PREFIX "uring://"
+
+namespace dynamixel
+{
+
+class PortHandlerUring;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the io_uring instance which PortHandlerUring submit their reads and writes to
+/// @description The queue registers a transmit and a receive buffer for each port, so that the kernel reads and writes them
+/// @description without mapping them for every operation. Ports sharing a queue are driven by one thread, which waits for
+/// @description all of them by a single io_uring_enter() in UringQueue::waitCompletion().
+/// @description The queue and its ports must be used by one thread at a time.
+////////////////////////////////////////////////////////////////////////////////
+class UringQueue
+{
+  friend class PortHandlerUring;
+
+ public:
+  static const int BUFFER_SIZE_ = 4096; ///< Size of the transmit and the receive buffer of a port
+
+ private:
+  int       ring_fd_;
+  int       max_ports_;
+  bool      batching_;
+
+  void     *sq_ring_;
+  void     *cq_ring_;
+  size_t    sq_ring_size_;
+  size_t    cq_ring_size_;
+  void     *sqes_;
+  size_t    sqes_size_;
+
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+  unsigned  sqe_tail_;
+  unsigned  sqe_submitted_;
+  unsigned  sq_entries_;
+
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  void     *cqes_;
+
+  uint8_t  *buffers_;
+  std::vector<PortHandlerUring *> ports_;
+  std::vector<PortHandlerUring *> completed_;
+
+  struct
+  {
+    int64_t tv_sec;
+    long long tv_nsec;
+  }         wait_deadline_;
+
+  void      destroy();
+  int       enter(unsigned min_complete);
+
+  int       attach(PortHandlerUring *port);
+  void      detach(PortHandlerUring *port);
+  void      removeCompletion(PortHandlerUring *port);
+  uint8_t  *getTxBuffer(int slot) { return &buffers_[(2 * slot) * BUFFER_SIZE_]; }
+  uint8_t  *getRxBuffer(int slot) { return &buffers_[(2 * slot + 1) * BUFFER_SIZE_]; }
+  void     *getSqe();
+  int       wait(int64_t deadline_ns);
+  void      reap();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets up io_uring for max_ports ports
+  /// @description When io_uring is not available, UringQueue::isAvailable() returns false,
+  /// @description and the ports use the read and write of PortHandlerLinux.
+  /// @param max_ports Number of ports which can share the queue
+  ////////////////////////////////////////////////////////////////////////////////
+  UringQueue(int max_ports = 1);
+
+  virtual ~UringQueue();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether io_uring has been set up
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      isAvailable() { return (ring_fd_ != -1); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets whether the operations are kept until UringQueue::submit()
+  /// @description While batching, PortHandlerUring::writePort() only queues the write, so that the packets to all ports
+  /// @description go out by a single system call in UringQueue::submit() or UringQueue::waitCompletion().
+  /// @param enable Whether to batch the operations
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setBatching(bool enable) { batching_ = enable; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns whether the operations are kept until UringQueue::submit()
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      isBatching() { return batching_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until a transfer started by PortHandlerUring::startRx() is completed
+  /// @description The function submits the operations queued, and sleeps in io_uring_enter() until a port receives
+  /// @description the length of bytes which it expects, its packet timeout is passed, or deadline_ns is passed.
+  /// @param deadline_ns Deadline on PortHandler::getMonotonicNs() time base
+  /// @return 0
+  /// @return   when deadline_ns is passed
+  /// @return or PortHandlerUring instance whose transfer is completed
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerUring *waitCompletion(int64_t deadline_ns);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that submits the operations queued
+  /// @return Number of the operations submitted, or -1 when error was occurred
+  ////////////////////////////////////////////////////////////////////////////////
+  int       submit();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for control port in Linux through io_uring
+/// @description The port is selected by PortHandler::getPortHandler() with the port name "uring://<device>",
+/// @description and sets up the device as PortHandlerLinux does.
+/// @description Each write is submitted as a write of the registered transmit buffer linked to a poll and a read into
+/// @description the registered receive buffer, so that the status packet lands in the receive buffer without another
+/// @description submission, and waitPort() sleeps with a timeout operation at the packet deadline. A transaction then
+/// @description takes two system calls, one to write and one to wait, whatever the number of reads.
+/// @description Transfers on many ports are overlapped by PortHandlerUring::startRx() and UringQueue::waitCompletion().
+/// @description When io_uring is not available, the port works as PortHandlerLinux.
+////////////////////////////////////////////////////////////////////////////////
+class PortHandlerUring : public PortHandlerLinux
+{
+  friend class UringQueue;
+
+ private:
+  UringQueue *queue_;
+  bool        own_queue_;
+  int         slot_;
+  uint8_t    *uring_tx_;
+  uint8_t    *uring_rx_;
+  int         uring_head_;
+  int         uring_tail_;
+
+  bool        read_armed_;
+  bool        write_inflight_;
+  bool        deadline_armed_;
+  int         tx_length_;
+  int         tx_done_;
+  bool        closing_;
+  int         inflight_;
+  int         expected_length_;
+  int         rx_result_;
+  bool        rx_pending_;
+
+  struct
+  {
+    int64_t tv_sec;
+    long long tv_nsec;
+  }           rx_deadline_;
+
+  bool        isUring();
+  void        queueRead();
+  void       *queueWrite();
+  int         submitWrite(int length);
+  void        removeDeadline();
+  bool        waitWrite();
+  void        handleCompletion(int op, int result);
+  void        checkCompletion();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortHandler and gets port_name
+  /// @description The function sets up a UringQueue for the port.
+  /// @param port_name Port name, with or without "uring://"
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerUring(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortHandler and gets port_name
+  /// @description The function shares queue with the other ports.
+  /// @param port_name Port name, with or without "uring://"
+  /// @param queue UringQueue instance which has room for the port
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerUring(const char *port_name, UringQueue *queue);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function calls PortHandlerUring::closePort() to close the port, and leaves the queue.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortHandlerUring();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the queue which the port submits to
+  /// @return 0
+  /// @return   when io_uring is not used
+  /// @return or UringQueue instance
+  ////////////////////////////////////////////////////////////////////////////////
+  UringQueue *getQueue() { return isUring() ? queue_ : 0; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function cancels the operations of the port in flight, and closes the port.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    closePort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the port
+  /// @description The function drops the bytes which have been received and are not read yet.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    clearPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks how much bytes are able to be read from the port buffer
+  /// @description The function returns the number of bytes in the receive buffer, after it takes the completions.
+  /// @return Length of read-able bytes in the port buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBytesAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the port buffer
+  /// @description The function gets bytes from the receive buffer which the kernel has filled, without a system call.
+  /// @param packet Buffer for the packet received
+  /// @param length Length of the buffer for read
+  /// @return Length of bytes read
+  ////////////////////////////////////////////////////////////////////////////////
+  int     readPort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes on the port buffer
+  /// @description The function copies bytes into the registered transmit buffer, and submits the write.
+  /// @description It is only queued while the queue is batching.
+  /// @param packet Buffer which would be written on the port buffer
+  /// @param length Length of the buffer for write
+  /// @return -1
+  /// @return   when error was occurred
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes on the port buffer as a single packet
+  /// @description The function gathers the segments into the registered transmit buffer, and submits the write.
+  /// @param segments Segments which would be written on the port buffer
+  /// @param count Number of the segments
+  /// @return -1
+  /// @return   when error was occurred
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePortV(PortSegment *segments, int count);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandlerUring::peekPort() from the receive buffer
+  /// @param length Length of the bytes to remove
+  ////////////////////////////////////////////////////////////////////////////////
+  void    consumePort(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function submits a timeout operation at the packet deadline with the operations queued,
+  /// @description and sleeps in a single io_uring_enter() until a read is completed or the timeout expires.
+  /// @description It polls the completion queue without sleeping before, as PortHandler::setWaitStrategy() sets.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    waitPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that starts waiting for a status packet in the background
+  /// @description The function sets the packet timeout for length as PortHandler::setPacketTimeout(uint16_t) does,
+  /// @description and queues a timeout operation at the deadline. UringQueue::waitCompletion() returns the port
+  /// @description when length bytes are received or the deadline is passed, and the status packet is read
+  /// @description by the packet handler from the receive buffer then, for example by PacketHandler::readRx().
+  /// @param length Length of the status packet expected
+  /// @return false
+  /// @return   when io_uring is not used
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    startRx(uint16_t length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the result of the transfer returned by UringQueue::waitCompletion()
+  /// @return COMM_SUCCESS
+  /// @return   when the length of bytes expected is received
+  /// @return or COMM_RX_TIMEOUT
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getRxResult() { return rx_result_; }
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_LINUX_PORTHANDLERURING_H_ */
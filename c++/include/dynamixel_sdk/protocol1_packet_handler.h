@@ -38,6 +38,14 @@ class WINDECLSPEC Protocol1PacketHandler : public PacketHandler
 
   Protocol1PacketHandler();
 
+  // reads the bytes left in the port, and counts the status packets among them as stale
+  void    drainPort(PortHandler *port);
+
+  // txpacket holds the packet except param and checksum, which are sent as separate segments;
+  // without param (param_length 0), txpacket holds the packet except checksum and nothing is written past it
+  int     txPacketV   (PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length);
+  int     txRxPacketV (PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length, uint8_t *rxpacket, uint8_t *error = 0);
+
  public:
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that returns Protocol1PacketHandler instance
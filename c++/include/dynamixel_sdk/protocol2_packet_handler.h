@@ -39,8 +39,18 @@ class WINDECLSPEC Protocol2PacketHandler : public PacketHandler
   Protocol2PacketHandler();
 
   uint16_t    updateCRC(uint16_t crc_accum, uint8_t *data_blk_ptr, uint16_t data_blk_size);
-  void        addStuffing(uint8_t *packet);
+  // stuffs packet in place: packet has room for TXPACKET_MAX_LEN bytes, and false is returned when the stuffed packet is longer
+  bool        addStuffing(uint8_t *packet);
   void        removeStuffing(uint8_t *packet);
+  bool        needStuffing(uint8_t *txpacket, uint16_t head_length, uint8_t *param, uint16_t param_length);
+
+  // reads the bytes left in the port, and counts the status packets among them as stale
+  void        drainPort(PortHandler *port);
+
+  // txpacket holds the packet except param and CRC16, which are sent as separate segments;
+  // without param (param_length 0), txpacket holds the packet except CRC16 and nothing is written past it
+  int         txPacketV   (PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length);
+  int         txRxPacketV (PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length, uint8_t *rxpacket, uint8_t *error = 0);
 
  public:
   ////////////////////////////////////////////////////////////////////////////////
@@ -76,12 +86,14 @@ class WINDECLSPEC Protocol2PacketHandler : public PacketHandler
   /// @description The function clears the port buffer by PortHandler::clearPort() function,
   /// @description   then transmits txpacket by PortHandler::writePort() function.
   /// @description The function activates only when the port is not busy and when the packet is already written on the port buffer
+  /// @description txpacket needs room for the packet with its CRC16, but not for the byte stuffing,
+  /// @description which is made in a buffer of the function when the packet needs it. txpacket is not stuffed.
   /// @param port PortHandler instance
   /// @param txpacket packet for transmission
   /// @return COMM_PORT_BUSY
   /// @return   when the port is already in use
   /// @return COMM_TX_ERROR
-  /// @return   when txpacket is out of range described by TXPACKET_MAX_LEN
+  /// @return   when txpacket is out of range described by TXPACKET_MAX_LEN, with or without the byte stuffing
   /// @return COMM_TX_FAIL
   /// @return   when written packet is shorter than expected
   /// @return or COMM_SUCCESS
@@ -0,0 +1,176 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for preparing the thread which runs the bus for real-time use
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_REALTIMEPROFILE_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_REALTIMEPROFILE_H_
+
+
+#include <sched.h>
+#include "port_handler.h"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the wake-up latency of a periodic loop measured by RealtimeProfile::measureJitter()
+////////////////////////////////////////////////////////////////////////////////
+struct JitterStats
+{
+  int      count;           ///< number of periods measured
+  int64_t  period_ns;       ///< period of the loop
+  int64_t  min_ns;          ///< least latency of the wake-up after the start of a period
+  int64_t  mean_ns;         ///< mean latency
+  int64_t  p99_ns;          ///< latency which 99 % of the periods do not exceed
+  int64_t  max_ns;          ///< worst latency
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the settings which prepare a thread for a real-time control loop
+/// @description RealtimeProfile::apply() sets the scheduling policy and priority, and the CPU affinity of the calling thread,
+/// @description locks the memory of the process by mlockall(), sets the timer slack of the thread by PR_SET_TIMERSLACK,
+/// @description and touches the stack the transactions will use, so that no page fault or late timer delays the loop.
+/// @description Each step is tried even when another fails, so that an unprivileged process gets the steps it is allowed.
+/// @description Which steps were applied, and why the others were not, is returned by RealtimeProfile::getReport().
+/// @description The CPU affinity and the timer slack are only in Linux.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC RealtimeProfile
+{
+ public:
+  enum Step
+  {
+    SCHEDULER     = 0x01,   ///< scheduling policy and priority
+    AFFINITY      = 0x02,   ///< CPU affinity
+    MEMORY_LOCK   = 0x04,   ///< mlockall()
+    TIMER_SLACK   = 0x08,   ///< PR_SET_TIMERSLACK
+    PREFAULT      = 0x10    ///< stack and buffers touched in advance
+  };
+
+  static const int STEP_COUNT_ = 5;
+
+ private:
+  int       policy_;
+  int       priority_;
+  int       cpu_;
+  bool      lock_memory_;
+  long      timer_slack_ns_;
+  int       prefault_stack_;
+
+  int       requested_;
+  int       applied_;
+  int       errors_[STEP_COUNT_];
+
+  void      setResult(Step step, int error);
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes the profile
+  /// @description The profile requests SCHED_FIFO at priority 80, mlockall(), the timer slack of 1 nsec
+  /// @description and 256 kbytes of stack touched, and does not change the CPU affinity.
+  ////////////////////////////////////////////////////////////////////////////////
+  RealtimeProfile();
+
+  virtual ~RealtimeProfile() { }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the scheduling policy and priority
+  /// @param policy SCHED_FIFO, SCHED_RR or SCHED_OTHER, or -1 not to change the policy
+  /// @param priority Priority, which is 1 to 99 for SCHED_FIFO and SCHED_RR
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setScheduler(int policy, int priority);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the CPU which the thread runs on
+  /// @param cpu CPU number, or -1 not to change the affinity
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setCpu(int cpu);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets whether the memory of the process is locked by mlockall()
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setMemoryLock(bool enable);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the timer slack of the thread
+  /// @param nsec Timer slack, or 0 not to change it
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setTimerSlack(long nsec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets how much of the stack is touched in advance
+  /// @param length Length of the stack in bytes, or 0 not to touch it
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setStackPrefault(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that applies the profile to the calling thread
+  /// @return false
+  /// @return   when a step requested was not applied
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      apply();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the steps requested, as a combination of RealtimeProfile::Step
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getRequested()  { return requested_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the steps applied by the last RealtimeProfile::apply()
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getApplied()    { return applied_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the errno of a step which was not applied
+  /// @param step Step
+  /// @return 0
+  /// @return   when the step was applied or not requested
+  /// @return or errno of the step
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getError(Step step);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes the result of the last RealtimeProfile::apply() as text, one line for each step
+  /// @param report Buffer for the text
+  /// @param length Length of the buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  void      getReport(char *report, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that touches every page of a buffer, so that the first transaction does not fault it in
+  /// @param buffer Buffer
+  /// @param length Length of the buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  static void prefault(void *buffer, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that measures how late the calling thread wakes up in a periodic loop
+  /// @description The function sleeps until the start of each period on the monotonic clock, and records
+  /// @description the time from the start of the period until the thread runs.
+  /// @param period_ns Period of the loop
+  /// @param count Number of periods
+  /// @return Statistics of the latency
+  ////////////////////////////////////////////////////////////////////////////////
+  static JitterStats measureJitter(int64_t period_ns, int count);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_REALTIMEPROFILE_H_ */
@@ -0,0 +1,74 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for the virtual time which the simulated ports can run on
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_VIRTUALCLOCK_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_VIRTUALCLOCK_H_
+
+
+#include "port_handler.h"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the time which only moves when the port waits for it
+/// @description A PortHandlerSim with a VirtualClock set by PortHandler::setClock() skips its waits for the bytes
+/// @description and the packet timeouts, so that a scan or a run of transactions takes no longer than its computation,
+/// @description while the time measured on the port is the time the packets take on the simulated wire.
+/// @description A clock can be shared by the ports of a SimulatedBus, from any number of threads.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC VirtualClock : public PortClock
+{
+ public:
+  static const int64_t DEFAULT_START_NS_ = 1000000000LL;  ///< Time the clock starts at, so that no time is 0
+
+ private:
+  int64_t   now_ns_;
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes the clock
+  /// @param start_ns Time the clock starts at
+  ////////////////////////////////////////////////////////////////////////////////
+  VirtualClock(int64_t start_ns = DEFAULT_START_NS_);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the current virtual time in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  int64_t   getMonotonicNs();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that moves the clock forward to time_ns without waiting
+  /// @description The clock never moves back, so that a time before the current time leaves it as it is.
+  /// @param time_ns Time to move to
+  ////////////////////////////////////////////////////////////////////////////////
+  void      sleepUntil(int64_t time_ns);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that moves the clock forward by nsec
+  /// @param nsec Time to move by, which is ignored when it is negative
+  ////////////////////////////////////////////////////////////////////////////////
+  void      advance(int64_t nsec);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_VIRTUALCLOCK_H_ */
@@ -0,0 +1,210 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include "baud_scanner.h"
+#elif defined(__APPLE__)
+#include "baud_scanner.h"
+#elif defined(_WIN32) || defined(_WIN64)
+#define WINDLLEXPORT
+#include "baud_scanner.h"
+#elif defined(ARDUINO) || defined(__OPENCR__) || defined(__OPENCM904__)
+#include "../../include/dynamixel_sdk/baud_scanner.h"
+#endif
+
+#define PING1_LENGTH    6     // HEADER0 HEADER1 ID LENGTH INSTRUCTION CHKSUM
+#define STATUS1_LENGTH  6     // HEADER0 HEADER1 ID LENGTH ERROR CHKSUM
+#define PING2_LENGTH    10    // HEADER0 HEADER1 HEADER2 RESERVED ID LENGTH_L LENGTH_H INST CRC16_L CRC16_H
+#define STATUS2_LENGTH  14    // ... ERROR MODEL_L MODEL_H FIRMWARE CRC16_L CRC16_H
+
+using namespace dynamixel;
+
+// the baudrates of Dynamixel, from the most common one
+static const int baudrate_list[] =
+{
+  57600, 1000000, 115200, 9600, 2000000, 3000000, 4000000, 4500000,
+  19200, 38400, 200000, 250000, 400000, 500000, 2250000, 2500000
+};
+
+static void receive(PortHandler *port, std::vector<uint8_t> &rxpacket, int *rx_length)
+{
+  // take everything the port receives until the packet deadline
+  while (port->isPacketTimeout() == false)
+  {
+    if (*rx_length < (int)rxpacket.size())
+    {
+      int length = port->readPort(&rxpacket[*rx_length], (int)rxpacket.size() - *rx_length);
+      if (length > 0)
+        *rx_length += length;
+    }
+    port->waitPort();
+  }
+}
+
+BaudScanner::BaudScanner(PortHandler *port)
+  : port_(port),
+    packet_handler_(PacketHandler::getPacketHandler(2.0)),
+    baudrates_(baudrate_list, baudrate_list + sizeof(baudrate_list) / sizeof(baudrate_list[0])),
+    protocol1_(true),
+    protocol2_(true),
+    max_id_(MAX_ID),
+    return_delay_us_(DEFAULT_RETURN_DELAY_),
+    stop_at_first_(false)
+{
+}
+
+void BaudScanner::setProtocols(bool protocol1, bool protocol2)
+{
+  protocol1_ = protocol1;
+  protocol2_ = protocol2;
+}
+
+void BaudScanner::setMaxID(uint8_t max_id)
+{
+  max_id_ = (max_id > MAX_ID) ? MAX_ID : max_id;
+}
+
+int64_t BaudScanner::getWireNs(int length)
+{
+  // 10 bits a byte (start bit, 8 data bits and stop bit)
+  return (int64_t)length * 10000000000LL / port_->getBaudRate();
+}
+
+int BaudScanner::scan(std::vector<BaudScanResult> &results)
+{
+  results.clear();
+
+  PortTransaction transaction(port_);
+  if (transaction.isLocked() == false)
+    return COMM_PORT_BUSY;
+
+  int baudrate = port_->getBaudRate();
+
+  for (unsigned int i = 0; i < baudrates_.size(); i++)
+  {
+    if (port_->setBaudRate(baudrates_[i]) == false)
+      continue;
+
+    for (int protocol = 2; protocol >= 1; protocol--)
+    {
+      BaudScanResult result;
+      result.baudrate         = baudrates_[i];
+      result.protocol_version = (float)protocol;
+
+      if (protocol == 2 && protocol2_)
+        scanProtocol2(result.id_list);
+      else if (protocol == 1 && protocol1_)
+        scanProtocol1(result.id_list);
+
+      if (result.id_list.size() > 0)
+        results.push_back(result);
+    }
+
+    if (stop_at_first_ && results.size() > 0)
+      break;
+  }
+
+  port_->setBaudRate(baudrate);
+  return (results.size() > 0) ? COMM_SUCCESS : COMM_RX_TIMEOUT;
+}
+
+void BaudScanner::scanProtocol2(std::vector<uint8_t> &id_list)
+{
+  uint8_t txpacket[PING2_LENGTH] = {0};
+  uint8_t rxpacket[STATUS2_LENGTH * 2] = {0};
+
+  txpacket[4] = BROADCAST_ID;   // ID
+  txpacket[5] = 3;              // LENGTH_L
+  txpacket[6] = 0;              // LENGTH_H
+  txpacket[7] = INST_PING;      // INSTRUCTION
+
+  if (packet_handler_->txPacket(port_, txpacket) != COMM_SUCCESS)
+  {
+    port_->endTransaction();
+    return;
+  }
+
+  // the Dynamixels answer in order of ID, each after the status packet of the previous one and its return delay time
+  port_->setPacketTimeout((uint16_t)(STATUS2_LENGTH * (max_id_ + 1)));
+  port_->setPacketDeadline(port_->getPacketDeadline() + (int64_t)(max_id_ + 1) * return_delay_us_ * 1000LL);
+
+  // rxPacket() takes one status packet at a time, and leaves the next one in the port
+  while (port_->isPacketTimeout() == false)
+  {
+    if (packet_handler_->rxPacket(port_, rxpacket) == COMM_SUCCESS && rxpacket[7] == INST_STATUS)
+      id_list.push_back(rxpacket[4]);
+  }
+  port_->endTransaction();
+
+  std::sort(id_list.begin(), id_list.end());
+  id_list.erase(std::unique(id_list.begin(), id_list.end()), id_list.end());
+}
+
+void BaudScanner::scanProtocol1(std::vector<uint8_t> &id_list)
+{
+  std::vector<uint8_t> rxpacket((max_id_ + 1) * STATUS1_LENGTH * 2);
+  int     rx_length = 0;
+
+  // a ping is sent when the status packet of the previous one would be over on the wire,
+  // so that the pings are not held back by the latency of the port
+  int64_t interval  = getWireNs(PING1_LENGTH + STATUS1_LENGTH * 2) + (int64_t)return_delay_us_ * 1000LL;
+  int64_t next      = port_->getMonotonicNs();
+
+  port_->clearPort();
+  for (int id = 0; id <= max_id_; id++)
+  {
+    uint8_t txpacket[PING1_LENGTH];
+    txpacket[0] = 0xFF;
+    txpacket[1] = 0xFF;
+    txpacket[2] = (uint8_t)id;
+    txpacket[3] = 2;
+    txpacket[4] = INST_PING;
+    txpacket[5] = ~(uint8_t)(id + 2 + INST_PING);
+
+    port_->setPacketDeadline(next);
+    receive(port_, rxpacket, &rx_length);
+
+    if (port_->writePort(txpacket, PING1_LENGTH) != PING1_LENGTH)
+      return;
+    next = port_->getMonotonicNs() + interval;
+  }
+
+  // the status packet of the last ping
+  port_->setPacketTimeout((uint16_t)STATUS1_LENGTH);
+  port_->setPacketDeadline(port_->getPacketDeadline() + (int64_t)return_delay_us_ * 1000LL);
+  receive(port_, rxpacket, &rx_length);
+
+  // status packets of ping have no parameter
+  for (int idx = 0; idx + STATUS1_LENGTH <= rx_length; idx++)
+  {
+    if (rxpacket[idx] != 0xFF || rxpacket[idx + 1] != 0xFF || rxpacket[idx + 2] > MAX_ID || rxpacket[idx + 3] != 2)
+      continue;
+
+    uint8_t checksum = 0;
+    for (int i = 2; i < STATUS1_LENGTH - 1; i++)
+      checksum += rxpacket[idx + i];
+    if ((uint8_t)~checksum != rxpacket[idx + STATUS1_LENGTH - 1])
+      continue;
+
+    id_list.push_back(rxpacket[idx + 2]);
+    idx += STATUS1_LENGTH - 1;
+  }
+
+  std::sort(id_list.begin(), id_list.end());
+  id_list.erase(std::unique(id_list.begin(), id_list.end()), id_list.end());
+}
@@ -0,0 +1,402 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "port_broker.h"
+
+#define BROKER_IDLE_POLL    100     // msec to wait for the clients while no client has the bus
+#define BROKER_QUEUE_POLL   1       // msec to wait for the port taken by the process of the broker
+#define BROKER_BUS_WAIT     0.1     // msec to wait for the bus at a time, before the clients are checked again
+
+#if defined(MSG_NOSIGNAL)
+#define SEND_FLAGS  MSG_NOSIGNAL
+#else
+#define SEND_FLAGS  0
+#endif
+
+using namespace dynamixel;
+
+PortBroker::PortBroker(PortHandler *port, const char *socket_path)
+  : port_(port),
+    listen_fd_(-1),
+    holder_(-1),
+    hold_start_ns_(0),
+    hold_limit_ns_((int64_t)DEFAULT_HOLD_LIMIT_ * 1000000LL),
+    sequence_(0),
+    running_(false),
+    client_count_(0),
+    holds_(0),
+    writes_(0),
+    expired_holds_(0),
+    max_queue_ns_(0)
+{
+  strncpy(socket_path_, socket_path, sizeof(socket_path_) - 1);
+  socket_path_[sizeof(socket_path_) - 1] = 0;
+
+  for (int i = 0; i < MAX_CLIENTS_; i++)
+    clients_[i].fd = -1;
+}
+
+PortBroker::~PortBroker()
+{
+  stop();
+}
+
+bool PortBroker::start()
+{
+  if (running_)
+    return true;
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path_);
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0)
+    return false;
+
+  // the socket file of a broker which stopped
+  unlink(socket_path_);
+  if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd_, MAX_CLIENTS_) != 0)
+  {
+    printf("[PortBroker::start] Error creating the socket : %s\n", socket_path_);
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  running_ = true;
+  if (pthread_create(&thread_, 0, brokerThread, this) != 0)
+  {
+    running_ = false;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(socket_path_);
+    return false;
+  }
+  return true;
+}
+
+void PortBroker::stop()
+{
+  if (running_ == false)
+    return;
+
+  __atomic_store_n(&running_, false, __ATOMIC_RELEASE);
+  pthread_join(thread_, 0);
+
+  for (int i = 0; i < MAX_CLIENTS_; i++)
+  {
+    if (clients_[i].fd != -1)
+      disconnect(i);
+  }
+  close(listen_fd_);
+  listen_fd_ = -1;
+  unlink(socket_path_);
+}
+
+bool PortBroker::isRunning()
+{
+  return __atomic_load_n(&running_, __ATOMIC_ACQUIRE);
+}
+
+PortBrokerStats PortBroker::getStats()
+{
+  PortBrokerStats stats;
+  stats.clients       = __atomic_load_n(&client_count_, __ATOMIC_ACQUIRE);
+  stats.holds         = __atomic_load_n(&holds_, __ATOMIC_ACQUIRE);
+  stats.writes        = __atomic_load_n(&writes_, __ATOMIC_ACQUIRE);
+  stats.expired_holds = __atomic_load_n(&expired_holds_, __ATOMIC_ACQUIRE);
+  stats.max_queue_ns  = __atomic_load_n(&max_queue_ns_, __ATOMIC_ACQUIRE);
+  return stats;
+}
+
+void *PortBroker::brokerThread(void *broker)
+{
+  ((PortBroker *)broker)->run();
+  return 0;
+}
+
+void PortBroker::run()
+{
+  struct pollfd pfd[MAX_CLIENTS_ + 1];
+  int           index[MAX_CLIENTS_ + 1];
+
+  while (__atomic_load_n(&running_, __ATOMIC_ACQUIRE))
+  {
+    if (holder_ < 0)
+      grant();
+
+    int count = 0;
+    pfd[count].fd       = listen_fd_;
+    pfd[count].events   = POLLIN;
+    pfd[count].revents  = 0;
+    index[count++]      = -1;
+
+    bool pending = false;
+    for (int i = 0; i < MAX_CLIENTS_; i++)
+    {
+      if (clients_[i].fd == -1)
+        continue;
+      pending = pending || clients_[i].pending;
+
+      pfd[count].fd       = clients_[i].fd;
+      pfd[count].events   = POLLIN;
+      pfd[count].revents  = 0;
+      index[count++]      = i;
+    }
+
+    // the bus is watched while a client has it, and the clients are checked between the waits for it
+    int timeout = (holder_ >= 0) ? 0 : (pending ? BROKER_QUEUE_POLL : BROKER_IDLE_POLL);
+    if (poll(pfd, count, timeout) > 0)
+    {
+      for (int i = 0; i < count; i++)
+      {
+        if (pfd[i].revents == 0)
+          continue;
+        // a client disconnected by a frame of another one
+        if (index[i] >= 0 && clients_[index[i]].fd != pfd[i].fd)
+          continue;
+        if (index[i] < 0)
+          accept();
+        else if (receive(index[i]) == false)
+          disconnect(index[i]);
+      }
+    }
+
+    if (holder_ < 0)
+      continue;
+
+    forward();
+    if (holder_ >= 0 && port_->getMonotonicNs() - hold_start_ns_ > hold_limit_ns_)
+    {
+      __atomic_store_n(&expired_holds_, expired_holds_ + 1, __ATOMIC_RELEASE);
+      release();
+    }
+  }
+
+  if (holder_ >= 0)
+    release();
+}
+
+void PortBroker::accept()
+{
+  int fd = ::accept(listen_fd_, 0, 0);
+  if (fd < 0)
+    return;
+
+  for (int i = 0; i < MAX_CLIENTS_; i++)
+  {
+    if (clients_[i].fd != -1)
+      continue;
+
+#if defined(SO_NOSIGPIPE)
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    clients_[i].fd            = fd;
+    clients_[i].frame_length  = 0;
+    clients_[i].pending       = false;
+    __atomic_store_n(&client_count_, client_count_ + 1, __ATOMIC_RELEASE);
+
+    uint8_t info[4];
+    int     baudrate = port_->getBaudRate();
+    for (int b = 0; b < 4; b++)
+      info[b] = (uint8_t)(baudrate >> (8 * b));
+    send(i, BROKER_INFO, info, 4);
+    return;
+  }
+
+  // no place for another client
+  close(fd);
+}
+
+void PortBroker::disconnect(int client)
+{
+  if (holder_ == client)
+    release();
+
+  close(clients_[client].fd);
+  clients_[client].fd       = -1;
+  clients_[client].pending  = false;
+  __atomic_store_n(&client_count_, client_count_ - 1, __ATOMIC_RELEASE);
+}
+
+bool PortBroker::receive(int client)
+{
+  Client *c = &clients_[client];
+
+  int length = recv(c->fd, &c->frame[c->frame_length], BROKER_FRAME_MAX - c->frame_length, MSG_DONTWAIT);
+  if (length == 0)
+    return false;
+  if (length < 0)
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+  c->frame_length += length;
+
+  // the frames received whole
+  int index = 0;
+  while (c->frame_length - index >= BROKER_FRAME_HEADER)
+  {
+    int type          = c->frame[index];
+    int frame_length  = BROKER_FRAME_HEADER + (c->frame[index + 2] | (c->frame[index + 3] << 8));
+    if (frame_length > BROKER_FRAME_MAX)
+      return false;
+    if (c->frame_length - index < frame_length)
+      break;
+
+    handleFrame(client, type, &c->frame[index + BROKER_FRAME_HEADER], frame_length - BROKER_FRAME_HEADER);
+    if (c->fd == -1)
+      return true;
+    index += frame_length;
+  }
+
+  memmove(c->frame, &c->frame[index], c->frame_length - index);
+  c->frame_length -= index;
+  return true;
+}
+
+void PortBroker::handleFrame(int client, int type, uint8_t *payload, int length)
+{
+  Client *c = &clients_[client];
+
+  switch (type)
+  {
+    case BROKER_WRITE:
+      if (length < 1)
+        break;
+      if (holder_ == client)
+      {
+        write(client, &payload[1], length - 1);
+        break;
+      }
+      c->pending        = true;
+      c->priority       = payload[0];
+      c->sequence       = sequence_++;
+      c->queued_ns      = port_->getMonotonicNs();
+      c->packet_length  = length - 1;
+      memcpy(c->packet, &payload[1], length - 1);
+      break;
+
+    case BROKER_CLEAR:
+      if (holder_ == client)
+        port_->clearPort();
+      break;
+
+    case BROKER_RELEASE:
+      if (holder_ == client)
+        release();
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool PortBroker::send(int client, int type, const uint8_t *payload, int length)
+{
+  uint8_t frame[BROKER_FRAME_MAX];
+
+  if (length > BROKER_FRAME_MAX - BROKER_FRAME_HEADER)
+    return false;
+
+  frame[0] = (uint8_t)type;
+  frame[1] = 0;
+  frame[2] = (uint8_t)(length & 0xFF);
+  frame[3] = (uint8_t)(length >> 8);
+  memcpy(&frame[BROKER_FRAME_HEADER], payload, length);
+
+  return (::send(clients_[client].fd, frame, BROKER_FRAME_HEADER + length, SEND_FLAGS) == BROKER_FRAME_HEADER + length);
+}
+
+void PortBroker::grant()
+{
+  int next = -1;
+
+  // the highest priority, and the longest wait among the same priority
+  for (int i = 0; i < MAX_CLIENTS_; i++)
+  {
+    if (clients_[i].fd == -1 || clients_[i].pending == false)
+      continue;
+    if (next < 0 || clients_[i].priority > clients_[next].priority ||
+        (clients_[i].priority == clients_[next].priority && clients_[i].sequence < clients_[next].sequence))
+      next = i;
+  }
+  if (next < 0)
+    return;
+
+  // the threads of the process of the broker have the port
+  if (port_->tryLockPort() == false)
+    return;
+
+  holder_         = next;
+  hold_start_ns_  = port_->getMonotonicNs();
+  clients_[next].pending = false;
+
+  int64_t queue_ns = hold_start_ns_ - clients_[next].queued_ns;
+  __atomic_store_n(&holds_, holds_ + 1, __ATOMIC_RELEASE);
+  if (queue_ns > max_queue_ns_)
+    __atomic_store_n(&max_queue_ns_, queue_ns, __ATOMIC_RELEASE);
+
+  // the bytes left on the bus belong to no client
+  port_->clearPort();
+  write(next, clients_[next].packet, clients_[next].packet_length);
+}
+
+void PortBroker::release()
+{
+  holder_ = -1;
+  port_->unlockPort();
+}
+
+void PortBroker::write(int client, uint8_t *packet, int length)
+{
+  uint8_t result[4];
+  int     written = port_->writePort(packet, length);
+
+  __atomic_store_n(&writes_, writes_ + 1, __ATOMIC_RELEASE);
+  for (int b = 0; b < 4; b++)
+    result[b] = (uint8_t)(written >> (8 * b));
+  if (send(client, BROKER_WRITTEN, result, 4) == false)
+    disconnect(client);
+}
+
+void PortBroker::forward()
+{
+  uint8_t data[BROKER_FRAME_MAX - BROKER_FRAME_HEADER];
+
+  if (port_->getBytesAvailable() == 0)
+  {
+    port_->setPacketTimeout(BROKER_BUS_WAIT);
+    port_->waitPort();
+  }
+
+  int length = port_->readPort(data, sizeof(data));
+  if (length > 0 && send(holder_, BROKER_DATA, data, length) == false)
+    disconnect(holder_);
+}
+
+#endif
@@ -0,0 +1,394 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "port_handler_broker.h"
+
+#define LATENCY_TIMER   16    // msec (latency timer of the USB serial, as PortHandlerLinux)
+#define CONNECT_TIMEOUT 1000  // msec to wait for the baudrate from the broker
+#define MAX_WRITE_SEGMENTS  8 // segments sent in a frame by PortHandlerBroker::writePortV()
+
+#if defined(MSG_NOSIGNAL)
+#define SEND_FLAGS  MSG_NOSIGNAL
+#else
+#define SEND_FLAGS  0
+#endif
+
+using namespace dynamixel;
+
+PortHandlerBroker::PortHandlerBroker(const char *port_name)
+  : socket_fd_(-1),
+    baudrate_(DEFAULT_BAUDRATE_),
+    priority_(DEFAULT_PRIORITY_),
+    holding_(false),
+    tx_time_per_byte(0.0),
+    frame_length_(0),
+    written_(false),
+    written_result_(0),
+    rx_head_(0),
+    rx_tail_(0)
+{
+  is_using_ = false;
+  setPortName(port_name);
+}
+
+bool PortHandlerBroker::openPort()
+{
+  closePort();
+
+  const char *path = port_name_;
+  if (strncmp(path, BROKER_PORT_PREFIX, strlen(BROKER_PORT_PREFIX)) == 0)
+    path += strlen(BROKER_PORT_PREFIX);
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+  socket_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket_fd_ < 0 || connect(socket_fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    printf("[PortHandlerBroker::openPort] Error connecting to the broker : %s\n", path);
+    closePort();
+    return false;
+  }
+#if defined(SO_NOSIGPIPE)
+  int on = 1;
+  setsockopt(socket_fd_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  // the broker sends the baudrate of the bus first
+  baudrate_ = 0;
+  while (baudrate_ == 0)
+  {
+    if (receive(CONNECT_TIMEOUT) == false || socket_fd_ == -1)
+    {
+      printf("[PortHandlerBroker::openPort] No answer from the broker : %s\n", path);
+      closePort();
+      return false;
+    }
+  }
+  tx_time_per_byte = (1000.0 / (double)baudrate_) * 10.0;
+  return true;
+}
+
+void PortHandlerBroker::closePort()
+{
+  if (socket_fd_ != -1)
+    close(socket_fd_);
+  socket_fd_    = -1;
+  holding_      = false;
+  frame_length_ = 0;
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+}
+
+void PortHandlerBroker::clearPort()
+{
+  receive(0);
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+
+  if (holding_)
+    sendFrame(BROKER_CLEAR, 0, 0);
+}
+
+void PortHandlerBroker::setPortName(const char *port_name)
+{
+  strncpy(port_name_, port_name, sizeof(port_name_) - 1);
+  port_name_[sizeof(port_name_) - 1] = 0;
+}
+
+char *PortHandlerBroker::getPortName()
+{
+  return port_name_;
+}
+
+bool PortHandlerBroker::setBaudRate(const int baudrate)
+{
+  if (socket_fd_ == -1)
+  {
+    baudrate_ = baudrate;
+    tx_time_per_byte = (1000.0 / (double)baudrate_) * 10.0;
+    return true;
+  }
+  if (baudrate != baudrate_)
+  {
+    printf("[PortHandlerBroker::setBaudRate] The baudrate of the bus is %d, which is set by the broker\n", baudrate_);
+    return false;
+  }
+  return true;
+}
+
+int PortHandlerBroker::getBaudRate()
+{
+  return baudrate_;
+}
+
+bool PortHandlerBroker::setOption(const char *key, const char *value)
+{
+  if (strcmp(key, "baud") == 0)
+  {
+    if (atoi(value) <= 0)
+      return false;
+    return setBaudRate(atoi(value));
+  }
+  if (strcmp(key, "priority") == 0)
+  {
+    if (atoi(value) < 0 || atoi(value) > 255)
+      return false;
+    setPriority(atoi(value));
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
+bool PortHandlerBroker::sendFrame(int type, PortSegment *segments, int count)
+{
+  uint8_t frame[BROKER_FRAME_MAX];
+  int     length = BROKER_FRAME_HEADER;
+
+  if (socket_fd_ == -1)
+    return false;
+
+  for (int i = 0; i < count; i++)
+  {
+    if (length + segments[i].length > BROKER_FRAME_MAX)
+      return false;
+    memcpy(&frame[length], segments[i].data, segments[i].length);
+    length += segments[i].length;
+  }
+  frame[0] = (uint8_t)type;
+  frame[1] = 0;
+  frame[2] = (uint8_t)((length - BROKER_FRAME_HEADER) & 0xFF);
+  frame[3] = (uint8_t)((length - BROKER_FRAME_HEADER) >> 8);
+
+  countIo(&io_stats_.writes);
+  if (send(socket_fd_, frame, length, SEND_FLAGS) != length)
+  {
+    closePort();
+    return false;
+  }
+  return true;
+}
+
+bool PortHandlerBroker::receive(int timeout_ms)
+{
+  struct pollfd pfd;
+
+  if (socket_fd_ == -1)
+    return false;
+
+  pfd.fd      = socket_fd_;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, timeout_ms) <= 0)
+    return (timeout_ms == 0);
+
+  int length = recv(socket_fd_, &frame_[frame_length_], BROKER_FRAME_MAX - frame_length_, MSG_DONTWAIT);
+  countIo(&io_stats_.reads);
+  if (length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+  {
+    printf("[PortHandlerBroker::receive] Connection to the broker is closed\n");
+    closePort();
+    return false;
+  }
+  if (length < 0)
+    return true;
+  frame_length_ += length;
+
+  int index = 0;
+  while (frame_length_ - index >= BROKER_FRAME_HEADER)
+  {
+    int      type     = frame_[index];
+    int      payload  = frame_[index + 2] | (frame_[index + 3] << 8);
+    uint8_t *data     = &frame_[index + BROKER_FRAME_HEADER];
+    if (frame_length_ - index < BROKER_FRAME_HEADER + payload)
+      break;
+
+    if (type == BROKER_DATA)
+    {
+      if (rx_head_ > 0)
+      {
+        memmove(rx_buffer_, &rx_buffer_[rx_head_], rx_tail_ - rx_head_);
+        rx_tail_ -= rx_head_;
+        rx_head_ = 0;
+      }
+      int copy = (payload < RX_BUFFER_SIZE_ - rx_tail_) ? payload : RX_BUFFER_SIZE_ - rx_tail_;
+      memcpy(&rx_buffer_[rx_tail_], data, copy);
+      rx_tail_ += copy;
+      countIo(&io_stats_.bytes_in, copy);
+    }
+    else if ((type == BROKER_INFO || type == BROKER_WRITTEN) && payload == 4)
+    {
+      int value = (int)(data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+      if (type == BROKER_INFO)
+      {
+        baudrate_ = value;
+      }
+      else
+      {
+        written_        = true;
+        written_result_ = value;
+      }
+    }
+    index += BROKER_FRAME_HEADER + payload;
+  }
+
+  memmove(frame_, &frame_[index], frame_length_ - index);
+  frame_length_ -= index;
+  return true;
+}
+
+int PortHandlerBroker::getBytesAvailable()
+{
+  // the socket is read only when the buffered bytes are none, or all peeked already
+  if (rx_tail_ - rx_head_ <= peek_length_)
+    receive(0);
+  return rx_tail_ - rx_head_;
+}
+
+int PortHandlerBroker::readPort(uint8_t *packet, int length)
+{
+  int arrived = getBytesAvailable();
+
+  if (length > arrived)
+    length = arrived;
+
+  memcpy(packet, &rx_buffer_[rx_head_], length);
+  consumePort(length);
+  return length;
+}
+
+int PortHandlerBroker::writePort(uint8_t *packet, int length)
+{
+  PortSegment segment;
+
+  segment.data    = packet;
+  segment.length  = length;
+  return writePortV(&segment, 1);
+}
+
+int PortHandlerBroker::writePortV(PortSegment *segments, int count)
+{
+  uint8_t     priority = (uint8_t)priority_;
+  PortSegment frame[1 + MAX_WRITE_SEGMENTS];
+
+  if (count > MAX_WRITE_SEGMENTS)
+    return PortHandler::writePortV(segments, count);
+
+  frame[0].data   = &priority;
+  frame[0].length = 1;
+  for (int i = 0; i < count; i++)
+    frame[1 + i] = segments[i];
+
+  written_ = false;
+  if (sendFrame(BROKER_WRITE, frame, 1 + count) == false)
+    return -1;
+
+  // the broker answers when the bus is given to the port, and the packet is written on it
+  while (written_ == false)
+  {
+    if (receive(-1) == false)
+      return -1;
+  }
+  holding_ = true;
+
+  if (written_result_ > 0)
+    countIo(&io_stats_.bytes_out, written_result_);
+  return written_result_;
+}
+
+int PortHandlerBroker::peekPort(uint8_t **data)
+{
+  peek_length_ = getBytesAvailable();
+
+  *data = &rx_buffer_[rx_head_];
+  return peek_length_;
+}
+
+void PortHandlerBroker::consumePort(int length)
+{
+  rx_head_ += (length < rx_tail_ - rx_head_) ? length : rx_tail_ - rx_head_;
+  peek_length_ = 0;
+  if (rx_head_ >= rx_tail_)
+    rx_head_ = rx_tail_ = 0;
+}
+
+bool PortHandlerBroker::waitPort()
+{
+  int64_t start = getMonotonicNs();
+
+  while (rx_tail_ - rx_head_ <= peek_length_)
+  {
+    int64_t remaining = getRemainingNs();
+    if (remaining <= 0 || socket_fd_ == -1)
+    {
+      addWaitSample(start, false, false);
+      return false;
+    }
+
+    int64_t blocked = getMonotonicNs();
+    bool    result  = receive((int)((remaining + 999999LL) / 1000000LL));
+    countIo(&io_stats_.blocked_ns, (uint64_t)(getMonotonicNs() - blocked));
+    if (result == false)
+    {
+      addWaitSample(start, false, false);
+      return false;
+    }
+  }
+  addWaitSample(start, true, false);
+  return true;
+}
+
+void PortHandlerBroker::setPacketTimeout(uint16_t packet_length)
+{
+  double msec = (tx_time_per_byte * (double)packet_length) + (LATENCY_TIMER * 2.0) + 2.0;
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+void PortHandlerBroker::setPacketTimeout(double msec)
+{
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+bool PortHandlerBroker::isPacketTimeout()
+{
+  return (getRemainingNs() < 0);
+}
+
+void PortHandlerBroker::setPacketDeadline(int64_t deadline_ns)
+{
+  packet_deadline_ns_ = deadline_ns;
+}
+
+void PortHandlerBroker::releasePort()
+{
+  if (holding_)
+    sendFrame(BROKER_RELEASE, 0, 0);
+  holding_ = false;
+}
+
+#endif
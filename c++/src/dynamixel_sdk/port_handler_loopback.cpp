@@ -0,0 +1,431 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include "port_handler_loopback.h"
+
+#define LOOPBACK_PACKET_MAX_LEN   LoopbackRing::SIZE_
+#define LOOPBACK_SPIN_COUNT       1000    // polls of the idle bus thread before it starts to sleep
+#define LOOPBACK_IDLE_SLEEP       50000   // nsec
+#define LOOPBACK_WRITE_TIMEOUT    100     // msec the port waits for the peer to take the bytes written
+
+using namespace dynamixel;
+
+static std::vector<LoopbackChannel *> channel_list;
+
+int LoopbackRing::write(const uint8_t *data, int length)
+{
+  uint32_t tail = tail_;
+  uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  int      room = SIZE_ - (int)(tail - head);
+
+  if (length > room)
+    length = room;
+
+  int index = (int)(tail & (SIZE_ - 1));
+  int first = (length < SIZE_ - index) ? length : SIZE_ - index;
+  memcpy(&buffer_[index], data, first);
+  memcpy(buffer_, data + first, length - first);
+
+  __atomic_store_n(&tail_, tail + length, __ATOMIC_RELEASE);
+  return length;
+}
+
+int LoopbackRing::writeV(PortSegment *segments, int count)
+{
+  uint32_t tail = tail_;
+  uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  int      length = 0;
+
+  for (int i = 0; i < count; i++)
+    length += segments[i].length;
+  if (length > SIZE_ - (int)(tail - head))
+    return -1;
+
+  for (int i = 0; i < count; i++)
+  {
+    int index = (int)(tail & (SIZE_ - 1));
+    int first = (segments[i].length < SIZE_ - index) ? segments[i].length : SIZE_ - index;
+    memcpy(&buffer_[index], segments[i].data, first);
+    memcpy(buffer_, segments[i].data + first, segments[i].length - first);
+    tail += segments[i].length;
+  }
+
+  __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE);
+  return length;
+}
+
+int LoopbackRing::getRoom()
+{
+  return SIZE_ - (int)(tail_ - __atomic_load_n(&head_, __ATOMIC_ACQUIRE));
+}
+
+int LoopbackRing::getAvailable()
+{
+  return (int)(__atomic_load_n(&tail_, __ATOMIC_ACQUIRE) - head_);
+}
+
+int LoopbackRing::read(uint8_t *data, int length)
+{
+  int available = getAvailable();
+  if (length > available)
+    length = available;
+
+  int index = (int)(head_ & (SIZE_ - 1));
+  int first = (length < SIZE_ - index) ? length : SIZE_ - index;
+  memcpy(data, &buffer_[index], first);
+  memcpy(data + first, buffer_, length - first);
+
+  consume(length);
+  return length;
+}
+
+int LoopbackRing::peek(uint8_t **data)
+{
+  int available = getAvailable();
+  int index     = (int)(head_ & (SIZE_ - 1));
+
+  if (available <= SIZE_ - index)
+  {
+    *data = &buffer_[index];
+    return available;
+  }
+
+  // a packet across the end of the buffer is parsed as a whole
+  memcpy(peek_buffer_, &buffer_[index], SIZE_ - index);
+  memcpy(&peek_buffer_[SIZE_ - index], buffer_, available - (SIZE_ - index));
+  *data = peek_buffer_;
+  return available;
+}
+
+void LoopbackRing::consume(int length)
+{
+  int available = getAvailable();
+  if (length > available)
+    length = available;
+
+  __atomic_store_n(&head_, head_ + length, __ATOMIC_RELEASE);
+}
+
+void LoopbackRing::clear()
+{
+  __atomic_store_n(&head_, __atomic_load_n(&tail_, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+LoopbackChannel *LoopbackChannel::getChannel(const char *name)
+{
+  for (unsigned int i = 0; i < channel_list.size(); i++)
+  {
+    if (strcmp(channel_list[i]->getName(), name) == 0)
+      return channel_list[i];
+  }
+
+  LoopbackChannel *channel = new LoopbackChannel(name);
+  channel_list.push_back(channel);
+  return channel;
+}
+
+void LoopbackChannel::removeChannel(const char *name)
+{
+  for (unsigned int i = 0; i < channel_list.size(); i++)
+  {
+    if (strcmp(channel_list[i]->getName(), name) == 0)
+    {
+      delete channel_list[i];
+      channel_list.erase(channel_list.begin() + i);
+      return;
+    }
+  }
+}
+
+LoopbackChannel::LoopbackChannel(const char *name)
+  : baudrate_(PortHandler::DEFAULT_BAUDRATE_),
+    bus_(0),
+    bus_running_(false)
+{
+  strncpy(name_, name, sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = 0;
+}
+
+LoopbackChannel::~LoopbackChannel()
+{
+  detachBus();
+}
+
+void LoopbackChannel::setBaudRate(int baudrate)
+{
+  __atomic_store_n(&baudrate_, baudrate, __ATOMIC_RELEASE);
+}
+
+int LoopbackChannel::getBaudRate()
+{
+  return __atomic_load_n(&baudrate_, __ATOMIC_ACQUIRE);
+}
+
+bool LoopbackChannel::attachBus(SimulatedBus *bus)
+{
+  detachBus();
+
+  bus_ = bus;
+  bus_running_ = true;
+  if (pthread_create(&bus_thread_, 0, busThread, this) != 0)
+  {
+    bus_running_ = false;
+    bus_ = 0;
+    return false;
+  }
+  return true;
+}
+
+void LoopbackChannel::detachBus()
+{
+  if (bus_running_)
+  {
+    __atomic_store_n(&bus_running_, false, __ATOMIC_RELEASE);
+    pthread_join(bus_thread_, 0);
+  }
+  bus_ = 0;
+}
+
+void *LoopbackChannel::busThread(void *channel)
+{
+  ((LoopbackChannel *)channel)->serveBus();
+  return 0;
+}
+
+void LoopbackChannel::serveBus()
+{
+  uint8_t  *packet    = (uint8_t *)malloc(LOOPBACK_PACKET_MAX_LEN);
+  uint8_t  *response  = (uint8_t *)malloc(LOOPBACK_PACKET_MAX_LEN);
+  int64_t  *arrival   = (int64_t *)malloc(LOOPBACK_PACKET_MAX_LEN * sizeof(int64_t));
+  int       idle      = 0;
+
+  while (__atomic_load_n(&bus_running_, __ATOMIC_ACQUIRE))
+  {
+    int length = to_peer_.read(packet, LOOPBACK_PACKET_MAX_LEN);
+    if (length == 0)
+    {
+      // spin while the port is busy, and sleep when it is not
+      if (++idle < LOOPBACK_SPIN_COUNT)
+      {
+        sched_yield();
+      }
+      else
+      {
+        struct timespec ts;
+        ts.tv_sec  = 0;
+        ts.tv_nsec = LOOPBACK_IDLE_SLEEP;
+        nanosleep(&ts, NULL);
+      }
+      continue;
+    }
+    idle = 0;
+
+    // the time the status packets arrive is not used; they are written back at once
+    int response_length = bus_->transfer(packet, length, getBaudRate(), 0, response, arrival, LOOPBACK_PACKET_MAX_LEN);
+    int written = 0;
+    while (written < response_length && __atomic_load_n(&bus_running_, __ATOMIC_ACQUIRE))
+    {
+      int n = to_host_.write(&response[written], response_length - written);
+      if (n == 0)
+        sched_yield();
+      written += n;
+    }
+  }
+
+  free(packet);
+  free(response);
+  free(arrival);
+}
+
+PortHandlerLoopback::PortHandlerLoopback(const char *port_name)
+  : channel_(0),
+    baudrate_(DEFAULT_BAUDRATE_),
+    tx_time_per_byte(0.0)
+{
+  is_using_ = false;
+  setPortName(port_name);
+}
+
+bool PortHandlerLoopback::openPort()
+{
+  closePort();
+  return setBaudRate(baudrate_);
+}
+
+void PortHandlerLoopback::closePort()
+{
+  channel_ = 0;
+}
+
+void PortHandlerLoopback::clearPort()
+{
+  peek_length_ = 0;
+  if (channel_ != 0)
+    channel_->getPeerTxRing()->clear();
+}
+
+void PortHandlerLoopback::setPortName(const char *port_name)
+{
+  strncpy(port_name_, port_name, sizeof(port_name_) - 1);
+  port_name_[sizeof(port_name_) - 1] = 0;
+}
+
+char *PortHandlerLoopback::getPortName()
+{
+  return port_name_;
+}
+
+bool PortHandlerLoopback::setBaudRate(const int baudrate)
+{
+  if (channel_ == 0)
+  {
+    const char *channel_name = port_name_;
+    if (strncmp(channel_name, LOOPBACK_PORT_PREFIX, strlen(LOOPBACK_PORT_PREFIX)) == 0)
+      channel_name += strlen(LOOPBACK_PORT_PREFIX);
+    channel_ = LoopbackChannel::getChannel(channel_name);
+  }
+
+  baudrate_ = baudrate;
+  tx_time_per_byte = (1000.0 / (double)baudrate_) * 10.0;
+  channel_->setBaudRate(baudrate_);
+  return true;
+}
+
+int PortHandlerLoopback::getBaudRate()
+{
+  return baudrate_;
+}
+
+bool PortHandlerLoopback::setOption(const char *key, const char *value)
+{
+  if (strcmp(key, "baud") == 0)
+  {
+    if (atoi(value) <= 0)
+      return false;
+    if (channel_ != 0)
+      return setBaudRate(atoi(value));
+    baudrate_ = atoi(value);
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
+int PortHandlerLoopback::getBytesAvailable()
+{
+  if (channel_ == 0)
+    return 0;
+  return channel_->getPeerTxRing()->getAvailable();
+}
+
+int PortHandlerLoopback::readPort(uint8_t *packet, int length)
+{
+  if (channel_ == 0)
+    return 0;
+  return channel_->getPeerTxRing()->read(packet, length);
+}
+
+bool PortHandlerLoopback::waitRoom(int length)
+{
+  LoopbackRing *ring = channel_->getPeerRxRing();
+  if (ring->getRoom() >= length)
+    return true;
+
+  int64_t deadline = getMonotonicNs() + LOOPBACK_WRITE_TIMEOUT * 1000000LL;
+  while (ring->getRoom() < length)
+  {
+    if (getMonotonicNs() > deadline)
+      return false;
+    sched_yield();
+  }
+  return true;
+}
+
+int PortHandlerLoopback::writePort(uint8_t *packet, int length)
+{
+  if (channel_ == 0)
+    return -1;
+  waitRoom(length);
+  return channel_->getPeerRxRing()->write(packet, length);
+}
+
+int PortHandlerLoopback::writePortV(PortSegment *segments, int count)
+{
+  int length = 0;
+
+  if (channel_ == 0)
+    return -1;
+  for (int i = 0; i < count; i++)
+    length += segments[i].length;
+  waitRoom(length);
+  return channel_->getPeerRxRing()->writeV(segments, count);
+}
+
+int PortHandlerLoopback::peekPort(uint8_t **data)
+{
+  *data = 0;
+  if (channel_ == 0)
+    return 0;
+  peek_length_ = channel_->getPeerTxRing()->peek(data);
+  return peek_length_;
+}
+
+void PortHandlerLoopback::consumePort(int length)
+{
+  peek_length_ = 0;
+  if (channel_ != 0)
+    channel_->getPeerTxRing()->consume(length);
+}
+
+bool PortHandlerLoopback::waitPort()
+{
+  while (getBytesAvailable() <= peek_length_)
+  {
+    if (getRemainingNs() <= 0)
+      return false;
+    sched_yield();
+  }
+  return true;
+}
+
+void PortHandlerLoopback::setPacketTimeout(uint16_t packet_length)
+{
+  double msec = (tx_time_per_byte * (double)packet_length) + 2.0;
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+void PortHandlerLoopback::setPacketTimeout(double msec)
+{
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+bool PortHandlerLoopback::isPacketTimeout()
+{
+  return (getRemainingNs() < 0);
+}
+
+void PortHandlerLoopback::setPacketDeadline(int64_t deadline_ns)
+{
+  packet_deadline_ns_ = deadline_ns;
+}
+
+#endif
@@ -0,0 +1,376 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "port_handler_record.h"
+
+#define WRITER_IDLE_SLEEP   1000000   // nsec
+#define MAX_CHUNK_LENGTH    65535     // length of a record
+
+using namespace dynamixel;
+
+static void putLittleEndian(uint8_t *data, uint64_t value, int length)
+{
+  for (int i = 0; i < length; i++)
+    data[i] = (uint8_t)(value >> (8 * i));
+}
+
+PortHandlerRecord::PortHandlerRecord(PortHandler *port, const char *capture_path, int buffer_size)
+  : port_(port),
+    file_(0),
+    peek_data_(0),
+    ring_(0),
+    size_(4096),
+    head_(0),
+    tail_(0),
+    running_(false),
+    records_(0),
+    dropped_(0),
+    bytes_(0)
+{
+  is_using_ = false;
+  copyTuning();
+
+  while ((int)size_ < buffer_size)
+    size_ <<= 1;
+  ring_ = (uint8_t *)malloc(size_);
+
+  file_ = fopen(capture_path, "wb");
+  if (file_ == 0 || ring_ == 0)
+  {
+    printf("[PortHandlerRecord::PortHandlerRecord] Error opening the capture file : %s\n", capture_path);
+    return;
+  }
+  fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LENGTH, file_);
+
+  running_ = true;
+  if (pthread_create(&thread_, 0, writerThread, this) != 0)
+    running_ = false;
+
+  recordBaudRate(port_->getBaudRate());
+}
+
+PortHandlerRecord::~PortHandlerRecord()
+{
+  if (running_)
+  {
+    __atomic_store_n(&running_, false, __ATOMIC_RELEASE);
+    pthread_join(thread_, 0);
+  }
+  if (file_ != 0)
+    fclose(file_);
+  free(ring_);
+}
+
+void *PortHandlerRecord::writerThread(void *recorder)
+{
+  ((PortHandlerRecord *)recorder)->run();
+  return 0;
+}
+
+void PortHandlerRecord::run()
+{
+  while (__atomic_load_n(&running_, __ATOMIC_ACQUIRE))
+  {
+    if (drain() > 0)
+    {
+      fflush(file_);
+      continue;
+    }
+
+    struct timespec ts;
+    ts.tv_sec  = 0;
+    ts.tv_nsec = WRITER_IDLE_SLEEP;
+    nanosleep(&ts, NULL);
+  }
+
+  // the records put before the recording stopped
+  drain();
+  fflush(file_);
+}
+
+int PortHandlerRecord::drain()
+{
+  uint32_t head   = head_;
+  uint32_t tail   = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+  uint32_t length = tail - head;
+  if (length == 0)
+    return 0;
+
+  uint32_t index  = head & (size_ - 1);
+  uint32_t first  = (length < size_ - index) ? length : size_ - index;
+  fwrite(&ring_[index], 1, first, file_);
+  fwrite(ring_, 1, length - first, file_);
+
+  __atomic_store_n(&head_, tail, __ATOMIC_RELEASE);
+  __atomic_store_n(&bytes_, bytes_ + length, __ATOMIC_RELEASE);
+  return (int)length;
+}
+
+void PortHandlerRecord::record(int type, PortSegment *segments, int count)
+{
+  if (running_ == false)
+    return;
+
+  int length = 0;
+  for (int i = 0; i < count; i++)
+    length += segments[i].length;
+  if (length <= 0)
+    return;
+  if (length > MAX_CHUNK_LENGTH)
+    length = MAX_CHUNK_LENGTH;
+
+  uint32_t tail = tail_;
+  uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  if (size_ - (tail - head) < (uint32_t)(CAPTURE_HEADER_LENGTH + length))
+  {
+    __atomic_add_fetch(&dropped_, 1, __ATOMIC_ACQ_REL);
+    return;
+  }
+
+  uint8_t header[CAPTURE_HEADER_LENGTH];
+  putLittleEndian(&header[0], (uint64_t)port_->getMonotonicNs(), 8);
+  header[8] = (uint8_t)type;
+  header[9] = 0;
+  putLittleEndian(&header[10], (uint64_t)length, 2);
+
+  for (int i = 0; i < CAPTURE_HEADER_LENGTH; i++)
+    ring_[(tail++) & (size_ - 1)] = header[i];
+
+  int left = length;
+  for (int s = 0; s < count && left > 0; s++)
+  {
+    for (int i = 0; i < segments[s].length && left > 0; i++, left--)
+      ring_[(tail++) & (size_ - 1)] = segments[s].data[i];
+  }
+
+  __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&records_, 1, __ATOMIC_ACQ_REL);
+}
+
+void PortHandlerRecord::recordBaudRate(int baudrate)
+{
+  uint8_t     data[4];
+  PortSegment segment;
+
+  putLittleEndian(data, (uint64_t)(uint32_t)baudrate, 4);
+  segment.data    = data;
+  segment.length  = 4;
+  record(CAPTURE_BAUD_, &segment, 1);
+}
+
+PortRecordStats PortHandlerRecord::getStats()
+{
+  PortRecordStats stats;
+  stats.records = __atomic_load_n(&records_, __ATOMIC_ACQUIRE);
+  stats.dropped = __atomic_load_n(&dropped_, __ATOMIC_ACQUIRE);
+  stats.bytes   = __atomic_load_n(&bytes_, __ATOMIC_ACQUIRE);
+  return stats;
+}
+
+bool PortHandlerRecord::openPort()
+{
+  return port_->openPort();
+}
+
+void PortHandlerRecord::closePort()
+{
+  port_->closePort();
+}
+
+void PortHandlerRecord::clearPort()
+{
+  peek_data_ = 0;
+  port_->clearPort();
+}
+
+void PortHandlerRecord::setPortName(const char *port_name)
+{
+  port_->setPortName(port_name);
+}
+
+char *PortHandlerRecord::getPortName()
+{
+  return port_->getPortName();
+}
+
+bool PortHandlerRecord::setBaudRate(const int baudrate)
+{
+  if (port_->setBaudRate(baudrate) == false)
+    return false;
+
+  recordBaudRate(baudrate);
+  return true;
+}
+
+int PortHandlerRecord::getBaudRate()
+{
+  return port_->getBaudRate();
+}
+
+bool PortHandlerRecord::setOption(const char *key, const char *value)
+{
+  if (port_->setOption(key, value) == false)
+    return false;
+
+  if (strcmp(key, "baud") == 0)
+    recordBaudRate(port_->getBaudRate());
+  copyTuning();
+  return true;
+}
+
+void PortHandlerRecord::copyTuning()
+{
+  // the options of the tuning are taken by the port which is recorded
+  PortHandler::setWaitStrategy(port_->getWaitStrategy(), port_->getWaitSpinTime());
+  if (getStalePolicy() != port_->getStalePolicy())
+    PortHandler::setStalePolicy(port_->getStalePolicy());
+  setLockTimeout(port_->getLockTimeout());
+}
+
+int PortHandlerRecord::getBytesAvailable()
+{
+  return port_->getBytesAvailable();
+}
+
+int PortHandlerRecord::readPort(uint8_t *packet, int length)
+{
+  PortSegment segment;
+
+  peek_data_      = 0;
+  segment.data    = packet;
+  segment.length  = port_->readPort(packet, length);
+  record(CAPTURE_READ_, &segment, 1);
+  return segment.length;
+}
+
+int PortHandlerRecord::writePort(uint8_t *packet, int length)
+{
+  PortSegment segment;
+
+  segment.data    = packet;
+  segment.length  = length;
+  record(CAPTURE_WRITE_, &segment, 1);
+  return port_->writePort(packet, length);
+}
+
+int PortHandlerRecord::writePortV(PortSegment *segments, int count)
+{
+  record(CAPTURE_WRITE_, segments, count);
+  return port_->writePortV(segments, count);
+}
+
+bool PortHandlerRecord::waitPort()
+{
+  return port_->waitPort();
+}
+
+int PortHandlerRecord::peekPort(uint8_t **data)
+{
+  int length = port_->peekPort(data);
+
+  peek_data_ = *data;
+  return length;
+}
+
+void PortHandlerRecord::consumePort(int length)
+{
+  // the bytes peeked are read when they are consumed
+  if (peek_data_ != 0)
+  {
+    PortSegment segment;
+    segment.data    = peek_data_;
+    segment.length  = length;
+    record(CAPTURE_READ_, &segment, 1);
+    peek_data_ += length;
+  }
+  port_->consumePort(length);
+}
+
+void PortHandlerRecord::setPacketTimeout(uint16_t packet_length)
+{
+  port_->setPacketTimeout(packet_length);
+}
+
+void PortHandlerRecord::setPacketTimeout(double msec)
+{
+  port_->setPacketTimeout(msec);
+}
+
+bool PortHandlerRecord::isPacketTimeout()
+{
+  return port_->isPacketTimeout();
+}
+
+int64_t PortHandlerRecord::getMonotonicNs()
+{
+  return port_->getMonotonicNs();
+}
+
+void PortHandlerRecord::setPacketDeadline(int64_t deadline_ns)
+{
+  port_->setPacketDeadline(deadline_ns);
+}
+
+int64_t PortHandlerRecord::getPacketDeadline()
+{
+  return port_->getPacketDeadline();
+}
+
+int64_t PortHandlerRecord::getRemainingNs()
+{
+  return port_->getRemainingNs();
+}
+
+int64_t PortHandlerRecord::getTransmitEndNs()
+{
+  return port_->getTransmitEndNs();
+}
+
+void PortHandlerRecord::checkPort()
+{
+  port_->checkPort();
+}
+
+void PortHandlerRecord::releasePort()
+{
+  port_->releasePort();
+}
+
+void PortHandlerRecord::setAdaptiveTimeout(bool enable, double margin_msec, double floor_msec)
+{
+  PortHandler::setAdaptiveTimeout(enable, margin_msec, floor_msec);
+  port_->setAdaptiveTimeout(enable, margin_msec, floor_msec);
+}
+
+void PortHandlerRecord::setStalePolicy(int policy)
+{
+  PortHandler::setStalePolicy(policy);
+  port_->setStalePolicy(policy);
+}
+
+void PortHandlerRecord::setWaitStrategy(int strategy, double spin_usec)
+{
+  PortHandler::setWaitStrategy(strategy, spin_usec);
+  port_->setWaitStrategy(strategy, spin_usec);
+}
+
+#endif
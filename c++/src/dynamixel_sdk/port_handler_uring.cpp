@@ -0,0 +1,851 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include "port_handler_uring.h"
+#include "packet_handler.h"
+
+// io_uring is set up only when the headers know it; otherwise every port works as PortHandlerLinux
+#if defined(IORING_OFF_SQ_RING) && defined(__NR_io_uring_setup)
+#define HAVE_IO_URING
+#endif
+
+#define URING_MIN_ENTRIES   16
+#define URING_CLOSE_TIMEOUT 1000000000LL  // nsec to wait for the operations cancelled by closePort()
+#define URING_MIN_READ      256           // bytes of room for a read before the receive buffer is compacted
+
+// operation in the low bits of user_data, with the port in the others
+#define OP_WAIT             0
+#define OP_WRITE            1
+#define OP_POLL             2
+#define OP_READ             3
+#define OP_DEADLINE         4
+#define OP_CANCEL           5
+#define OP_MASK             7
+
+using namespace dynamixel;
+
+static int64_t getMonotonicTime()
+{
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return (int64_t)tv.tv_sec * 1000000000LL + (int64_t)tv.tv_nsec;
+}
+
+static const char *getDeviceName(const char *port_name)
+{
+  if (strncmp(port_name, URING_PORT_PREFIX, strlen(URING_PORT_PREFIX)) == 0)
+    return port_name + strlen(URING_PORT_PREFIX);
+  return port_name;
+}
+
+UringQueue::UringQueue(int max_ports)
+  : ring_fd_(-1),
+    max_ports_(max_ports),
+    batching_(false),
+    sq_ring_(0),
+    cq_ring_(0),
+    sq_ring_size_(0),
+    cq_ring_size_(0),
+    sqes_(0),
+    sqes_size_(0),
+    sqe_tail_(0),
+    sqe_submitted_(0),
+    sq_entries_(0),
+    buffers_(0)
+{
+#if defined(HAVE_IO_URING)
+  struct io_uring_params params;
+  unsigned entries = URING_MIN_ENTRIES;
+
+  // a write, a poll, a read and two timeouts a port at most
+  while (entries < (unsigned)(8 * max_ports))
+    entries *= 2;
+
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd_ < 0)
+  {
+    ring_fd_ = -1;
+    return;
+  }
+  // completions must never be dropped, since the ports count their operations in flight
+  if ((params.features & IORING_FEAT_NODROP) == 0)
+  {
+    destroy();
+    return;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (cq_ring_size_ > sq_ring_size_)
+      sq_ring_size_ = cq_ring_size_;
+    cq_ring_size_ = 0;
+  }
+
+  sq_ring_ = mmap(0, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED)
+  {
+    sq_ring_ = 0;
+    destroy();
+    return;
+  }
+  if (cq_ring_size_ == 0)
+  {
+    cq_ring_ = sq_ring_;
+  }
+  else
+  {
+    cq_ring_ = mmap(0, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED)
+    {
+      cq_ring_ = 0;
+      destroy();
+      return;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = mmap(0, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED)
+  {
+    sqes_ = 0;
+    destroy();
+    return;
+  }
+
+  sq_head_    = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.head);
+  sq_tail_    = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.tail);
+  sq_mask_    = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.ring_mask);
+  sq_array_   = (unsigned *)((uint8_t *)sq_ring_ + params.sq_off.array);
+  sq_entries_ = params.sq_entries;
+  sqe_tail_   = sqe_submitted_ = *sq_tail_;
+
+  cq_head_    = (unsigned *)((uint8_t *)cq_ring_ + params.cq_off.head);
+  cq_tail_    = (unsigned *)((uint8_t *)cq_ring_ + params.cq_off.tail);
+  cq_mask_    = (unsigned *)((uint8_t *)cq_ring_ + params.cq_off.ring_mask);
+  cqes_       = (uint8_t *)cq_ring_ + params.cq_off.cqes;
+
+  // the transmit and the receive buffer of every port are registered at once
+  struct iovec *iov = (struct iovec *)malloc(2 * max_ports * sizeof(struct iovec));
+  if (posix_memalign((void **)&buffers_, 4096, 2 * max_ports * BUFFER_SIZE_) != 0)
+    buffers_ = 0;
+  for (int i = 0; buffers_ != 0 && i < 2 * max_ports; i++)
+  {
+    iov[i].iov_base = &buffers_[i * BUFFER_SIZE_];
+    iov[i].iov_len  = BUFFER_SIZE_;
+  }
+  if (buffers_ == 0 || syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iov, 2 * max_ports) != 0)
+    destroy();
+  free(iov);
+#endif
+}
+
+UringQueue::~UringQueue()
+{
+  destroy();
+}
+
+void UringQueue::destroy()
+{
+  if (sqes_ != 0)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ != 0 && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != 0)
+    munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ != -1)
+    close(ring_fd_);
+  free(buffers_);
+
+  sqes_ = sq_ring_ = cq_ring_ = 0;
+  buffers_ = 0;
+  ring_fd_ = -1;
+}
+
+int UringQueue::attach(PortHandlerUring *port)
+{
+  if (isAvailable() == false)
+    return -1;
+
+  for (int slot = 0; slot < max_ports_; slot++)
+  {
+    if (slot >= (int)ports_.size())
+      ports_.push_back(0);
+    if (ports_[slot] == 0)
+    {
+      ports_[slot] = port;
+      return slot;
+    }
+  }
+  return -1;
+}
+
+void UringQueue::detach(PortHandlerUring *port)
+{
+  for (unsigned int i = 0; i < ports_.size(); i++)
+  {
+    if (ports_[i] == port)
+      ports_[i] = 0;
+  }
+  removeCompletion(port);
+}
+
+void UringQueue::removeCompletion(PortHandlerUring *port)
+{
+  for (unsigned int i = 0; i < completed_.size(); )
+  {
+    if (completed_[i] == port)
+      completed_.erase(completed_.begin() + i);
+    else
+      i++;
+  }
+}
+
+void *UringQueue::getSqe()
+{
+#if defined(HAVE_IO_URING)
+  if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+  {
+    submit();
+    if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+      return 0;
+  }
+
+  unsigned index = sqe_tail_ & *sq_mask_;
+  struct io_uring_sqe *sqe = &((struct io_uring_sqe *)sqes_)[index];
+
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  sqe_tail_++;
+  return sqe;
+#else
+  return 0;
+#endif
+}
+
+int UringQueue::enter(unsigned min_complete)
+{
+#if defined(HAVE_IO_URING)
+  unsigned to_submit = sqe_tail_ - sqe_submitted_;
+
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+  int result = (int)syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                            (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+  if (result > 0)
+    sqe_submitted_ += result;
+  return result;
+#else
+  (void)min_complete;
+  return -1;
+#endif
+}
+
+int UringQueue::submit()
+{
+  if (sqe_tail_ == sqe_submitted_)
+    return 0;
+  return enter(0);
+}
+
+int UringQueue::wait(int64_t deadline_ns)
+{
+#if defined(HAVE_IO_URING)
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)getSqe();
+  if (sqe == 0)
+    return -1;
+
+  // the timeout expires at the deadline, or completes with the first other completion
+  wait_deadline_.tv_sec  = deadline_ns / 1000000000LL;
+  wait_deadline_.tv_nsec = deadline_ns % 1000000000LL;
+
+  sqe->opcode         = IORING_OP_TIMEOUT;
+  sqe->fd             = -1;
+  sqe->addr           = (uint64_t)(uintptr_t)&wait_deadline_;
+  sqe->len            = 1;
+  sqe->off            = 1;
+  sqe->timeout_flags  = IORING_TIMEOUT_ABS;
+  sqe->user_data      = OP_WAIT;
+
+  return enter(1);
+#else
+  (void)deadline_ns;
+  return -1;
+#endif
+}
+
+void UringQueue::reap()
+{
+#if defined(HAVE_IO_URING)
+  unsigned head = *cq_head_;
+  unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+  while (head != tail)
+  {
+    struct io_uring_cqe *cqe = &((struct io_uring_cqe *)cqes_)[head & *cq_mask_];
+    uint64_t user_data = cqe->user_data;
+    int      result    = cqe->res;
+
+    head++;
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    PortHandlerUring *port = (PortHandlerUring *)(uintptr_t)(user_data & ~(uint64_t)OP_MASK);
+    if (port != 0)
+      port->handleCompletion((int)(user_data & OP_MASK), result);
+
+    tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  }
+#endif
+}
+
+PortHandlerUring *UringQueue::waitCompletion(int64_t deadline_ns)
+{
+  if (isAvailable() == false)
+    return 0;
+
+  while (true)
+  {
+    reap();
+    if (completed_.empty() == false)
+    {
+      PortHandlerUring *port = completed_.front();
+      completed_.erase(completed_.begin());
+      return port;
+    }
+
+    if (getMonotonicTime() >= deadline_ns)
+    {
+      submit();
+      return 0;
+    }
+
+    // the timeouts of the ports at their packet deadlines wake the queue up as well
+    if (wait(deadline_ns) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+      return 0;
+  }
+}
+
+PortHandlerUring::PortHandlerUring(const char *port_name)
+  : PortHandlerLinux(getDeviceName(port_name)),
+    queue_(new UringQueue(1)),
+    own_queue_(true),
+    slot_(-1),
+    uring_tx_(0),
+    uring_rx_(0),
+    uring_head_(0),
+    uring_tail_(0),
+    read_armed_(false),
+    write_inflight_(false),
+    deadline_armed_(false),
+    tx_length_(0),
+    tx_done_(0),
+    closing_(false),
+    inflight_(0),
+    expected_length_(0),
+    rx_result_(COMM_RX_TIMEOUT),
+    rx_pending_(false)
+{
+  slot_ = queue_->attach(this);
+  if (slot_ >= 0)
+  {
+    uring_tx_ = queue_->getTxBuffer(slot_);
+    uring_rx_ = queue_->getRxBuffer(slot_);
+  }
+}
+
+PortHandlerUring::PortHandlerUring(const char *port_name, UringQueue *queue)
+  : PortHandlerLinux(getDeviceName(port_name)),
+    queue_(queue),
+    own_queue_(false),
+    slot_(-1),
+    uring_tx_(0),
+    uring_rx_(0),
+    uring_head_(0),
+    uring_tail_(0),
+    read_armed_(false),
+    write_inflight_(false),
+    deadline_armed_(false),
+    tx_length_(0),
+    tx_done_(0),
+    closing_(false),
+    inflight_(0),
+    expected_length_(0),
+    rx_result_(COMM_RX_TIMEOUT),
+    rx_pending_(false)
+{
+  slot_ = queue_->attach(this);
+  if (slot_ >= 0)
+  {
+    uring_tx_ = queue_->getTxBuffer(slot_);
+    uring_rx_ = queue_->getRxBuffer(slot_);
+  }
+}
+
+PortHandlerUring::~PortHandlerUring()
+{
+  closePort();
+  if (slot_ >= 0)
+    queue_->detach(this);
+  if (own_queue_)
+    delete queue_;
+}
+
+bool PortHandlerUring::isUring()
+{
+  return (slot_ >= 0);
+}
+
+void PortHandlerUring::queueRead()
+{
+#if defined(HAVE_IO_URING)
+  if (read_armed_ || closing_ || socket_fd_ == -1)
+    return;
+
+  // nothing reads the receive buffer while no read is in flight
+  if (uring_head_ == uring_tail_)
+    uring_head_ = uring_tail_ = 0;
+  if (UringQueue::BUFFER_SIZE_ - uring_tail_ < URING_MIN_READ && uring_head_ > 0)
+  {
+    memmove(uring_rx_, &uring_rx_[uring_head_], uring_tail_ - uring_head_);
+    uring_tail_ -= uring_head_;
+    uring_head_ = 0;
+  }
+  if (uring_tail_ == UringQueue::BUFFER_SIZE_)
+    return;
+
+  // the read is issued when the port is readable, not to return nothing at once by VMIN = 0
+  struct io_uring_sqe *poll = (struct io_uring_sqe *)queue_->getSqe();
+  if (poll == 0)
+    return;
+  struct io_uring_sqe *read = (struct io_uring_sqe *)queue_->getSqe();
+  if (read == 0)
+  {
+    // the poll alone completes harmlessly
+    poll->opcode        = IORING_OP_NOP;
+    poll->user_data     = (uint64_t)(uintptr_t)this | OP_CANCEL;
+    inflight_++;
+    return;
+  }
+
+  poll->opcode          = IORING_OP_POLL_ADD;
+  poll->fd              = socket_fd_;
+  poll->poll32_events   = POLLIN;
+  poll->flags           = IOSQE_IO_LINK;
+  poll->user_data       = (uint64_t)(uintptr_t)this | OP_POLL;
+
+  read->opcode          = IORING_OP_READ_FIXED;
+  read->fd              = socket_fd_;
+  read->addr            = (uint64_t)(uintptr_t)&uring_rx_[uring_tail_];
+  read->len             = UringQueue::BUFFER_SIZE_ - uring_tail_;
+  read->buf_index       = 2 * slot_ + 1;
+  read->user_data       = (uint64_t)(uintptr_t)this | OP_READ;
+
+  inflight_ += 2;
+  read_armed_ = true;
+#endif
+}
+
+void PortHandlerUring::handleCompletion(int op, int result)
+{
+  inflight_--;
+
+  switch (op)
+  {
+    case OP_WRITE:
+      write_inflight_ = false;
+      if (result > 0)
+      {
+        tx_done_ += result;
+        if (echo_suppression_)
+          echo_pending_ += result;
+      }
+      // the write of a tty can be interrupted or cut short, and the rest of the packet goes out again
+      if ((result == -EINTR || result == -EAGAIN || (result > 0 && tx_done_ < tx_length_)) && closing_ == false)
+      {
+        if (queueWrite() != 0 && queue_->isBatching() == false)
+          queue_->submit();
+      }
+      break;
+
+    case OP_READ:
+      read_armed_ = false;
+      if (result > 0)
+      {
+        // the bytes written come back before the response on a half-duplex bus which echoes
+        int echo_length = (result < echo_pending_) ? result : echo_pending_;
+        if (echo_length > 0)
+        {
+          memmove(&uring_rx_[uring_tail_], &uring_rx_[uring_tail_ + echo_length], result - echo_length);
+          echo_pending_ -= echo_length;
+        }
+        uring_tail_ += result - echo_length;
+      }
+      // keep a read in flight, unless the device is gone
+      if (result >= 0 || result == -ECANCELED || result == -EAGAIN || result == -EINTR)
+        queueRead();
+      checkCompletion();
+      break;
+
+    case OP_DEADLINE:
+      if (result == -ECANCELED)
+        break;
+      deadline_armed_ = false;
+      if (rx_pending_ && getMonotonicTime() >= packet_deadline_ns_)
+      {
+        rx_pending_ = false;
+        rx_result_  = COMM_RX_TIMEOUT;
+        queue_->completed_.push_back(this);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void PortHandlerUring::checkCompletion()
+{
+  if (rx_pending_ && uring_tail_ - uring_head_ >= expected_length_)
+  {
+    rx_pending_ = false;
+    rx_result_  = COMM_SUCCESS;
+    queue_->completed_.push_back(this);
+    removeDeadline();
+  }
+}
+
+void PortHandlerUring::removeDeadline()
+{
+#if defined(HAVE_IO_URING)
+  if (deadline_armed_ == false)
+    return;
+
+  // the timeout left would wake up the queue for nothing at the packet deadline
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)queue_->getSqe();
+  if (sqe == 0)
+    return;
+  sqe->opcode     = IORING_OP_TIMEOUT_REMOVE;
+  sqe->fd         = -1;
+  sqe->addr       = (uint64_t)(uintptr_t)this | OP_DEADLINE;
+  sqe->user_data  = (uint64_t)(uintptr_t)this | OP_CANCEL;
+  inflight_++;
+  deadline_armed_ = false;
+#endif
+}
+
+void PortHandlerUring::closePort()
+{
+#if defined(HAVE_IO_URING)
+  if (isUring() && inflight_ > 0)
+  {
+    closing_ = true;
+    queue_->removeCompletion(this);
+
+    // cancel the poll and the read kept in flight, and the timeout of startRx()
+    uint64_t targets[3] = { (uint64_t)(uintptr_t)this | OP_POLL, (uint64_t)(uintptr_t)this | OP_READ, (uint64_t)(uintptr_t)this | OP_DEADLINE };
+    for (int i = 0; i < 3; i++)
+    {
+      struct io_uring_sqe *sqe = (struct io_uring_sqe *)queue_->getSqe();
+      if (sqe == 0)
+        break;
+      sqe->opcode     = (i == 2) ? IORING_OP_TIMEOUT_REMOVE : IORING_OP_ASYNC_CANCEL;
+      sqe->fd         = -1;
+      sqe->addr       = targets[i];
+      sqe->user_data  = (uint64_t)(uintptr_t)this | OP_CANCEL;
+      inflight_++;
+    }
+
+    int64_t deadline = getMonotonicTime() + URING_CLOSE_TIMEOUT;
+    while (inflight_ > 0 && getMonotonicTime() < deadline)
+    {
+      queue_->wait(deadline);
+      queue_->reap();
+    }
+    closing_ = false;
+  }
+#endif
+
+  read_armed_ = false;
+  write_inflight_ = false;
+  deadline_armed_ = false;
+  rx_pending_ = false;
+  uring_head_ = uring_tail_ = 0;
+  PortHandlerLinux::closePort();
+}
+
+void PortHandlerUring::clearPort()
+{
+  if (isUring() == false)
+  {
+    PortHandlerLinux::clearPort();
+    return;
+  }
+
+  // the read in flight takes whatever the device receives, so there is nothing to flush in the kernel
+  queue_->reap();
+  if (read_armed_ == false)
+    tcflush(socket_fd_, TCIFLUSH);
+  uring_head_ = uring_tail_;
+  peek_length_ = 0;
+  echo_pending_ = 0;
+}
+
+int PortHandlerUring::getBytesAvailable()
+{
+  if (isUring() == false)
+    return PortHandlerLinux::getBytesAvailable();
+
+  queue_->reap();
+  return uring_tail_ - uring_head_;
+}
+
+int PortHandlerUring::readPort(uint8_t *packet, int length)
+{
+  if (isUring() == false)
+    return PortHandlerLinux::readPort(packet, length);
+
+  queue_->reap();
+  if (length > uring_tail_ - uring_head_)
+    length = uring_tail_ - uring_head_;
+
+  memcpy(packet, &uring_rx_[uring_head_], length);
+  consumePort(length);
+  return length;
+}
+
+int PortHandlerUring::peekPort(uint8_t **data)
+{
+  if (isUring() == false)
+    return PortHandlerLinux::peekPort(data);
+
+  queue_->reap();
+  *data = &uring_rx_[uring_head_];
+  peek_length_ = uring_tail_ - uring_head_;
+  return peek_length_;
+}
+
+void PortHandlerUring::consumePort(int length)
+{
+  if (isUring() == false)
+  {
+    PortHandlerLinux::consumePort(length);
+    return;
+  }
+
+  uring_head_ += length;
+  peek_length_ = 0;
+  if (uring_head_ > uring_tail_)
+    uring_head_ = uring_tail_;
+  if (read_armed_ == false)
+    queueRead();
+}
+
+void *PortHandlerUring::queueWrite()
+{
+#if defined(HAVE_IO_URING)
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)queue_->getSqe();
+  if (sqe == 0)
+    return 0;
+
+  sqe->opcode     = IORING_OP_WRITE_FIXED;
+  sqe->fd         = socket_fd_;
+  sqe->addr       = (uint64_t)(uintptr_t)&uring_tx_[tx_done_];
+  sqe->len        = tx_length_ - tx_done_;
+  sqe->buf_index  = 2 * slot_;
+  sqe->user_data  = (uint64_t)(uintptr_t)this | OP_WRITE;
+  inflight_++;
+  write_inflight_ = true;
+  return sqe;
+#else
+  return 0;
+#endif
+}
+
+int PortHandlerUring::submitWrite(int length)
+{
+#if defined(HAVE_IO_URING)
+  tx_length_  = length;
+  tx_done_    = 0;
+
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)queueWrite();
+  if (sqe == 0)
+    return -1;
+
+  // the poll and the read for the status packet follow the write without another submission
+  if (read_armed_ == false)
+  {
+    sqe->flags |= IOSQE_IO_LINK;
+    queueRead();
+    if (read_armed_ == false)
+      sqe->flags &= ~IOSQE_IO_LINK;
+  }
+
+  if (queue_->isBatching() == false)
+    queue_->submit();
+  return length;
+#else
+  (void)length;
+  return -1;
+#endif
+}
+
+bool PortHandlerUring::waitWrite()
+{
+  // the transmit buffer is not touched while the kernel may still be reading it
+  int64_t deadline = getMonotonicTime() + URING_CLOSE_TIMEOUT;
+  queue_->reap();
+  while (write_inflight_ && getMonotonicTime() < deadline)
+  {
+    queue_->wait(deadline);
+    queue_->reap();
+  }
+  return (write_inflight_ == false);
+}
+
+int PortHandlerUring::writePort(uint8_t *packet, int length)
+{
+  if (isUring() == false)
+    return PortHandlerLinux::writePort(packet, length);
+  if (socket_fd_ == -1 || length > UringQueue::BUFFER_SIZE_ || waitWrite() == false)
+    return -1;
+
+  memcpy(uring_tx_, packet, length);
+  int written = submitWrite(length);
+  if (written > 0)
+    addTransmit(written);
+  return written;
+}
+
+int PortHandlerUring::writePortV(PortSegment *segments, int count)
+{
+  int length = 0;
+
+  if (isUring() == false)
+    return PortHandlerLinux::writePortV(segments, count);
+  if (socket_fd_ == -1 || waitWrite() == false)
+    return -1;
+
+  for (int i = 0; i < count; i++)
+  {
+    if (length + segments[i].length > UringQueue::BUFFER_SIZE_)
+      return -1;
+    memcpy(&uring_tx_[length], segments[i].data, segments[i].length);
+    length += segments[i].length;
+  }
+
+  int written = submitWrite(length);
+  if (written > 0)
+    addTransmit(written);
+  return written;
+}
+
+bool PortHandlerUring::waitPort()
+{
+  if (isUring() == false)
+    return PortHandlerLinux::waitPort();
+
+  queue_->reap();
+  if (uring_tail_ - uring_head_ > peek_length_)
+    return true;
+
+  int64_t start = getMonotonicTime();
+  queueRead();
+  if (start >= packet_deadline_ns_)
+  {
+    queue_->submit();
+    return false;
+  }
+
+  // spin on the completion queue before sleeping by the wait strategy, which takes no system call
+  if (getWaitStrategy() != WAIT_BLOCK_)
+  {
+    int64_t spin_end = (getWaitStrategy() == WAIT_SPIN_) ? packet_deadline_ns_ : start + (int64_t)(getWaitSpinTime() * 1000.0);
+    queue_->submit();
+    bool spun = spinPort((spin_end < packet_deadline_ns_) ? spin_end : packet_deadline_ns_);
+    if (spun || getWaitStrategy() == WAIT_SPIN_)
+    {
+      addWaitSample(start, spun, true);
+      return spun;
+    }
+  }
+
+  queue_->wait(packet_deadline_ns_);
+  queue_->reap();
+  addWaitSample(start, uring_tail_ - uring_head_ > peek_length_, false);
+  return (uring_tail_ - uring_head_ > peek_length_);
+}
+
+bool PortHandlerUring::startRx(uint16_t length)
+{
+#if defined(HAVE_IO_URING)
+  if (isUring() == false || socket_fd_ == -1)
+    return false;
+
+  setPacketTimeout(length);
+  expected_length_  = length;
+  rx_pending_       = true;
+  rx_result_        = COMM_RX_TIMEOUT;
+  removeDeadline();
+  queueRead();
+
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)queue_->getSqe();
+  if (sqe != 0)
+  {
+    rx_deadline_.tv_sec   = packet_deadline_ns_ / 1000000000LL;
+    rx_deadline_.tv_nsec  = packet_deadline_ns_ % 1000000000LL;
+
+    sqe->opcode         = IORING_OP_TIMEOUT;
+    sqe->fd             = -1;
+    sqe->addr           = (uint64_t)(uintptr_t)&rx_deadline_;
+    sqe->len            = 1;
+    sqe->timeout_flags  = IORING_TIMEOUT_ABS;
+    sqe->user_data      = (uint64_t)(uintptr_t)this | OP_DEADLINE;
+    inflight_++;
+    deadline_armed_ = true;
+  }
+
+  queue_->reap();
+  checkCompletion();
+  if (queue_->isBatching() == false)
+    queue_->submit();
+  return true;
+#else
+  (void)length;
+  return false;
+#endif
+}
+
+#endif
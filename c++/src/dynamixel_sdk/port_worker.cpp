@@ -0,0 +1,313 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include "port_worker.h"
+
+#define WORKER_SPIN_COUNT   1000    // polls of the idle worker before it starts to sleep
+#define WORKER_IDLE_SLEEP   50000   // nsec
+
+using namespace dynamixel;
+
+static void idle(int *count)
+{
+  // spin while requests come one after another, and sleep when they do not
+  if (++(*count) < WORKER_SPIN_COUNT)
+  {
+    sched_yield();
+  }
+  else
+  {
+    struct timespec ts;
+    ts.tv_sec  = 0;
+    ts.tv_nsec = WORKER_IDLE_SLEEP;
+    nanosleep(&ts, NULL);
+  }
+}
+
+PortWorker::PortWorker(PortHandler *port, PacketHandler *packet_handler, int depth)
+  : port_(port),
+    packet_handler_(packet_handler),
+    requests_(depth),
+    completions_(depth),
+    running_(false),
+    ready_(false),
+    profile_(0),
+    submitted_(0),
+    rejected_(0),
+    max_request_depth_(0),
+    completed_(0),
+    stalls_(0),
+    max_completion_depth_(0)
+{
+}
+
+PortWorker::~PortWorker()
+{
+  stop();
+}
+
+bool PortWorker::start()
+{
+  if (running_)
+    return true;
+
+  running_  = true;
+  ready_    = false;
+  if (pthread_create(&thread_, 0, workerThread, this) != 0)
+  {
+    running_ = false;
+    return false;
+  }
+
+  // the thread is ready when it has applied the real-time profile
+  while (__atomic_load_n(&ready_, __ATOMIC_ACQUIRE) == false)
+    sched_yield();
+  return true;
+}
+
+void PortWorker::stop()
+{
+  if (running_)
+  {
+    __atomic_store_n(&running_, false, __ATOMIC_RELEASE);
+    pthread_join(thread_, 0);
+  }
+}
+
+bool PortWorker::isRunning()
+{
+  return __atomic_load_n(&running_, __ATOMIC_ACQUIRE);
+}
+
+void *PortWorker::workerThread(void *worker)
+{
+  ((PortWorker *)worker)->run();
+  return 0;
+}
+
+void PortWorker::run()
+{
+  int  idle_count = 0;
+  bool stalled    = false;
+
+  if (profile_ != 0)
+    profile_->apply();
+  __atomic_store_n(&ready_, true, __ATOMIC_RELEASE);
+
+  while (__atomic_load_n(&running_, __ATOMIC_ACQUIRE))
+  {
+    PortRequest *request = requests_.front();
+    if (request == 0)
+    {
+      idle(&idle_count);
+      continue;
+    }
+
+    // a request is not taken until its result has a place, so that no result is lost
+    if (completions_.getDepth() >= completions_.getCapacity())
+    {
+      if (stalled == false)
+        __atomic_store_n(&stalls_, stalls_ + 1, __ATOMIC_RELEASE);
+      stalled = true;
+      idle(&idle_count);
+      continue;
+    }
+    stalled     = false;
+    idle_count  = 0;
+
+    PortCompletion completion;
+    execute(request, &completion);
+    requests_.pop();
+
+    completions_.push(completion);
+    __atomic_store_n(&completed_, completed_ + 1, __ATOMIC_RELEASE);
+
+    int depth = completions_.getDepth();
+    if (depth > max_completion_depth_)
+      __atomic_store_n(&max_completion_depth_, depth, __ATOMIC_RELEASE);
+  }
+}
+
+void PortWorker::execute(PortRequest *request, PortCompletion *completion)
+{
+  completion->type          = request->type;
+  completion->tag           = request->tag;
+  completion->id            = request->id;
+  completion->error         = 0;
+  completion->model_number  = 0;
+  completion->length        = 0;
+  completion->submit_ns     = request->submit_ns;
+
+  switch (request->type)
+  {
+    case PortRequest::PING:
+      completion->result = packet_handler_->ping(port_, request->id, &completion->model_number, &completion->error);
+      break;
+
+    case PortRequest::READ:
+      completion->length = request->length;
+      completion->result = packet_handler_->readTxRx(port_, request->id, request->address, request->length, completion->data, &completion->error);
+      break;
+
+    case PortRequest::WRITE:
+      completion->result = packet_handler_->writeTxRx(port_, request->id, request->address, request->length, request->data, &completion->error);
+      break;
+
+    case PortRequest::WRITE_TX_ONLY:
+      completion->result = packet_handler_->writeTxOnly(port_, request->id, request->address, request->length, request->data);
+      break;
+
+    case PortRequest::SYNC_READ:
+      completion->result = ((GroupSyncRead *)request->group)->txRxPacket();
+      break;
+
+    case PortRequest::SYNC_WRITE:
+      completion->result = ((GroupSyncWrite *)request->group)->txPacket();
+      break;
+
+    case PortRequest::BULK_READ:
+      completion->result = ((GroupBulkRead *)request->group)->txRxPacket();
+      break;
+
+    case PortRequest::BULK_WRITE:
+      completion->result = ((GroupBulkWrite *)request->group)->txPacket();
+      break;
+
+    default:
+      completion->result = COMM_NOT_AVAILABLE;
+      break;
+  }
+
+  completion->complete_ns = port_->getMonotonicNs();
+}
+
+bool PortWorker::submit(const PortRequest &request)
+{
+  PortRequest entry = request;
+  entry.submit_ns = port_->getMonotonicNs();
+
+  if (requests_.push(entry) == false)
+  {
+    __atomic_store_n(&rejected_, rejected_ + 1, __ATOMIC_RELEASE);
+    return false;
+  }
+  __atomic_store_n(&submitted_, submitted_ + 1, __ATOMIC_RELEASE);
+
+  int depth = requests_.getDepth();
+  if (depth > max_request_depth_)
+    __atomic_store_n(&max_request_depth_, depth, __ATOMIC_RELEASE);
+  return true;
+}
+
+static PortRequest makeRequest(PortRequest::Type type, uint8_t id, uint16_t address, uint16_t length, void *group, uint64_t tag)
+{
+  PortRequest request;
+  request.type    = type;
+  request.tag     = tag;
+  request.id      = id;
+  request.address = address;
+  request.length  = length;
+  request.group   = group;
+  return request;
+}
+
+bool PortWorker::submitPing(uint8_t id, uint64_t tag)
+{
+  return submit(makeRequest(PortRequest::PING, id, 0, 0, 0, tag));
+}
+
+bool PortWorker::submitRead(uint8_t id, uint16_t address, uint16_t length, uint64_t tag)
+{
+  if (length > PortRequest::MAX_DATA_LEN_)
+    return false;
+  return submit(makeRequest(PortRequest::READ, id, address, length, 0, tag));
+}
+
+bool PortWorker::submitWrite(uint8_t id, uint16_t address, uint16_t length, uint8_t *data, uint64_t tag)
+{
+  if (length > PortRequest::MAX_DATA_LEN_)
+    return false;
+  PortRequest request = makeRequest(PortRequest::WRITE, id, address, length, 0, tag);
+  memcpy(request.data, data, length);
+  return submit(request);
+}
+
+bool PortWorker::submitWriteTxOnly(uint8_t id, uint16_t address, uint16_t length, uint8_t *data, uint64_t tag)
+{
+  if (length > PortRequest::MAX_DATA_LEN_)
+    return false;
+  PortRequest request = makeRequest(PortRequest::WRITE_TX_ONLY, id, address, length, 0, tag);
+  memcpy(request.data, data, length);
+  return submit(request);
+}
+
+bool PortWorker::submitSyncRead(GroupSyncRead *group, uint64_t tag)
+{
+  return submit(makeRequest(PortRequest::SYNC_READ, 0, 0, 0, group, tag));
+}
+
+bool PortWorker::submitSyncWrite(GroupSyncWrite *group, uint64_t tag)
+{
+  return submit(makeRequest(PortRequest::SYNC_WRITE, 0, 0, 0, group, tag));
+}
+
+bool PortWorker::submitBulkRead(GroupBulkRead *group, uint64_t tag)
+{
+  return submit(makeRequest(PortRequest::BULK_READ, 0, 0, 0, group, tag));
+}
+
+bool PortWorker::submitBulkWrite(GroupBulkWrite *group, uint64_t tag)
+{
+  return submit(makeRequest(PortRequest::BULK_WRITE, 0, 0, 0, group, tag));
+}
+
+bool PortWorker::poll(PortCompletion *completion)
+{
+  PortCompletion *entry = completions_.front();
+  if (entry == 0)
+    return false;
+
+  *completion = *entry;
+  completions_.pop();
+  return true;
+}
+
+int PortWorker::getRoom()
+{
+  return requests_.getCapacity() - requests_.getDepth();
+}
+
+PortWorkerStats PortWorker::getStats()
+{
+  PortWorkerStats stats;
+  stats.submitted             = __atomic_load_n(&submitted_, __ATOMIC_ACQUIRE);
+  stats.rejected              = __atomic_load_n(&rejected_, __ATOMIC_ACQUIRE);
+  stats.completed             = __atomic_load_n(&completed_, __ATOMIC_ACQUIRE);
+  stats.stalls                = __atomic_load_n(&stalls_, __ATOMIC_ACQUIRE);
+  stats.request_depth         = requests_.getDepth();
+  stats.completion_depth      = completions_.getDepth();
+  stats.max_request_depth     = __atomic_load_n(&max_request_depth_, __ATOMIC_ACQUIRE);
+  stats.max_completion_depth  = __atomic_load_n(&max_completion_depth_, __ATOMIC_ACQUIRE);
+  return stats;
+}
+
+#endif
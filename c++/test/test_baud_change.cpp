@@ -0,0 +1,124 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// PortHandlerLinux on a pseudo-terminal served by a simulated Dynamixel changes the baudrate of the open port
+// in place by termios2 / BOTHER: each change takes TCGETS2, TCSETSW2 and TCGETS2 and one input flush,
+// without reopening the port, the pseudo-terminal reports the baudrate, even the ones of Dynamixel-X
+// out of the Bxxx constants, and the simulated Dynamixel answers only at its own baudrate.
+// It prints the time of a change in place and of a reopen of the port.
+//
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "test_helper.h"
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_ID                          1
+#define DXL_MODEL_NUMBER                1060
+#define DXL_BAUDRATE                    4500000
+#define BUS_NAME                        "baud_change"
+
+#define CHANGE_COUNT                    100
+
+static void checkBaudRate(const char *title, int baudrate, bool passed)
+{
+  char baud_title[200];
+  snprintf(baud_title, sizeof(baud_title), "%8d: %s", baudrate, title);
+  check(baud_title, passed);
+}
+
+void testBaudChange()
+{
+  const int baudrate[] = { 57600, 1000000, 4500000, 10500000, 3000000, 4500000 };
+  char pty_name[100];
+
+  // Serve a simulated Dynamixel at a baudrate of Dynamixel-X on a pseudo-terminal
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  bus->addDevice(DXL_ID, PROTOCOL_VERSION, DXL_MODEL_NUMBER, DXL_BAUDRATE);
+  if (bus->openPty(pty_name, sizeof(pty_name)) == false)
+  {
+    check("open the pseudo-terminal", false);
+    dynamixel::SimulatedBus::removeBus(BUS_NAME);
+    return;
+  }
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(pty_name);
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+  uint16_t dxl_model_number;
+
+  if (portHandler->setBaudRate(baudrate[0]) == false || portHandler->openPort() == false)
+  {
+    check("open the port", false);
+    delete portHandler;
+    bus->closeServer();
+    dynamixel::SimulatedBus::removeBus(BUS_NAME);
+    return;
+  }
+
+  // a second descriptor of the same pseudo-terminal sees the termios which the port sets
+  int observer_fd = open(pty_name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+  for (unsigned i = 0; i < sizeof(baudrate) / sizeof(baudrate[0]); i++)
+  {
+    struct termios2 tio;
+
+    portHandler->resetIoStats();
+    bool changed = portHandler->setBaudRate(baudrate[i]);
+    dynamixel::PortIoStats io = portHandler->getIoStats();
+
+    checkBaudRate("changed", baudrate[i], changed && portHandler->getBaudRate() == baudrate[i]);
+    checkBaudRate("TCGETS2, TCSETSW2 and TCGETS2 with one input flush, without reopening",
+                  baudrate[i], io.ioctls == 3 && io.flushes == 1 && io.reads == 0 && io.writes == 0);
+    checkBaudRate("the pseudo-terminal reports BOTHER and the baudrate", baudrate[i],
+                  ioctl(observer_fd, TCGETS2, &tio) == 0 && (tio.c_cflag & CBAUD) == BOTHER
+                  && (int)tio.c_ospeed == baudrate[i] && (int)tio.c_ispeed == baudrate[i]);
+
+    bool answered = (packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) == COMM_SUCCESS);
+    checkBaudRate((baudrate[i] == DXL_BAUDRATE) ? "the Dynamixel answers" : "the Dynamixel at another baudrate does not answer",
+                  baudrate[i], answered == (baudrate[i] == DXL_BAUDRATE));
+  }
+
+  // time of the change in place, and of the reopen which it replaces
+  double start = getTime();
+  for (int i = 0; i < CHANGE_COUNT; i++)
+    portHandler->setBaudRate((i % 2 == 0) ? 1000000 : DXL_BAUDRATE);
+  double in_place = (getTime() - start) / CHANGE_COUNT;
+
+  start = getTime();
+  for (int i = 0; i < CHANGE_COUNT; i++)
+    portHandler->openPort();
+  double reopen = (getTime() - start) / CHANGE_COUNT;
+
+  checkBaudRate("the Dynamixel answers after the reopens", portHandler->getBaudRate(),
+                packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) == COMM_SUCCESS);
+  printf("change in place %.1f usec, reopen %.1f usec\n", in_place * 1000000.0, reopen * 1000000.0);
+
+  // Close port
+  close(observer_fd);
+  portHandler->closePort();
+  delete portHandler;
+
+  bus->closeServer();
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
@@ -0,0 +1,120 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// BaudScanner on simulated Dynamixels of both protocols at several baudrates finds each baudrate, protocol
+// and ID list. The bus is scanned through the simulated port "sim://", and through a pseudo-terminal
+// opened by the serial port handler, which changes the baudrate in place.
+//
+
+#include <stdio.h>
+
+#include "test_helper.h"
+
+// Default setting
+#define DXL_MODEL_NUMBER                1060
+#define BUS_NAME                        "baud_scan"
+#define DEVICENAME                      "sim://" BUS_NAME
+
+#define SCAN_MAX_ID                     20
+
+struct SimulatedDxl
+{
+  uint8_t id;
+  float   protocol_version;
+  int     baudrate;
+};
+
+// the Dynamixels on the bus, in the order which BaudScanner reports them for its default baudrates
+static const SimulatedDxl dxl[] =
+{
+  {  1, 2.0,   57600 },
+  {  2, 2.0,   57600 },
+  {  3, 2.0,   57600 },
+  { 10, 2.0, 1000000 },
+  {  5, 1.0, 1000000 },
+  {  7, 1.0,    9600 },
+};
+static const int DXL_COUNT = sizeof(dxl) / sizeof(dxl[0]);
+
+static void scanPort(const char *port_name)
+{
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(port_name);
+  std::vector<dynamixel::BaudScanResult> results;
+
+  printf("Scan of %s up to ID %d\n", port_name, SCAN_MAX_ID);
+  if (portHandler->openPort() == false)
+  {
+    check("open the port", false);
+    delete portHandler;
+    return;
+  }
+
+  dynamixel::BaudScanner scanner(portHandler);
+  scanner.setMaxID(SCAN_MAX_ID);
+
+  int    baudrate = portHandler->getBaudRate();
+  double start    = getTime();
+  int    result   = scanner.scan(results);
+  double elapsed  = getTime() - start;
+
+  // the results must be the Dynamixels on the bus, grouped by baudrate and protocol
+  int found = 0;
+  bool matched = true;
+  for (unsigned i = 0; i < results.size(); i++)
+  {
+    printf("  %8d bps, protocol %.1f, ID", results[i].baudrate, results[i].protocol_version);
+    for (unsigned j = 0; j < results[i].id_list.size(); j++)
+    {
+      printf(" %d", results[i].id_list[j]);
+      if (found >= DXL_COUNT || dxl[found].id != results[i].id_list[j]
+          || dxl[found].protocol_version != results[i].protocol_version || dxl[found].baudrate != results[i].baudrate)
+        matched = false;
+      found++;
+    }
+    printf("\n");
+  }
+  printf("  %.2f sec for %d baudrates\n", elapsed, (int)scanner.getBaudRates().size());
+
+  check("every baudrate, protocol and ID is found", result == COMM_SUCCESS && matched && found == DXL_COUNT);
+  check("the baudrate of the port is restored", portHandler->getBaudRate() == baudrate);
+
+  // stop at the first baudrate with a Dynamixel
+  scanner.setStopAtFirst(true);
+  scanner.scan(results);
+  check("the scan stops at the first baudrate", results.size() == 1 && results[0].baudrate == dxl[0].baudrate);
+
+  portHandler->closePort();
+  delete portHandler;
+}
+
+void testBaudScan()
+{
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  for (int i = 0; i < DXL_COUNT; i++)
+    bus->addDevice(dxl[i].id, dxl[i].protocol_version, DXL_MODEL_NUMBER, dxl[i].baudrate);
+
+  scanPort(DEVICENAME);
+
+  char pty_name[100];
+  if (bus->openPty(pty_name, sizeof(pty_name)) == true)
+    scanPort(pty_name);
+  else
+    check("open the pseudo-terminal", false);
+  bus->closeServer();
+
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
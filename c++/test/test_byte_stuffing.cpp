@@ -0,0 +1,105 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// The byte stuffing of protocol 2.0 on a simulated Dynamixel through the simulated port "sim://":
+// the data with FF FF FD is written and read back, a whole packet in a buffer without room for the stuffing
+// is sent by txRxPacket() and left unstuffed, and a packet which would be longer than TXPACKET_MAX_LEN
+// once stuffed is refused.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helper.h"
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_ID                          1
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define BUS_NAME                        "byte_stuffing"
+#define DEVICENAME                      "sim://" BUS_NAME
+
+#define ADDR_DATA                       224                 // indirect data, which no setting of the Dynamixel lies in
+#define LEN_DATA                        12                  // FF FF FD four times
+#define TXPACKET_MAX_LEN                (4*1024)
+
+void testByteStuffing()
+{
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  bus->addDevice(DXL_ID, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE);
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(DEVICENAME);
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+  uint8_t dxl_error = 0;
+
+  if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+    check("open the port", false);
+  else
+  {
+    uint8_t data[LEN_DATA], read_data[LEN_DATA];
+    for (int i = 0; i < LEN_DATA; i++)
+      data[i] = (i % 3 == 2) ? 0xFD : 0xFF;
+
+    check("writeTxRx of FF FF FD succeeds",
+          packetHandler->writeTxRx(portHandler, DXL_ID, ADDR_DATA, LEN_DATA, data, &dxl_error) == COMM_SUCCESS && dxl_error == 0);
+    check("readTxRx reads FF FF FD back",
+          packetHandler->readTxRx(portHandler, DXL_ID, ADDR_DATA, LEN_DATA, read_data, &dxl_error) == COMM_SUCCESS
+          && memcmp(data, read_data, LEN_DATA) == 0);
+
+    // a whole packet with room for its CRC16 only
+    uint8_t txpacket[12 + LEN_DATA];    // 12: header, instruction, address and CRC16
+    uint8_t rxpacket[64];
+    txpacket[4] = DXL_ID;
+    txpacket[5] = DXL_LOBYTE(LEN_DATA + 5);
+    txpacket[6] = DXL_HIBYTE(LEN_DATA + 5);
+    txpacket[7] = INST_WRITE;
+    txpacket[8] = DXL_LOBYTE(ADDR_DATA);
+    txpacket[9] = DXL_HIBYTE(ADDR_DATA);
+    for (int i = 0; i < LEN_DATA; i++)
+      txpacket[10 + i] = (i < 3) ? data[i] : (uint8_t)~data[i];    // FF FF FD, then other data
+
+    check("txRxPacket of FF FF FD in a buffer without room for the stuffing succeeds",
+          packetHandler->txRxPacket(portHandler, txpacket, rxpacket, &dxl_error) == COMM_SUCCESS && dxl_error == 0);
+    check("the packet of txRxPacket is not stuffed",
+          DXL_MAKEWORD(txpacket[5], txpacket[6]) == LEN_DATA + 5 && txpacket[15] == (uint8_t)~data[5]);
+    // the status packet of the write, as txRxPacket() receives it
+    int tx_result = packetHandler->txPacket(portHandler, txpacket);
+    portHandler->setPacketTimeout(10.0);
+    check("txPacket and rxPacket of the same packet succeed",
+          tx_result == COMM_SUCCESS && packetHandler->rxPacket(portHandler, rxpacket) == COMM_SUCCESS);
+    check("readTxRx reads the data of txRxPacket back",
+          packetHandler->readTxRx(portHandler, DXL_ID, ADDR_DATA, LEN_DATA, read_data, &dxl_error) == COMM_SUCCESS
+          && memcmp(&txpacket[10], read_data, LEN_DATA) == 0);
+
+    // FF FF FD up to TXPACKET_MAX_LEN: the stuffed packet is longer than it
+    static uint8_t long_data[TXPACKET_MAX_LEN - 12];
+    for (int i = 0; i < (int)sizeof(long_data); i++)
+      long_data[i] = (i % 3 == 2) ? 0xFD : 0xFF;
+    check("writeTxRx of a packet longer than TXPACKET_MAX_LEN once stuffed fails with COMM_TX_ERROR",
+          packetHandler->writeTxRx(portHandler, DXL_ID, ADDR_DATA, sizeof(long_data), long_data, &dxl_error) == COMM_TX_ERROR);
+    check("writeTxRx of FF FF FD succeeds after it",
+          packetHandler->writeTxRx(portHandler, DXL_ID, ADDR_DATA, LEN_DATA, data, &dxl_error) == COMM_SUCCESS && dxl_error == 0);
+  }
+
+  portHandler->closePort();
+  delete portHandler;
+
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
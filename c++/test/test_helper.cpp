@@ -0,0 +1,41 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+
+#include "test_helper.h"
+
+static int failure_count = 0;
+
+void check(const char *title, bool passed)
+{
+  printf("[%s] %s\n", passed ? "PASS" : "FAIL", title);
+  if (passed == false)
+    failure_count++;
+}
+
+int getFailureCount()
+{
+  return failure_count;
+}
+
+double getTime()
+{
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return (double)tv.tv_sec + (double)tv.tv_nsec * 0.000000001;
+}
@@ -0,0 +1,51 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#ifndef DYNAMIXEL_SDK_TEST_TEST_HELPER_H_
+#define DYNAMIXEL_SDK_TEST_TEST_HELPER_H_
+
+
+#include "dynamixel_sdk.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The function that reports a check of a test, and counts it when it failed
+/// @param title What is checked
+/// @param passed Whether the check passed
+////////////////////////////////////////////////////////////////////////////////
+void    check(const char *title, bool passed);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The function that returns the number of the checks failed
+////////////////////////////////////////////////////////////////////////////////
+int     getFailureCount();
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The function that returns the monotonic time in sec
+////////////////////////////////////////////////////////////////////////////////
+double  getTime();
+
+// the tests, which run the SDK on the simulated Dynamixels of SimulatedBus
+void    testLatencyTimer();
+void    testBaudChange();
+void    testPortReconnect();
+void    testBaudScan();
+void    testStalePolicy();
+void    testZeroLengthWrite();
+void    testByteStuffing();
+void    testWaitPort();
+
+
+#endif /* DYNAMIXEL_SDK_TEST_TEST_HELPER_H_ */
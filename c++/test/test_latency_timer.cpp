@@ -0,0 +1,168 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// PortHandlerLinux on a pseudo-terminal with a fake sysfs tree in a temporary directory, as the usb-serial driver
+// would show it: a latency timer higher than the one requested is lowered, a lower one is kept,
+// and the packet timeout follows the latency timer read.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include "port_handler_linux.h"
+#include "test_helper.h"
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_ID                          1
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        57600
+#define BUS_NAME                        "latency_timer"
+
+static bool makeDirs(const char *path)
+{
+  char dir[PATH_MAX];
+  strcpy(dir, path);
+  for (char *slash = strchr(dir + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/'))
+  {
+    *slash = 0;
+    mkdir(dir, 0755);
+    *slash = '/';
+  }
+  return (mkdir(dir, 0755) == 0 || access(dir, F_OK) == 0);
+}
+
+static void writeValue(const char *path, int value)
+{
+  FILE *fp = fopen(path, "w");
+  if (fp != NULL)
+  {
+    fprintf(fp, "%d\n", value);
+    fclose(fp);
+  }
+}
+
+static int readValue(const char *path)
+{
+  int   value = -1;
+  FILE *fp    = fopen(path, "r");
+  if (fp != NULL)
+  {
+    if (fscanf(fp, "%d", &value) != 1)
+      value = -1;
+    fclose(fp);
+  }
+  return value;
+}
+
+void testLatencyTimer()
+{
+  char pty_name[100];
+  char sysfs_root[] = "/tmp/dxl_sysfs_XXXXXX";
+  char usb_serial[PATH_MAX], usb_serial_timer[PATH_MAX + 20];
+  char tty_class[PATH_MAX], tty_class_timer[PATH_MAX + 20];
+  char real_name[PATH_MAX];
+
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  bus->addDevice(DXL_ID, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE);
+  if (bus->openPty(pty_name, sizeof(pty_name)) == false || realpath(pty_name, real_name) == NULL)
+  {
+    check("open the pseudo-terminal", false);
+    return;
+  }
+  if (mkdtemp(sysfs_root) == NULL)
+  {
+    check("make the fake sysfs directory", false);
+    bus->closeServer();
+    return;
+  }
+
+  // the driver shows /sys/bus/usb-serial/devices/ttyUSBx/latency_timer, named after the device the port resolves to
+  const char *tty_name = strrchr(real_name, '/') + 1;
+  snprintf(usb_serial, sizeof(usb_serial), "%s/bus/usb-serial/devices/%s", sysfs_root, tty_name);
+  snprintf(usb_serial_timer, sizeof(usb_serial_timer), "%s/latency_timer", usb_serial);
+  snprintf(tty_class, sizeof(tty_class), "%s/class/tty/%s/device", sysfs_root, tty_name);
+  snprintf(tty_class_timer, sizeof(tty_class_timer), "%s/latency_timer", tty_class);
+  makeDirs(usb_serial);
+  printf("Pseudo-terminal %s, fake sysfs %s\n", pty_name, sysfs_root);
+
+  dynamixel::PortHandlerLinux   *portHandler   = new dynamixel::PortHandlerLinux(pty_name);
+  dynamixel::PacketHandler      *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+  uint16_t dxl_model_number;
+
+  portHandler->setSysfsRoot(sysfs_root);
+  portHandler->setBaudRate(BAUDRATE);
+
+  // no latency timer: the default one is used for the packet timeout
+  portHandler->openPort();
+  check("no latency timer: the default 16 msec is used", portHandler->getLatencyTimer() == 16);
+
+  // the default of the usb-serial driver is lowered to the one requested
+  writeValue(usb_serial_timer, 16);
+  portHandler->openPort();
+  check("latency timer 16: it is lowered to 1", readValue(usb_serial_timer) == 1 && portHandler->getLatencyTimer() == 1);
+  check("ping with latency timer 1", packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) == COMM_SUCCESS);
+
+  // a latency timer lower than the one requested, as set by a udev rule, is not raised
+  portHandler->setLatencyRequest(4);
+  portHandler->openPort();
+  check("latency timer 1, request 4: it is kept at 1", readValue(usb_serial_timer) == 1 && portHandler->getLatencyTimer() == 1);
+
+  // the latency timer of the tty class is found when the usb-serial one is not there
+  unlink(usb_serial_timer);
+  makeDirs(tty_class);
+  writeValue(tty_class_timer, 16);
+  portHandler->openPort();
+  check("tty class latency timer 16, request 4: it is lowered to 4", readValue(tty_class_timer) == 4 && portHandler->getLatencyTimer() == 4);
+
+  // the packet timeout follows the latency timer read
+  portHandler->setPacketTimeout((uint16_t)14);
+  double timeout_4 = (double)portHandler->getRemainingNs();
+  writeValue(tty_class_timer, 1);
+  portHandler->openPort();
+  portHandler->setPacketTimeout((uint16_t)14);
+  double timeout_1 = (double)portHandler->getRemainingNs();
+  check("packet timeout is 6 msec shorter with latency timer 1 than 4", timeout_4 - timeout_1 > 5000000.0);
+
+  portHandler->closePort();
+  delete portHandler;
+  bus->closeServer();
+
+  unlink(tty_class_timer);
+  rmdir(tty_class);
+  snprintf(tty_class, sizeof(tty_class), "%s/class/tty/%s", sysfs_root, tty_name);
+  rmdir(tty_class);
+  snprintf(tty_class, sizeof(tty_class), "%s/class/tty", sysfs_root);
+  rmdir(tty_class);
+  snprintf(tty_class, sizeof(tty_class), "%s/class", sysfs_root);
+  rmdir(tty_class);
+  rmdir(usb_serial);
+  snprintf(usb_serial, sizeof(usb_serial), "%s/bus/usb-serial/devices", sysfs_root);
+  rmdir(usb_serial);
+  snprintf(usb_serial, sizeof(usb_serial), "%s/bus/usb-serial", sysfs_root);
+  rmdir(usb_serial);
+  snprintf(usb_serial, sizeof(usb_serial), "%s/bus", sysfs_root);
+  rmdir(usb_serial);
+  rmdir(sysfs_root);
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
@@ -0,0 +1,66 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// The tests of the SDK, which need no Dynamixel: they run on the simulated Dynamixels of SimulatedBus,
+// through the simulated ports and the pseudo-terminals which it serves.
+// Usage: dxl_test [test name ...]
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helper.h"
+
+struct TestCase
+{
+  const char *name;
+  void      (*run)();
+};
+
+static const TestCase test_cases[] =
+{
+  { "latency_timer",  testLatencyTimer },
+  { "baud_change",    testBaudChange },
+  { "port_reconnect", testPortReconnect },
+  { "baud_scan",      testBaudScan },
+  { "stale_policy",   testStalePolicy },
+  { "zero_length_write", testZeroLengthWrite },
+  { "byte_stuffing",  testByteStuffing },
+  { "wait_port",      testWaitPort },
+};
+static const int TEST_COUNT = sizeof(test_cases) / sizeof(test_cases[0]);
+
+int main(int argc, char *argv[])
+{
+  for (int i = 0; i < TEST_COUNT; i++)
+  {
+    bool selected = (argc <= 1);
+    for (int arg = 1; arg < argc; arg++)
+    {
+      if (strcmp(argv[arg], test_cases[i].name) == 0)
+        selected = true;
+    }
+    if (selected == false)
+      continue;
+
+    printf("*** %s\n", test_cases[i].name);
+    test_cases[i].run();
+  }
+
+  printf("%d failed\n", getFailureCount());
+  return (getFailureCount() == 0) ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// PortHandlerLinux on a USB serial which is unplugged and plugged back, as the kernel and udev show it:
+// the port is opened by a symbolic link in a temporary directory, as in /dev/serial/by-id,
+// to a pseudo-terminal served by a simulated Dynamixel. The pseudo-terminal is closed and the link removed
+// to unplug it, and a new pseudo-terminal is linked to plug it back.
+// The transactions fail at once while the port is lost, and the port is reopened with its baudrate
+// by the next transaction, after the reconnect callback pinged the Dynamixel.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "port_handler_linux.h"
+#include "test_helper.h"
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_ID                          1
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define BUS_NAME                        "port_reconnect"
+
+#define REPLUG_COUNT                    3
+#define LOST_PING_COUNT                 100
+
+struct ReconnectState
+{
+  dynamixel::PacketHandler *packetHandler;
+  int calls;
+  int pings;
+};
+
+// revalidate the Dynamixel which is known, instead of scanning the bus again
+static void onReconnect(dynamixel::PortHandlerLinux *port, void *arg)
+{
+  ReconnectState *state = (ReconnectState *)arg;
+  uint16_t dxl_model_number;
+
+  state->calls++;
+  if (state->packetHandler->ping(port, DXL_ID, &dxl_model_number) == COMM_SUCCESS && dxl_model_number == DXL_MODEL_NUMBER)
+    state->pings++;
+}
+
+static bool plug(dynamixel::SimulatedBus *bus, const char *link_name)
+{
+  char pty_name[100];
+
+  if (bus->openPty(pty_name, sizeof(pty_name)) == false)
+    return false;
+  return (symlink(pty_name, link_name) == 0);
+}
+
+static void unplug(dynamixel::SimulatedBus *bus, const char *link_name)
+{
+  unlink(link_name);
+  bus->closeServer();
+}
+
+void testPortReconnect()
+{
+  char by_id[] = "/tmp/dxl_by_id_XXXXXX";
+  char link_name[100];
+
+  if (mkdtemp(by_id) == NULL)
+  {
+    check("make the link directory", false);
+    return;
+  }
+  snprintf(link_name, sizeof(link_name), "%s/usb-ROBOTIS_U2D2-if00-port0", by_id);
+
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  bus->addDevice(DXL_ID, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE);
+
+  dynamixel::PortHandlerLinux   *portHandler   = new dynamixel::PortHandlerLinux(link_name);
+  dynamixel::PacketHandler      *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+  ReconnectState state = { packetHandler, 0, 0 };
+  uint16_t dxl_model_number;
+
+  portHandler->setReconnectCallback(onReconnect, &state);
+  if (plug(bus, link_name) == false)
+    check("open the pseudo-terminal", false);
+  else if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+    check("open the port", false);
+  else
+  {
+    check("ping before the unplug", packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) == COMM_SUCCESS);
+
+    for (int replug = 1; replug <= REPLUG_COUNT; replug++)
+    {
+      printf("Unplug %d\n", replug);
+      unplug(bus, link_name);
+
+      check("the first ping after the unplug fails", packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) != COMM_SUCCESS);
+      check("the port is lost", portHandler->isPortLost());
+
+      // the packet timeout of a ping is some msec: the lost port fails without waiting for it
+      int    failed = 0;
+      double start  = getTime();
+      for (int i = 0; i < LOST_PING_COUNT; i++)
+      {
+        if (packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) != COMM_SUCCESS)
+          failed++;
+      }
+      double each = (getTime() - start) / LOST_PING_COUNT;
+      printf("  %d pings of the lost port failed in %.1f usec each\n", failed, each * 1000000.0);
+      check("the pings of the lost port fail in less than 100 usec", failed == LOST_PING_COUNT && each < 0.0001);
+
+      printf("Plug %d\n", replug);
+      if (plug(bus, link_name) == false)
+      {
+        check("open the pseudo-terminal", false);
+        break;
+      }
+
+      check("the first ping after the plug succeeds", packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) == COMM_SUCCESS);
+      check("the port is reopened with its baudrate", portHandler->isPortLost() == false
+            && portHandler->getReconnectCount() == replug && portHandler->getBaudRate() == BAUDRATE);
+      check("the reconnect callback pinged the Dynamixel", state.calls == replug && state.pings == replug);
+    }
+  }
+
+  // Close port
+  portHandler->closePort();
+  delete portHandler;
+
+  unplug(bus, link_name);
+  rmdir(by_id);
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
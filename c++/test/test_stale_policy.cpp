@@ -0,0 +1,131 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// The stale byte policies on simulated Dynamixels read through a pseudo-terminal: every tenth read is abandoned
+// after its instruction packet, so that its status packet is left in the port when the next instruction packet
+// is written. For each policy it prints the transactions per second, the flushes of the port,
+// and the late status packets counted, and every other read succeeds.
+//
+
+#include <stdio.h>
+
+#include "test_helper.h"
+
+// Control table address
+#define ADDR_PRO_PRESENT_POSITION       132
+
+// Data Byte Length
+#define LEN_PRO_PRESENT_POSITION        4
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_COUNT                       4                   // Simulated Dynamixel ID: 1 ~ DXL_COUNT
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define BUS_NAME                        "stale_policy"
+
+#define TRANSACTION_COUNT               5000
+#define ABANDON_PERIOD                  10                  // every tenth read is abandoned
+#define STATUS_LENGTH                   15                  // status packet of the read: 11 bytes and the data
+#define LATE_TIME                       100000000           // nsec for the status packet abandoned to arrive at most
+#define POLL_TIME                       100000              // nsec between the checks of its arrival
+
+void testStalePolicy()
+{
+  const int   policy[3]       = { dynamixel::PortHandler::STALE_FLUSH_, dynamixel::PortHandler::STALE_DRAIN_, dynamixel::PortHandler::STALE_ADAPTIVE_ };
+  const char *policy_name[3]  = { "flush", "drain", "adaptive" };
+  char port_name[100];
+
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  for (int id = 1; id <= DXL_COUNT; id++)
+    bus->addDevice(id, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE)->setReturnDelayTime(0);
+  if (bus->openPty(port_name, sizeof(port_name)) == false)
+  {
+    check("open the pseudo-terminal", false);
+    dynamixel::SimulatedBus::removeBus(BUS_NAME);
+    return;
+  }
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(port_name);
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+
+  uint8_t dxl_error = 0;
+  uint32_t dxl_present_position;
+
+  if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+  {
+    check("open the port", false);
+    delete portHandler;
+    bus->closeServer();
+    dynamixel::SimulatedBus::removeBus(BUS_NAME);
+    return;
+  }
+
+  printf("%d reads on %s, every %dth abandoned\n", TRANSACTION_COUNT, port_name, ABANDON_PERIOD);
+  printf("%-10s %10s %8s %8s %8s %10s %8s\n", "policy", "per sec", "failed", "flushes", "drains", "abandoned", "stale");
+
+  for (int p = 0; p < 3; p++)
+  {
+    int failed = 0, abandoned = 0;
+
+    portHandler->setStalePolicy(policy[p]);
+    portHandler->resetStaleStats();
+    portHandler->resetIoStats();
+
+    double start = getTime();
+    for (int i = 0; i < TRANSACTION_COUNT; i++)
+    {
+      uint8_t id = (uint8_t)(i % DXL_COUNT + 1);
+      if (i % ABANDON_PERIOD == ABANDON_PERIOD - 1)
+      {
+        // give up the status packet, which arrives before the next instruction packet
+        packetHandler->readTx(portHandler, id, ADDR_PRO_PRESENT_POSITION, LEN_PRO_PRESENT_POSITION);
+        portHandler->endTransaction();
+        // wait until it is in the port, as the server of the bus may be held back for longer than any fixed sleep
+        int64_t late = portHandler->getMonotonicNs() + LATE_TIME;
+        while (portHandler->getBytesAvailable() < STATUS_LENGTH && portHandler->getMonotonicNs() < late)
+          portHandler->sleepUntil(portHandler->getMonotonicNs() + POLL_TIME);
+        abandoned++;
+        continue;
+      }
+      if (packetHandler->read4ByteTxRx(portHandler, id, ADDR_PRO_PRESENT_POSITION, &dxl_present_position, &dxl_error) != COMM_SUCCESS)
+        failed++;
+    }
+    double elapsed = getTime() - start;
+
+    dynamixel::StaleStats   stale = portHandler->getStaleStats();
+    dynamixel::PortIoStats  io    = portHandler->getIoStats();
+    printf("%-10s %10.0f %8d %8d %8d %10d %8d\n", policy_name[p], TRANSACTION_COUNT / elapsed, failed,
+           (int)io.flushes, (int)stale.drains, abandoned, (int)stale.stale_packets);
+
+    check("every read which is not abandoned succeeds", failed == 0);
+    if (policy[p] == dynamixel::PortHandler::STALE_FLUSH_)
+      check("the flush drops the late status packets without counting them", stale.stale_packets == 0 && stale.flushes > 0);
+    else
+      check("the late status packets are counted without a flush",
+            (int)stale.stale_packets == abandoned && io.flushes == 0);
+  }
+
+  // Close port
+  portHandler->closePort();
+  delete portHandler;
+
+  bus->closeServer();
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
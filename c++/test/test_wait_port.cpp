@@ -0,0 +1,100 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// PortHandlerLinux::waitPort() on a pseudo-terminal served by a simulated Dynamixel returns at once
+// for the bytes left in the receive buffer by a short readPort(), which the kernel has no more of,
+// and sleeps until the packet timeout when nothing is left.
+//
+
+#include <stdio.h>
+
+#include "port_handler_linux.h"
+#include "test_helper.h"
+
+// Protocol version
+#define PROTOCOL_VERSION                2.0
+
+// Default setting
+#define DXL_ID                          1
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define BUS_NAME                        "wait_port"
+
+#define WAIT_TIMEOUT                    50.0                // msec
+#define STATUS_LENGTH                   14                  // status packet of a ping
+
+void testWaitPort()
+{
+  char pty_name[100];
+
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  bus->addDevice(DXL_ID, PROTOCOL_VERSION, DXL_MODEL_NUMBER, BAUDRATE)->setReturnDelayTime(0);
+  if (bus->openPty(pty_name, sizeof(pty_name)) == false)
+  {
+    check("open the pseudo-terminal", false);
+    dynamixel::SimulatedBus::removeBus(BUS_NAME);
+    return;
+  }
+
+  dynamixel::PortHandlerLinux *portHandler = new dynamixel::PortHandlerLinux(pty_name);
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(PROTOCOL_VERSION);
+  uint8_t txpacket[10] = { 0 };
+  uint8_t rxpacket[STATUS_LENGTH];
+
+  if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+    check("open the port", false);
+  else
+  {
+    portHandler->setWaitStrategy(dynamixel::PortHandler::WAIT_BLOCK_);
+
+    // a ping whose status packet is read into the receive buffer at once, and served one byte of it
+    txpacket[4] = DXL_ID;
+    txpacket[5] = 3;
+    txpacket[7] = INST_PING;
+    packetHandler->txPacket(portHandler, txpacket);
+    portHandler->setPacketTimeout(WAIT_TIMEOUT);
+    int read_length = 0;
+    while (read_length == 0 && portHandler->waitPort())
+      read_length = portHandler->readPort(rxpacket, 1);
+    check("the first byte of the status packet is read", read_length == 1);
+
+    portHandler->setPacketTimeout(WAIT_TIMEOUT);
+    double start  = getTime();
+    bool   waited = portHandler->waitPort();
+    double each   = getTime() - start;
+    printf("  waitPort() for the buffered bytes: %.1f usec\n", each * 1000000.0);
+    check("waitPort() returns at once for the buffered bytes", waited && each < 0.001);
+    check("the rest of the status packet is read from the buffer",
+          portHandler->readPort(&rxpacket[1], STATUS_LENGTH - 1) == STATUS_LENGTH - 1);
+
+    portHandler->setPacketTimeout(WAIT_TIMEOUT);
+    start  = getTime();
+    waited = portHandler->waitPort();
+    each   = getTime() - start;
+    printf("  waitPort() without bytes: %.1f msec\n", each * 1000.0);
+    check("waitPort() without bytes returns false at the packet timeout", waited == false && each >= WAIT_TIMEOUT * 0.001 * 0.9);
+
+    portHandler->endTransaction();
+  }
+
+  // Close port
+  portHandler->closePort();
+  delete portHandler;
+
+  bus->closeServer();
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
@@ -0,0 +1,86 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+//
+// The writes of length 0 of both protocols on simulated Dynamixels through the simulated port "sim://":
+// the packet handlers make them in buffers sized for the header of the instruction packet,
+// and nothing is written past it, with or without a data pointer.
+// Each one succeeds, and the Dynamixel still answers after it.
+//
+
+#include <stdio.h>
+
+#include "test_helper.h"
+
+// Default setting
+#define DXL_ID                          1
+#define DXL_MODEL_NUMBER                1060
+#define BAUDRATE                        1000000
+#define BUS_NAME                        "zero_length_write"
+#define DEVICENAME                      "sim://" BUS_NAME
+
+#define ADDR_GOAL_POSITION              30
+
+static void writeZeroLength(dynamixel::PortHandler *portHandler, float protocol_version)
+{
+  dynamixel::PacketHandler *packetHandler = dynamixel::PacketHandler::getPacketHandler(protocol_version);
+  uint8_t   data[1]   = { 0 };
+  uint8_t   dxl_error = 0;
+  uint16_t  dxl_model_number;
+  char      title[100];
+
+  printf("Protocol %.1f\n", protocol_version);
+
+  dxl_error = 0xFF;
+  check("writeTxRx of length 0 succeeds",
+        packetHandler->writeTxRx(portHandler, DXL_ID, ADDR_GOAL_POSITION, 0, data, &dxl_error) == COMM_SUCCESS && dxl_error == 0);
+  dxl_error = 0xFF;
+  check("writeTxRx of length 0 without data succeeds",
+        packetHandler->writeTxRx(portHandler, DXL_ID, ADDR_GOAL_POSITION, 0, 0, &dxl_error) == COMM_SUCCESS && dxl_error == 0);
+  dxl_error = 0xFF;
+  check("regWriteTxRx of length 0 succeeds",
+        packetHandler->regWriteTxRx(portHandler, DXL_ID, ADDR_GOAL_POSITION, 0, data, &dxl_error) == COMM_SUCCESS && dxl_error == 0);
+  check("writeTxOnly of length 0 to all succeeds",
+        packetHandler->writeTxOnly(portHandler, BROADCAST_ID, ADDR_GOAL_POSITION, 0, data) == COMM_SUCCESS);
+  check("syncWriteTxOnly of no Dynamixel succeeds",
+        packetHandler->syncWriteTxOnly(portHandler, ADDR_GOAL_POSITION, 4, 0, 0) == COMM_SUCCESS);
+  if (protocol_version == 2.0)
+    check("bulkWriteTxOnly of no Dynamixel succeeds", packetHandler->bulkWriteTxOnly(portHandler, 0, 0) == COMM_SUCCESS);
+
+  snprintf(title, sizeof(title), "ping after the writes of length 0 finds model %d", DXL_MODEL_NUMBER);
+  check(title, packetHandler->ping(portHandler, DXL_ID, &dxl_model_number) == COMM_SUCCESS && dxl_model_number == DXL_MODEL_NUMBER);
+}
+
+void testZeroLengthWrite()
+{
+  dynamixel::SimulatedBus *bus = dynamixel::SimulatedBus::getBus(BUS_NAME);
+  bus->addDevice(DXL_ID, 1.0, DXL_MODEL_NUMBER, BAUDRATE);
+  bus->addDevice(DXL_ID, 2.0, DXL_MODEL_NUMBER, BAUDRATE);
+
+  dynamixel::PortHandler *portHandler = dynamixel::PortHandler::getPortHandler(DEVICENAME);
+  if (portHandler->openPort() == false || portHandler->setBaudRate(BAUDRATE) == false)
+    check("open the port", false);
+  else
+  {
+    writeZeroLength(portHandler, 1.0);
+    writeZeroLength(portHandler, 2.0);
+  }
+
+  portHandler->closePort();
+  delete portHandler;
+
+  dynamixel::SimulatedBus::removeBus(BUS_NAME);
+}
@@ -23,6 +23,7 @@
 #define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_DYNAMIXELSDK_H_
 
 
+#include "baud_scanner.h"
 #include "group_bulk_read.h"
 #include "group_bulk_write.h"
 #include "group_sync_read.h"
@@ -30,5 +31,23 @@
 #include "packet_handler.h"
 #include "port_handler.h"
 
+#if defined(__linux__) || defined(__APPLE__)
+#include "port_handler_sim.h"
+#include "port_handler_tcp.h"
+#include "port_handler_loopback.h"
+#include "port_handler_record.h"
+#include "port_handler_replay.h"
+#include "port_handler_broker.h"
+#include "port_broker.h"
+#include "simulated_bus.h"
+#include "port_worker.h"
+#include "realtime_profile.h"
+#include "virtual_clock.h"
+#endif
+
+#if defined(__linux__)
+#include "port_handler_uring.h"
+#endif
+
 
 #endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_DYNAMIXELSDK_H_ */
@@ -0,0 +1,170 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for sharing a port with other processes through a Unix domain socket
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_PORTBROKER_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_PORTBROKER_H_
+
+
+#include <pthread.h>
+#include "port_handler.h"
+
+// frames between PortBroker and PortHandlerBroker: type (uint8), reserved (uint8) and length (uint16) in little endian,
+// followed by length bytes
+#define BROKER_FRAME_HEADER   4
+#define BROKER_FRAME_MAX      4096  // length of a frame, with the header
+
+#define BROKER_INFO           1     // broker -> client: baudrate of the bus (int32)
+#define BROKER_WRITE          2     // client -> broker: priority (uint8), and the bytes to write on the bus
+#define BROKER_WRITTEN        3     // broker -> client: result of the write (int32)
+#define BROKER_DATA           4     // broker -> client: bytes read from the bus
+#define BROKER_CLEAR          5     // client -> broker: clear the port
+#define BROKER_RELEASE        6     // client -> broker: let the bus go
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the transactions of the clients run by PortBroker
+////////////////////////////////////////////////////////////////////////////////
+struct PortBrokerStats
+{
+  int       clients;          ///< clients connected
+  uint64_t  holds;            ///< times the bus was given to a client
+  uint64_t  writes;           ///< packets written on the bus for the clients
+  uint64_t  expired_holds;    ///< holds ended by the hold limit, instead of the client
+  int64_t   max_queue_ns;     ///< longest time a packet waited for the bus held by other clients
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the broker which shares a port with the processes connected to a Unix domain socket
+/// @description The processes open the port by PortHandler::getPortHandler("unix://<socket path>"), which gives
+/// @description a PortHandlerBroker, and use it with PacketHandler and the groups as any other port.
+/// @description The first packet written by a client gives it the bus, which it keeps until its port is unlocked,
+/// @description as at the end of a transaction or of a PortTransaction, so that its transactions are not mixed
+/// @description with the ones of the other clients. The bytes received meanwhile go to that client only.
+/// @description Between the holds, the bus goes to the waiting client of the highest priority,
+/// @description and to the one waiting longest among the same priority.
+/// @description A hold longer than the hold limit is ended by the broker, so that a client which stopped
+/// @description does not keep the bus from the others.
+/// @description The broker runs the clients on its own thread, and takes the port by PortHandler::tryLockPort()
+/// @description for each hold, so that the threads of the process of the broker can still use the port between them.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortBroker
+{
+ public:
+  static const int MAX_CLIENTS_ = 16;             ///< Clients connected at once
+  static const int DEFAULT_HOLD_LIMIT_ = 1000;    ///< Longest hold of the bus by a client in msec
+
+ private:
+  struct Client
+  {
+    int       fd;
+    uint8_t   frame[BROKER_FRAME_MAX];
+    int       frame_length;
+    bool      pending;            // a packet waits for the bus
+    int       priority;
+    uint64_t  sequence;
+    int64_t   queued_ns;
+    uint8_t   packet[BROKER_FRAME_MAX];
+    int       packet_length;
+  };
+
+  PortHandler  *port_;
+  char          socket_path_[108];
+  int           listen_fd_;
+
+  Client        clients_[MAX_CLIENTS_];
+  int           holder_;          // client which has the bus, or -1
+  int64_t       hold_start_ns_;
+  int64_t       hold_limit_ns_;
+  uint64_t      sequence_;
+
+  pthread_t     thread_;
+  bool          running_;
+
+  // written by the thread of the broker only, and read by PortBroker::getStats()
+  int           client_count_;
+  uint64_t      holds_;
+  uint64_t      writes_;
+  uint64_t      expired_holds_;
+  int64_t       max_queue_ns_;
+
+  static void  *brokerThread(void *broker);
+  void          run();
+
+  void          accept();
+  void          disconnect(int client);
+  bool          receive(int client);
+  void          handleFrame(int client, int type, uint8_t *payload, int length);
+  bool          send(int client, int type, const uint8_t *payload, int length);
+
+  void          grant();
+  void          release();
+  void          write(int client, uint8_t *packet, int length);
+  void          forward();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes the broker of the port
+  /// @param port PortHandler instance, which is opened with its baudrate, and outlives the broker
+  /// @param socket_path Path of the Unix domain socket
+  ////////////////////////////////////////////////////////////////////////////////
+  PortBroker(PortHandler *port, const char *socket_path);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that stops the broker
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortBroker();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that creates the socket, and starts the thread which runs the clients
+  /// @description A socket file left at the path by a broker which stopped is replaced.
+  /// @return false
+  /// @return   when the socket or the thread is not able to be created
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      start();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that disconnects the clients, and removes the socket
+  ////////////////////////////////////////////////////////////////////////////////
+  void      stop();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns whether the broker is running
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      isRunning();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the longest hold of the bus by a client
+  /// @param msec Time in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setHoldLimit(double msec) { hold_limit_ns_ = (int64_t)(msec * 1000000.0); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the transactions run for the clients
+  ////////////////////////////////////////////////////////////////////////////////
+  PortBrokerStats getStats();
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_PORTBROKER_H_ */
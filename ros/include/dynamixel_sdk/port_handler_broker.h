@@ -0,0 +1,255 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for port control through a PortBroker in another process
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_BROKER_PORTHANDLERBROKER_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_BROKER_PORTHANDLERBROKER_H_
+
+
+#include "port_handler.h"
+#include "port_broker.h"
+
+#define BROKER_PORT_PREFIX "unix://"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the port which shares the bus of a PortBroker
+/// @description The port name is the path of the Unix domain socket of the broker after "unix://".
+/// @description A packet written waits until the broker gives the bus to the port, and the port keeps the bus
+/// @description until it is unlocked, as at the end of a transaction, so that PacketHandler and the groups work unchanged.
+/// @description The priority of the port, set by the option "priority", orders it among the ports waiting for the bus.
+/// @description The baudrate is the one of the bus, which the broker sets.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortHandlerBroker : public PortHandler
+{
+ public:
+  static const int RX_BUFFER_SIZE_ = 4096;  ///< Size of the receive buffer
+  static const int DEFAULT_PRIORITY_ = 0;   ///< Priority of the port, from 0 to 255, where the higher one goes first
+
+ private:
+  char          port_name_[108];
+  int           socket_fd_;
+  int           baudrate_;
+  int           priority_;
+  bool          holding_;           // the broker has given the bus to the port
+  double        tx_time_per_byte;
+
+  uint8_t       frame_[BROKER_FRAME_MAX];
+  int           frame_length_;
+  bool          written_;
+  int           written_result_;
+
+  uint8_t       rx_buffer_[RX_BUFFER_SIZE_];
+  int           rx_head_;
+  int           rx_tail_;
+
+  bool          sendFrame(int type, PortSegment *segments, int count);
+  bool          receive(int timeout_ms);
+
+ protected:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that gives the bus back to the broker when the port is unlocked
+  ////////////////////////////////////////////////////////////////////////////////
+  void    releasePort();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortHandler and gets port_name
+  /// @description The function initializes instance of PortHandler and gets port_name.
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandlerBroker(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function calls PortHandlerBroker::closePort() to close the port.
+  ////////////////////////////////////////////////////////////////////////////////
+  virtual ~PortHandlerBroker() { closePort(); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that opens the port
+  /// @description The function connects to the broker, and takes the baudrate of the bus from it.
+  /// @return false
+  /// @return   when the broker is not able to be connected
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    openPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that closes the port
+  /// @description The function disconnects from the broker, which lets the bus go.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    closePort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that clears the port
+  /// @description The function drops the bytes received, and clears the port of the broker when the port has the bus.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    clearPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets port name into the port handler
+  /// @description The function sets port name into the port handler.
+  /// @param port_name Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPortName(const char *port_name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns port name set into the port handler
+  /// @description The function returns current port name set into the port handler.
+  /// @return Port name
+  ////////////////////////////////////////////////////////////////////////////////
+  char   *getPortName();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets baudrate into the port handler
+  /// @description The baudrate of the bus is set by the broker, so that the function only accepts it
+  /// @description once the port is opened.
+  /// @param baudrate Baudrate
+  /// @return false
+  /// @return   when the port is opened and baudrate is not the baudrate of the bus
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setBaudRate(const int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns current baudrate set into the port handler
+  /// @description The function returns the baudrate of the bus once the port is opened.
+  /// @return Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBaudRate();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description The function takes "baud", "priority", and the options of PortHandler::setOption().
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOption(const char *key, const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the priority of the port among the ports waiting for the bus
+  /// @param priority Priority from 0 to 255, where the higher one goes first
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPriority(int priority) { priority_ = (priority < 0) ? 0 : ((priority > 255) ? 255 : priority); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the priority of the port
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getPriority() { return priority_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks how much bytes are able to be read from the port buffer
+  /// @description The function returns the number of bytes which the broker has sent from the bus.
+  /// @return Length of read-able bytes in the port buffer
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getBytesAvailable();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads bytes from the port buffer
+  /// @description The function gets the bytes which the broker has sent from the bus,
+  /// @description and returns a number of bytes read.
+  /// @param packet Buffer for the packet received
+  /// @param length Length of the buffer for read
+  /// @return Length of bytes read
+  ////////////////////////////////////////////////////////////////////////////////
+  int     readPort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes bytes on the port buffer
+  /// @description The function sends the bytes to the broker, and waits until the broker has written them on the bus,
+  /// @description so that the packet timeout starts when the packet is on the bus.
+  /// @param packet Buffer which would be written on the port buffer
+  /// @param length Length of the buffer for write
+  /// @return -1
+  /// @return   when the port is not opened, or the broker is disconnected
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePort(uint8_t *packet, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes on the port buffer
+  /// @description The function sends the segments to the broker in a frame, which is written on the bus at once.
+  /// @param segments Segments to write
+  /// @param count Number of the segments
+  /// @return -1
+  /// @return   when the port is not opened, or the broker is disconnected
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePortV(PortSegment *segments, int count);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function points data to the bytes received, and returns the number.
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandlerBroker::peekPort() from the receive buffer
+  /// @param length Length of the bytes to remove
+  ////////////////////////////////////////////////////////////////////////////////
+  void    consumePort(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function sleeps on the socket until the broker sends bytes, or the packet timeout is passed.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    waitPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with packet_length,
+  /// @description as PortHandlerLinux does with the latency timer of the USB serial.
+  /// @param packet_length Length of the packet expected to be received
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(uint16_t packet_length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets and starts stopwatch for watching packet timeout
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with msec.
+  /// @param msec Time of packet timeout in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketTimeout(double msec);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether packet timeout is occurred
+  /// @description The function checks whether current monotonic time is passed by the packet deadline.
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isPacketTimeout();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets absolute deadline for watching packet timeout
+  /// @param deadline_ns Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketDeadline(int64_t deadline_ns);
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_BROKER_PORTHANDLERBROKER_H_ */
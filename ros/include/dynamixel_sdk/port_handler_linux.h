@@ -24,6 +24,7 @@
 
 
 #include "port_handler.h"
+#include "realtime_profile.h"
 
 namespace dynamixel
 {
@@ -33,21 +34,63 @@ namespace dynamixel
 ////////////////////////////////////////////////////////////////////////////////
 class PortHandlerLinux : public PortHandler
 {
- private:
+ public:
+  static const int RX_BUFFER_SIZE_ = 4096; ///< Size of the receive buffer
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The type of the function called when the port is reopened after its device came back
+  ////////////////////////////////////////////////////////////////////////////////
+  typedef void (*ReconnectCallback)(PortHandlerLinux *port, void *arg);
+
+ protected:
   int     socket_fd_;
   int     baudrate_;
   char    port_name_[100];
+  char    sysfs_root_[100];
+  int     latency_timer_;
+  int     latency_request_;
+
+  uint8_t rx_buffer_[RX_BUFFER_SIZE_];
+  int     rx_head_;
+  int     rx_tail_;
+
+  bool    rs485_enabled_;
+  int     rs485_delay_before_send_;
+  int     rs485_delay_after_send_;
+  bool    echo_suppression_;
+  int     echo_pending_;
 
-  double  packet_start_time_;
-  double  packet_timeout_;
   double  tx_time_per_byte;
+  int64_t tx_end_ns_;
+
+  bool    port_lost_;
+  bool    reconnecting_;
+  int     inotify_fd_;
+  int64_t reconnect_retry_ns_;
+  int     reconnect_count_;
+  ReconnectCallback reconnect_callback_;
+  void   *reconnect_arg_;
+
+  void    markPortLost();
+  void    addTransmit(int length);
 
+ private:
   bool    setupPort(const int cflag_baud);
+  bool    setBaudrateInPlace(int speed);
   bool    setCustomBaudrate(int speed);
   int     getCFlagBaud(const int baudrate);
 
-  double  getCurrentTime();
-  double  getTimeSinceStart();
+  int     fillBuffer();
+  bool    spinBuffer(int64_t until_ns);
+
+  void    setupLowLatency();
+  bool    setupRS485();
+  bool    getLatencyTimerPath(char *path, int length);
+
+  void    watchPort();
+  void    unwatchPort();
+  bool    isPortBack();
+  bool    reconnect();
 
  public:
   ////////////////////////////////////////////////////////////////////////////////
@@ -98,6 +141,8 @@ class PortHandlerLinux : public PortHandler
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that sets baudrate into the port handler
   /// @description The function sets baudrate into the port handler.
+  /// @description When the port is opened, the baudrate is changed in place by termios2 / BOTHER,
+  /// @description which accepts any baudrate the driver supports. The port is reopened only when it fails.
   /// @param baudrate Baudrate
   /// @return false
   /// @return   when error was occurred during port opening
@@ -112,22 +157,81 @@ class PortHandlerLinux : public PortHandler
   ////////////////////////////////////////////////////////////////////////////////
   int     getBaudRate();
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the sysfs root where the latency timer of the USB serial is looked up
+  /// @description The function sets the directory used instead of "/sys" by the next PortHandlerLinux::openPort().
+  /// @param sysfs_root Sysfs root directory
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setSysfsRoot(const char *sysfs_root);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the latency timer used for packet timeout
+  /// @description The function returns the latency timer of the USB serial which is read when the port is opened,
+  /// @description or the default latency timer when it is not a USB serial or it could not be read.
+  /// @return Latency timer in msec
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getLatencyTimer();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the latency timer requested from the USB serial when the port is opened
+  /// @description The latency timer is written to sysfs by the next PortHandlerLinux::openPort() when it is writable
+  /// @description and higher than the one requested, so that a lower latency timer is never raised.
+  /// @param msec Latency timer in msec, 1 by default
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setLatencyRequest(int msec) { latency_request_ = msec; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description The function takes "baud", "latency" in msec (PortHandlerLinux::setLatencyRequest()),
+  /// @description "rs485", "rts_before" and "rts_after" in msec (PortHandlerLinux::setRS485()) and "echo"
+  /// @description (PortHandlerLinux::setEchoSuppression()), and the options of PortHandler::setOption().
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOption(const char *key, const char *value);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the kernel RS-485 mode of the port
+  /// @description The function asks the driver by TIOCSRS485 to drive RTS high while sending and low to receive.
+  /// @description The setting is applied to the opened port at once, and again whenever the port is opened.
+  /// @param enable Whether the RS-485 mode is enabled
+  /// @param delay_rts_before_send Delay in msec between RTS high and the first bit sent
+  /// @param delay_rts_after_send Delay in msec between the last bit sent and RTS low
+  /// @return false
+  /// @return   when the driver does not support the RS-485 mode
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setRS485(bool enable, int delay_rts_before_send = 0, int delay_rts_after_send = 0);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets whether the bytes echoed by the half-duplex bus are discarded
+  /// @description The function makes the port count the bytes written and discard the same number of bytes
+  /// @description received next, so that the echo of the instruction packet never reaches the packet handler.
+  /// @description PortHandlerLinux::clearPort() drops the count of the echo not received yet.
+  /// @param enable Whether the echo is discarded
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setEchoSuppression(bool enable);
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that checks how much bytes are able to be read from the port buffer
-  /// @description The function checks how much bytes are able to be read from the port buffer
-  /// @description and returns the number.
+  /// @description The function returns the number of bytes in the receive buffer,
+  /// @description or asks the kernel by FIONREAD only when the receive buffer is empty.
   /// @return Length of read-able bytes in the port buffer
   ////////////////////////////////////////////////////////////////////////////////
   int     getBytesAvailable();
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that reads bytes from the port buffer
-  /// @description The function gets bytes from the port buffer,
+  /// @description The function gets bytes from the receive buffer,
   /// @description and returns a number of bytes read.
+  /// @description When the receive buffer is empty, it is refilled with everything the kernel has by a single read().
   /// @param packet Buffer for the packet received
   /// @param length Length of the buffer for read
-  /// @return -1
-  /// @return   when error was occurred
+  /// @return 0
+  /// @return   when error was occurred or nothing is received
   /// @return or Length of bytes read
   ////////////////////////////////////////////////////////////////////////////////
   int     readPort(uint8_t *packet, int length);
@@ -144,25 +248,125 @@ class PortHandlerLinux : public PortHandler
   ////////////////////////////////////////////////////////////////////////////////
   int     writePort(uint8_t *packet, int length);
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes segments of bytes on the port buffer as a single packet
+  /// @description The function writes the segments by a single writev() without copying them,
+  /// @description and returns a number of bytes which are successfully written.
+  /// @param segments Segments which would be written on the port buffer
+  /// @param count Number of the segments
+  /// @return -1
+  /// @return   when error was occurred
+  /// @return or Length of bytes written
+  ////////////////////////////////////////////////////////////////////////////////
+  int     writePortV(PortSegment *segments, int count);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns bytes received in the port buffer without removing them
+  /// @description The function points data to the received bytes, and returns the number.
+  /// @description The bytes are kept until PortHandlerLinux::consumePort() is called.
+  /// @description When the buffer is empty or the caller has seen all of it, the bytes left are moved to the front
+  /// @description and the room behind them is filled with everything the kernel has by a single read().
+  /// @param data Pointer to be set to the received bytes
+  /// @return Length of the received bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  int     peekPort(uint8_t **data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes bytes returned by PortHandlerLinux::peekPort() from the receive buffer
+  /// @param length Length of the bytes to remove, which removes all of them when it is longer
+  ////////////////////////////////////////////////////////////////////////////////
+  void    consumePort(int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that waits until bytes are able to be read from the port buffer
+  /// @description The function sleeps in ppoll() on the port until bytes arrive
+  /// @description or the time left until the packet timeout is passed.
+  /// @description It polls the port without sleeping before, as PortHandler::setWaitStrategy() sets.
+  /// @return false
+  /// @return   when the packet timeout is passed without any byte to read
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    waitPort();
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that sets and starts stopwatch for watching packet timeout
-  /// @description The function sets the stopwatch by getting current time and the time of packet timeout with packet_length.
+  /// @description The function sets the packet deadline from the time of packet timeout with packet_length,
+  /// @description counted from when the bytes written are out on the wire, as PortHandlerLinux::getTransmitEndNs() tells.
   /// @param packet_length Length of the packet expected to be received
   ////////////////////////////////////////////////////////////////////////////////
   void    setPacketTimeout(uint16_t packet_length);
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that sets and starts stopwatch for watching packet timeout
-  /// @description The function sets the stopwatch by getting current time and the time of packet timeout with msec.
+  /// @description The function sets the packet deadline from current time and the time of packet timeout with msec.
   /// @param packet_length Length of the packet expected to be received
   ////////////////////////////////////////////////////////////////////////////////
   void    setPacketTimeout(double msec);
 
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that checks whether packet timeout is occurred
-  /// @description The function checks whether current time is passed by the time of packet timeout from the time set by PortHandlerLinux::setPacketTimeout().
+  /// @description The function checks whether current monotonic time is passed by the packet deadline.
   ////////////////////////////////////////////////////////////////////////////////
   bool    isPacketTimeout();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets absolute deadline for watching packet timeout
+  /// @description The function sets the CLOCK_MONOTONIC time when the packet timeout is occurred.
+  /// @param deadline_ns Deadline in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setPacketDeadline(int64_t deadline_ns);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns when the bytes written so far are out on the wire
+  /// @description Each write is sent after the bytes written before it, in the time of its length at the baudrate.
+  /// @description When the driver reports by TIOCOUTQ more bytes still queued than that, its queue is used instead.
+  /// @return Time on CLOCK_MONOTONIC, which is not before the current time
+  ////////////////////////////////////////////////////////////////////////////////
+  int64_t getTransmitEndNs();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that prepares the calling thread to run the transactions of the port in real time
+  /// @description The function applies profile to the calling thread, and touches the receive buffer of the port.
+  /// @description It is called by the thread which runs the control loop, after the port is opened.
+  /// @param profile RealtimeProfile instance, whose RealtimeProfile::getReport() tells the steps applied
+  /// @return false
+  /// @return   when a step of profile was not applied
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    applyRealtimeProfile(RealtimeProfile *profile);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reopens the port when its device came back
+  /// @description The port is lost when a read or write fails by EIO, ENODEV or ENXIO, or the device hangs up,
+  /// @description as a USB serial does when it is unplugged or browns out. The lost port is closed,
+  /// @description and the transactions fail at once, without waiting for the packet timeout.
+  /// @description The directory of the port name, such as /dev/serial/by-id, is watched by inotify meanwhile.
+  /// @description When the device appears there again, or every 500 msec in case the directory itself was removed,
+  /// @description the function reopens the port with the previous baudrate, RS-485 and echo settings,
+  /// @description and then calls the reconnect callback.
+  /// @description The function is called by PortHandler::beginTransaction(), so no call is needed by the application.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    checkPort();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the function called when the lost port is reopened
+  /// @description The callback runs before the transaction which found the device again, and without the port taken,
+  /// @description so it can run transactions itself: for example, it can ping the IDs which the group objects
+  /// @description already have, and check the registers they read, instead of scanning the bus again.
+  /// @param callback Callback, or 0 to remove it
+  /// @param arg Argument passed to the callback
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setReconnectCallback(ReconnectCallback callback, void *arg = 0);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that checks whether the device of the port is gone
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isPortLost() { return port_lost_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns how many times the lost port was reopened
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getReconnectCount() { return reconnect_count_; }
 };
 
 }
@@ -113,6 +113,17 @@ class PortHandlerMac : public PortHandler
   ////////////////////////////////////////////////////////////////////////////////
   int     getBaudRate();
 
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets an option of the port by its name
+  /// @description The function takes "baud", and the options of PortHandler::setOption().
+  /// @param key Name of the option
+  /// @param value Value of the option
+  /// @return false
+  /// @return   when the option is unknown to the port, or its value is invalid
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    setOption(const char *key, const char *value);
+
   ////////////////////////////////////////////////////////////////////////////////
   /// @brief The function that checks how much bytes are able to be read from the port buffer
   /// @description The function checks how much bytes are able to be read from the port buffer
@@ -0,0 +1,321 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for running the transactions of a port on a thread of its own
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_PORTWORKER_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_PORTWORKER_H_
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "port_handler.h"
+#include "packet_handler.h"
+#include "group_sync_read.h"
+#include "group_sync_write.h"
+#include "group_bulk_read.h"
+#include "group_bulk_write.h"
+#include "realtime_profile.h"
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the bounded lock-free queue between a single producer and a single consumer
+/// @description The producer thread calls only PortWorkerQueue::push(), and the consumer thread calls only
+/// @description PortWorkerQueue::front() and PortWorkerQueue::pop(). Each side publishes its index by an atomic store,
+/// @description so that neither of them takes a lock or a system call.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+class PortWorkerQueue
+{
+ private:
+  T        *entries_;
+  uint32_t  mask_;
+  uint32_t  head_;                // advanced by the consumer
+  uint8_t   head_pad_[64 - sizeof(uint32_t)];
+  uint32_t  tail_;                // advanced by the producer
+  uint8_t   tail_pad_[64 - sizeof(uint32_t)];
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that allocates the queue
+  /// @param capacity Number of entries, which is rounded up to a power of two
+  ////////////////////////////////////////////////////////////////////////////////
+  PortWorkerQueue(int capacity)
+    : head_(0),
+      tail_(0)
+  {
+    uint32_t size = 1;
+    while ((int)size < capacity)
+      size *= 2;
+    entries_  = (T *)malloc(size * sizeof(T));
+    mask_     = size - 1;
+    // the pages of the entries are faulted in here, not in the first transactions
+    memset(entries_, 0, size * sizeof(T));
+  }
+
+  ~PortWorkerQueue() { free(entries_); }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the number of entries the queue can hold
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getCapacity() { return (int)mask_ + 1; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the number of entries in the queue
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getDepth()
+  {
+    return (int)(__atomic_load_n(&tail_, __ATOMIC_ACQUIRE) - __atomic_load_n(&head_, __ATOMIC_ACQUIRE));
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that adds an entry at the end of the queue
+  /// @param entry Entry to add
+  /// @return false
+  /// @return   when the queue is full
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      push(const T &entry)
+  {
+    uint32_t tail = tail_;
+    if (tail - __atomic_load_n(&head_, __ATOMIC_ACQUIRE) > mask_)
+      return false;
+    entries_[tail & mask_] = entry;
+    __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the first entry of the queue without removing it
+  /// @return 0
+  /// @return   when the queue is empty
+  /// @return or Pointer to the entry, which is valid until PortWorkerQueue::pop()
+  ////////////////////////////////////////////////////////////////////////////////
+  T        *front()
+  {
+    uint32_t head = head_;
+    if (head == __atomic_load_n(&tail_, __ATOMIC_ACQUIRE))
+      return 0;
+    return &entries_[head & mask_];
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that removes the first entry of the queue
+  ////////////////////////////////////////////////////////////////////////////////
+  void      pop()
+  {
+    __atomic_store_n(&head_, head_ + 1, __ATOMIC_RELEASE);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for a transaction to be run by PortWorker
+/// @description Single transactions carry their bytes in the request. Sync and bulk transactions refer to a group
+/// @description built in advance, which must not be touched until the completion of the request is returned.
+////////////////////////////////////////////////////////////////////////////////
+struct PortRequest
+{
+  static const int MAX_DATA_LEN_ = 64;  ///< Maximum length of the data of a single read or write
+
+  enum Type
+  {
+    PING,                 ///< PacketHandler::ping()
+    READ,                 ///< PacketHandler::readTxRx()
+    WRITE,                ///< PacketHandler::writeTxRx()
+    WRITE_TX_ONLY,        ///< PacketHandler::writeTxOnly()
+    SYNC_READ,            ///< GroupSyncRead::txRxPacket()
+    SYNC_WRITE,           ///< GroupSyncWrite::txPacket()
+    BULK_READ,            ///< GroupBulkRead::txRxPacket()
+    BULK_WRITE            ///< GroupBulkWrite::txPacket()
+  };
+
+  Type      type;
+  uint64_t  tag;                        ///< value of the caller returned with the completion
+  uint8_t   id;
+  uint16_t  address;
+  uint16_t  length;
+  uint8_t   data[MAX_DATA_LEN_];        ///< bytes to write
+  void     *group;                      ///< group of the sync or bulk transaction
+  int64_t   submit_ns;                  ///< time of the submission, set by PortWorker::submit()
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the result of a PortRequest
+////////////////////////////////////////////////////////////////////////////////
+struct PortCompletion
+{
+  PortRequest::Type type;
+  uint64_t  tag;                        ///< tag of the request
+  uint8_t   id;
+  int       result;                     ///< communication result of the transaction
+  uint8_t   error;                      ///< Dynamixel error of a single transaction
+  uint16_t  model_number;               ///< model number answered to PortRequest::PING
+  uint16_t  length;
+  uint8_t   data[PortRequest::MAX_DATA_LEN_]; ///< bytes read by PortRequest::READ
+  int64_t   submit_ns;                  ///< time the request was submitted, on PortHandler::getMonotonicNs() time base
+  int64_t   complete_ns;                ///< time the transaction was completed
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The structure for the statistics of PortWorker
+////////////////////////////////////////////////////////////////////////////////
+struct PortWorkerStats
+{
+  uint64_t  submitted;                  ///< requests taken by PortWorker::submit()
+  uint64_t  rejected;                   ///< requests refused because the request queue was full
+  uint64_t  completed;                  ///< completions pushed into the completion queue
+  uint64_t  stalls;                     ///< times the worker waited for room in the completion queue
+  int       request_depth;              ///< requests waiting now
+  int       completion_depth;           ///< completions not taken yet
+  int       max_request_depth;          ///< most requests ever waiting
+  int       max_completion_depth;       ///< most completions ever not taken
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class that runs the transactions of a port on a thread of its own
+/// @description A control thread submits PortRequest and takes PortCompletion back by PortWorker::poll(),
+/// @description so that it never blocks on the serial I/O. Both queues are bounded and lock-free, with a single producer
+/// @description and a single consumer, so that one control thread is expected to submit and poll.
+/// @description PortWorker::submit() returns false when the request queue is full, and the worker stops taking requests
+/// @description while the completion queue is full, so that a slow consumer slows the producer instead of losing results.
+/// @description While the worker runs, the port and the groups in flight belong to it.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC PortWorker
+{
+ private:
+  PortHandler    *port_;
+  PacketHandler  *packet_handler_;
+
+  PortWorkerQueue<PortRequest>    requests_;
+  PortWorkerQueue<PortCompletion> completions_;
+
+  pthread_t       thread_;
+  bool            running_;
+  bool            ready_;
+  RealtimeProfile *profile_;
+
+  uint64_t        submitted_;           // written by the control thread
+  uint64_t        rejected_;
+  int             max_request_depth_;
+  uint64_t        completed_;           // written by the worker thread
+  uint64_t        stalls_;
+  int             max_completion_depth_;
+
+  static void    *workerThread(void *worker);
+  void            run();
+  void            execute(PortRequest *request, PortCompletion *completion);
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes instance of PortWorker
+  /// @param port PortHandler instance, which is opened and set up by the caller
+  /// @param packet_handler PacketHandler instance
+  /// @param depth Number of entries of the request queue and of the completion queue
+  ////////////////////////////////////////////////////////////////////////////////
+  PortWorker(PortHandler *port, PacketHandler *packet_handler, int depth = 64);
+
+  virtual ~PortWorker();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that starts the thread of the worker
+  /// @return false
+  /// @return   when the thread could not be started
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    start();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the profile the thread of the worker applies to itself when it starts
+  /// @description PortWorker::start() returns after the profile is applied, and RealtimeProfile::getReport() tells the result.
+  /// @param profile RealtimeProfile instance, which lives as long as the worker, or 0 not to apply any
+  ////////////////////////////////////////////////////////////////////////////////
+  void    setRealtimeProfile(RealtimeProfile *profile) { profile_ = profile; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that stops the thread of the worker
+  /// @description The function waits for the transaction in progress. The requests not started are kept in the queue.
+  ////////////////////////////////////////////////////////////////////////////////
+  void    stop();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns whether the thread of the worker runs
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    isRunning();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that adds a request to the request queue
+  /// @param request Request to run
+  /// @return false
+  /// @return   when the request queue is full
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    submit(const PortRequest &request);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The functions that build a request and add it to the request queue
+  /// @description The group of a sync or bulk request must be kept as it is until its completion is returned.
+  /// @return false
+  /// @return   when the request queue is full, or the length is more than PortRequest::MAX_DATA_LEN_
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    submitPing      (uint8_t id, uint64_t tag);
+  bool    submitRead      (uint8_t id, uint16_t address, uint16_t length, uint64_t tag);
+  bool    submitWrite     (uint8_t id, uint16_t address, uint16_t length, uint8_t *data, uint64_t tag);
+  bool    submitWriteTxOnly(uint8_t id, uint16_t address, uint16_t length, uint8_t *data, uint64_t tag);
+  bool    submitSyncRead  (GroupSyncRead *group, uint64_t tag);
+  bool    submitSyncWrite (GroupSyncWrite *group, uint64_t tag);
+  bool    submitBulkRead  (GroupBulkRead *group, uint64_t tag);
+  bool    submitBulkWrite (GroupBulkWrite *group, uint64_t tag);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that takes a completion from the completion queue without blocking
+  /// @param completion Completion to be filled
+  /// @return false
+  /// @return   when no request is completed yet
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool    poll(PortCompletion *completion);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the number of requests which the request queue can take now
+  ////////////////////////////////////////////////////////////////////////////////
+  int     getRoom();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the statistics of the worker
+  ////////////////////////////////////////////////////////////////////////////////
+  PortWorkerStats getStats();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the port of the worker
+  ////////////////////////////////////////////////////////////////////////////////
+  PortHandler    *getPortHandler()    { return port_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the packet handler of the worker
+  ////////////////////////////////////////////////////////////////////////////////
+  PacketHandler  *getPacketHandler()  { return packet_handler_; }
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_PORTWORKER_H_ */
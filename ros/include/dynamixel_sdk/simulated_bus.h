@@ -0,0 +1,369 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+////////////////////////////////////////////////////////////////////////////////
+/// @file The file for the simulated Dynamixel bus
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_SIMULATEDBUS_H_
+#define DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_SIMULATEDBUS_H_
+
+
+#include <vector>
+#include "port_handler.h"
+
+#include <pthread.h>
+
+namespace dynamixel
+{
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for a Dynamixel simulated on the SimulatedBus
+/// @description The device keeps a control table memory image, and answers the instruction packets
+/// @description of its protocol version as the real Dynamixel does. ID, baudrate, return delay time and
+/// @description status return level are taken from the control table at the addresses of the protocol version.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC SimulatedDevice
+{
+ private:
+  float     protocol_version_;
+  int       baudrate_;
+  int       default_baudrate_;
+
+  uint8_t  *control_table_;
+  uint8_t  *default_table_;
+  uint16_t  control_table_size_;
+
+  bool      reg_pending_;
+  uint16_t  reg_address_;
+  uint16_t  reg_length_;
+  uint8_t  *reg_data_;
+
+  uint16_t  getAddressID();
+  uint16_t  getAddressBaudRate();
+  uint16_t  getAddressReturnDelayTime();
+  uint16_t  getAddressStatusReturnLevel();
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that initializes the control table of the device
+  /// @description The function fills the control table with model number, firmware version, ID, baudrate,
+  /// @description return delay time (250: 500 usec) and status return level (2: respond to all instructions).
+  /// @param id Dynamixel ID
+  /// @param protocol_version Protocol version (1.0 or 2.0)
+  /// @param model_number Model number
+  /// @param baudrate Baudrate
+  /// @param control_table_size Size of the control table in bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  SimulatedDevice(uint8_t id, float protocol_version, uint16_t model_number, int baudrate = PortHandler::DEFAULT_BAUDRATE_, uint16_t control_table_size = 1024);
+
+  virtual ~SimulatedDevice();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the protocol version which the device answers
+  /// @return Protocol version
+  ////////////////////////////////////////////////////////////////////////////////
+  float     getProtocolVersion()    { return protocol_version_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the ID of the device in the control table
+  /// @return Dynamixel ID
+  ////////////////////////////////////////////////////////////////////////////////
+  uint8_t   getID();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the ID of the device in the control table
+  /// @param id Dynamixel ID
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setID(uint8_t id);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the baudrate which the device communicates with
+  /// @return Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  int       getBaudRate()           { return baudrate_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the baudrate which the device communicates with
+  /// @description The function also sets the baudrate in the control table to the closest value of the protocol version.
+  /// @param baudrate Baudrate
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setBaudRate(int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the return delay time of the device
+  /// @return Time between the end of the instruction packet and the start of the status packet in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  int64_t   getReturnDelayNs();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the return delay time in the control table
+  /// @param return_delay_time Return delay time in 2 usec
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setReturnDelayTime(uint8_t return_delay_time);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the status return level in the control table
+  /// @return 0 (respond to ping only), 1 (respond to ping and read) or 2 (respond to all)
+  ////////////////////////////////////////////////////////////////////////////////
+  uint8_t   getStatusReturnLevel();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the status return level in the control table
+  /// @param status_return_level Status return level
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setStatusReturnLevel(uint8_t status_return_level);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the control table memory image
+  /// @return Control table
+  ////////////////////////////////////////////////////////////////////////////////
+  uint8_t  *getControlTable()       { return control_table_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the size of the control table memory image
+  /// @return Size of the control table in bytes
+  ////////////////////////////////////////////////////////////////////////////////
+  uint16_t  getControlTableSize()   { return control_table_size_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that reads data from the control table
+  /// @param address Address of the data
+  /// @param length Length of the data
+  /// @param data Buffer for the data
+  /// @return false
+  /// @return   when the data is out of the control table
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      readControlTable(uint16_t address, uint16_t length, uint8_t *data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes data on the control table
+  /// @description The function also applies the baudrate when the data covers the baudrate in the control table.
+  /// @param address Address of the data
+  /// @param length Length of the data
+  /// @param data Data to write
+  /// @return false
+  /// @return   when the data is out of the control table
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      writeControlTable(uint16_t address, uint16_t length, uint8_t *data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that keeps data to be written by the Action instruction
+  /// @param address Address of the data
+  /// @param length Length of the data
+  /// @param data Data to write
+  /// @return false
+  /// @return   when the data is out of the control table
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      regWriteControlTable(uint16_t address, uint16_t length, uint8_t *data);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that writes the data kept by SimulatedDevice::regWriteControlTable()
+  /// @return false
+  /// @return   when there is no data kept
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      action();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that restores the control table to the image of the constructor
+  /// @param keep_id Whether the ID is kept
+  /// @param keep_baudrate Whether the baudrate is kept
+  ////////////////////////////////////////////////////////////////////////////////
+  void      factoryReset(bool keep_id, bool keep_baudrate);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The class for the simulated Dynamixel bus which SimulatedDevice are connected to
+/// @description The bus takes instruction packets written at a baudrate and returns the status packets of
+/// @description the devices with the time each byte arrives, which is modelled from the baudrate (10 bits a byte),
+/// @description the return delay time of the devices and the transport delay of the bus.
+/// @description Devices with a baudrate different from the instruction packet by more than 3% do not answer.
+/// @description Buses are found by name, so that PortHandlerSim opened as "sim://<name>" uses the bus <name>.
+/// @description The bus is locked while it transfers packets and while devices are added or found, so that ports,
+/// @description the thread of a loopback channel and the thread of SimulatedBus::openPty() may share it.
+/// @description A SimulatedDevice itself is not locked; change its settings while no transfer is in progress.
+////////////////////////////////////////////////////////////////////////////////
+class WINDECLSPEC SimulatedBus
+{
+ private:
+  char      name_[100];
+  std::vector<SimulatedDevice *> devices_;
+
+  int64_t   transport_delay_ns_;
+  int64_t   bus_free_ns_;
+
+  // status packets of the transfer in progress
+  uint8_t  *response_;
+  int64_t  *response_arrival_ns_;
+  int       response_max_;
+  int       response_length_;
+  int64_t   response_end_ns_;
+  int64_t   byte_ns_;
+
+  pthread_mutex_t lock_;        // taken by transfer() and by the functions on devices_
+
+#if defined(__linux__)
+  int       server_fd_;         // master of the pseudo-terminal, or socket listening for TCP
+  int       server_baudrate_;   // 0 when the baudrate is taken from the pseudo-terminal
+  int       pty_slave_fd_;
+  bool      server_running_;
+  pthread_t server_thread_;
+
+  static void *serverThread(void *bus);
+  void      serve();
+  bool      startServer();
+  int       getPtyBaudRate();
+#endif
+
+  SimulatedDevice *findDevice(uint8_t id, float protocol_version, int baudrate);
+
+  void      handlePacket1(uint8_t *packet, int baudrate);
+  void      handlePacket2(uint8_t *packet, int baudrate);
+  void      sendStatus1(SimulatedDevice *device, uint8_t error, uint8_t *param, uint16_t param_length);
+  void      sendStatus2(SimulatedDevice *device, uint8_t error, uint8_t *param, uint16_t param_length);
+  void      sendReadStatus(SimulatedDevice *device, uint16_t address, uint16_t length);
+  void      appendResponse(uint8_t *packet, int length, int64_t start_ns);
+
+ public:
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the bus of the name, which is created when it does not exist
+  /// @param name Name of the bus
+  /// @return SimulatedBus instance
+  ////////////////////////////////////////////////////////////////////////////////
+  static SimulatedBus *getBus(const char *name);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that deletes the bus of the name and its devices
+  /// @param name Name of the bus
+  ////////////////////////////////////////////////////////////////////////////////
+  static void removeBus(const char *name);
+
+  SimulatedBus(const char *name);
+
+  virtual ~SimulatedBus();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the name of the bus
+  /// @return Name of the bus
+  ////////////////////////////////////////////////////////////////////////////////
+  const char *getName()             { return name_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that connects a device to the bus
+  /// @description The bus deletes the device when it is deleted.
+  /// @param device SimulatedDevice instance
+  /// @return SimulatedDevice instance
+  ////////////////////////////////////////////////////////////////////////////////
+  SimulatedDevice *addDevice(SimulatedDevice *device);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that creates a device and connects it to the bus
+  /// @param id Dynamixel ID
+  /// @param protocol_version Protocol version (1.0 or 2.0)
+  /// @param model_number Model number
+  /// @param baudrate Baudrate
+  /// @return SimulatedDevice instance
+  ////////////////////////////////////////////////////////////////////////////////
+  SimulatedDevice *addDevice(uint8_t id, float protocol_version, uint16_t model_number, int baudrate = PortHandler::DEFAULT_BAUDRATE_);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the device of the ID and protocol version
+  /// @param id Dynamixel ID
+  /// @param protocol_version Protocol version (1.0 or 2.0)
+  /// @return 0
+  /// @return   when there is no such device
+  /// @return or SimulatedDevice instance
+  ////////////////////////////////////////////////////////////////////////////////
+  SimulatedDevice *getDevice(uint8_t id, float protocol_version = 2.0);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that disconnects and deletes all devices on the bus
+  ////////////////////////////////////////////////////////////////////////////////
+  void      clearDevices();
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sets the delay added to the arrival of every status byte
+  /// @description The delay models the transport between the bus and the host, such as the USB latency timer.
+  /// @param delay_ns Delay in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  void      setTransportDelay(int64_t delay_ns) { transport_delay_ns_ = delay_ns; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that returns the delay added to the arrival of every status byte
+  /// @return Delay in nanoseconds
+  ////////////////////////////////////////////////////////////////////////////////
+  int64_t   getTransportDelay()     { return transport_delay_ns_; }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that sends instruction packets on the bus and returns the status packets
+  /// @description The function takes the packets which are written at sent_ns with the baudrate,
+  /// @description lets the devices answer them in order, and fills response and arrival_ns
+  /// @description with the bytes of the status packets and the time each byte arrives at the host.
+  /// @description Bytes which are not a valid instruction packet are ignored as the devices do.
+  /// @param packet Instruction packets
+  /// @param length Length of the instruction packets
+  /// @param baudrate Baudrate of the instruction packets
+  /// @param sent_ns Time the instruction packets are written on getMonotonicNs() time base
+  /// @param response Buffer for the status packets
+  /// @param arrival_ns Buffer for the arrival time of each byte of the status packets
+  /// @param response_max Size of the buffers
+  /// @param taken_length Pointer to be set to the length of the whole instruction packets taken, or 0
+  /// @return Length of the status packets
+  ////////////////////////////////////////////////////////////////////////////////
+  int       transfer(uint8_t *packet, int length, int baudrate, int64_t sent_ns, uint8_t *response, int64_t *arrival_ns, int response_max, int *taken_length = 0);
+
+#if defined(__linux__)
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that serves the bus on a pseudo-terminal
+  /// @description The function opens a pseudo-terminal and starts a thread which answers the instruction packets
+  /// @description written on its slave with the baudrate set on the slave, and writes each burst of status bytes
+  /// @description when its last byte arrives. The slave can be opened by PortHandlerLinux as a serial port.
+  /// @param slave_name Buffer for the name of the slave, such as /dev/pts/3
+  /// @param length Size of the buffer
+  /// @return false
+  /// @return   when the pseudo-terminal could not be opened
+  /// @return or true
+  ////////////////////////////////////////////////////////////////////////////////
+  bool      openPty(char *slave_name, int length);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that serves the bus on a TCP port as a serial-to-Ethernet gateway does
+  /// @description The function listens on the loopback address and starts a thread which accepts a connection at a time,
+  /// @description answers the instruction packets received with the baudrate, and sends each burst of status bytes
+  /// @description when its last byte arrives. PortHandlerTcp can connect to it as "tcp://127.0.0.1:<port>".
+  /// @param port TCP port number, or 0 to let the system choose one
+  /// @param baudrate Baudrate of the bus behind the gateway
+  /// @return 0
+  /// @return   when the socket could not be opened
+  /// @return or TCP port number listened
+  ////////////////////////////////////////////////////////////////////////////////
+  int       listenTcp(int port, int baudrate);
+
+  ////////////////////////////////////////////////////////////////////////////////
+  /// @brief The function that stops the thread started by SimulatedBus::openPty() or SimulatedBus::listenTcp()
+  ////////////////////////////////////////////////////////////////////////////////
+  void      closeServer();
+#endif
+};
+
+}
+
+
+#endif /* DYNAMIXEL_SDK_INCLUDE_DYNAMIXEL_SDK_SIMULATEDBUS_H_ */
@@ -156,6 +156,11 @@ int GroupSyncRead::txRxPacket()
 
   int result         = COMM_TX_FAIL;
 
+  // the status packets of all the IDs are received before another thread takes the port
+  PortTransaction transaction(port_);
+  if (transaction.isLocked() == false)
+    return COMM_PORT_BUSY;
+
   result = txPacket();
   if (result != COMM_SUCCESS)
     return result;
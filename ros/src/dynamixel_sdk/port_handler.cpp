@@ -17,11 +17,31 @@
 /* Author: zerom, Ryu Woon Jung (Leon) */
 
 #if defined(__linux__)
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include "port_handler.h"
 #include "port_handler_linux.h"
+#include "port_handler_uring.h"
+#include "port_handler_sim.h"
+#include "port_handler_tcp.h"
+#include "port_handler_loopback.h"
+#include "port_handler_replay.h"
+#include "port_handler_broker.h"
 #elif defined(__APPLE__)
+#include <time.h>
+#include <mach/mach_time.h>
+#include <pthread.h>
+#include <sched.h>
 #include "port_handler.h"
 #include "port_handler_mac.h"
+#include "port_handler_sim.h"
+#include "port_handler_tcp.h"
+#include "port_handler_loopback.h"
+#include "port_handler_replay.h"
+#include "port_handler_broker.h"
 #elif defined(_WIN32) || defined(_WIN64)
 #define WINDLLEXPORT
 #include "port_handler.h"
@@ -31,10 +51,57 @@
 #include "../../include/dynamixel_sdk/port_handler_arduino.h"
 #endif
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LATENCY_MIN_SAMPLES   8   // status packets measured before the adaptive timeout is used
+#define LATENCY_MAX_BACKOFF   3   // timeouts in a row before the usual packet timeout is used
+
+#define TTY_PORT_PREFIX       "tty://"
+#define MAX_PORT_SCHEMES      16
+#define MAX_SCHEME_LEN        16
+#define MAX_PORT_URI_LEN      256
+
 using namespace dynamixel;
 
-PortHandler *PortHandler::getPortHandler(const char *port_name)
+// the monotonic clock of the system, which the lock of the port always waits on
+static int64_t getSystemNs()
+{
+#if defined(__linux__)
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return (int64_t)tv.tv_sec * 1000000000LL + (int64_t)tv.tv_nsec;
+#elif defined(__APPLE__)
+  static mach_timebase_info_data_t timebase = { 0, 0 };
+  if (timebase.denom == 0)
+    mach_timebase_info(&timebase);
+  return (int64_t)(mach_absolute_time() * timebase.numer / timebase.denom);
+#elif defined(_WIN32) || defined(_WIN64)
+  LARGE_INTEGER counter, freq;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&freq);
+  return (int64_t)(counter.QuadPart / freq.QuadPart) * 1000000000LL
+       + (int64_t)(counter.QuadPart % freq.QuadPart) * 1000000000LL / (int64_t)freq.QuadPart;
+#elif defined(ARDUINO) || defined(__OPENCR__) || defined(__OPENCM904__)
+  return (int64_t)micros() * 1000LL;
+#endif
+}
+
+// the schemes of PortHandler::getPortHandler()
+struct PortScheme
 {
+  char                      name[MAX_SCHEME_LEN];
+  PortHandler::PortFactory  factory;
+};
+static PortScheme port_schemes[MAX_PORT_SCHEMES];
+static int        port_scheme_count = 0;
+
+static PortHandler *createSerialPort(const char *port_name)
+{
+  if (strncmp(port_name, TTY_PORT_PREFIX, strlen(TTY_PORT_PREFIX)) == 0)
+    port_name += strlen(TTY_PORT_PREFIX);
+
 #if defined(__linux__)
   return (PortHandler *)(new PortHandlerLinux(port_name));
 #elif defined(__APPLE__)
@@ -45,3 +112,939 @@ PortHandler *PortHandler::getPortHandler(const char *port_name)
   return (PortHandler *)(new PortHandlerArduino(port_name));
 #endif
 }
+
+#if defined(__linux__) || defined(__APPLE__)
+static PortHandler *createSimPort(const char *port_name)
+{
+  return (PortHandler *)(new PortHandlerSim(port_name));
+}
+static PortHandler *createTcpPort(const char *port_name)
+{
+  return (PortHandler *)(new PortHandlerTcp(port_name));
+}
+static PortHandler *createLoopbackPort(const char *port_name)
+{
+  return (PortHandler *)(new PortHandlerLoopback(port_name));
+}
+static PortHandler *createReplayPort(const char *port_name)
+{
+  return (PortHandler *)(new PortHandlerReplay(port_name));
+}
+static PortHandler *createBrokerPort(const char *port_name)
+{
+  return (PortHandler *)(new PortHandlerBroker(port_name));
+}
+#endif
+#if defined(__linux__)
+static PortHandler *createUringPort(const char *port_name)
+{
+  return (PortHandler *)(new PortHandlerUring(port_name));
+}
+#endif
+
+static void registerSchemes()
+{
+  static bool registered = false;
+  if (registered)
+    return;
+  registered = true;
+
+  PortHandler::registerPortHandler("tty", createSerialPort);
+#if defined(__linux__) || defined(__APPLE__)
+  PortHandler::registerPortHandler("sim", createSimPort);
+  PortHandler::registerPortHandler("tcp", createTcpPort);
+  PortHandler::registerPortHandler("loop", createLoopbackPort);
+  PortHandler::registerPortHandler("replay", createReplayPort);
+  PortHandler::registerPortHandler("unix", createBrokerPort);
+#endif
+#if defined(__linux__)
+  PortHandler::registerPortHandler("uring", createUringPort);
+#endif
+}
+
+// atomic operations on the lock of the port; Arduino runs a single thread
+#if defined(_WIN32) || defined(_WIN64)
+static int compareExchange(int *value, int expected, int desired)
+{
+  return (int)InterlockedCompareExchange((volatile LONG *)value, desired, expected);
+}
+static int exchange(int *value, int desired)
+{
+  return (int)InterlockedExchange((volatile LONG *)value, desired);
+}
+static void increment(uint64_t *value)
+{
+  InterlockedIncrement64((volatile LONGLONG *)value);
+}
+static void add(uint64_t *value, uint64_t amount)
+{
+  InterlockedExchangeAdd64((volatile LONGLONG *)value, (LONGLONG)amount);
+}
+static uint64_t load(uint64_t *value)
+{
+  return (uint64_t)InterlockedCompareExchange64((volatile LONGLONG *)value, 0, 0);
+}
+static void store(uint64_t *value, uint64_t desired)
+{
+  InterlockedExchange64((volatile LONGLONG *)value, (LONGLONG)desired);
+}
+static void add(int64_t *value, int64_t amount)
+{
+  InterlockedExchangeAdd64((volatile LONGLONG *)value, (LONGLONG)amount);
+}
+static int64_t load(int64_t *value)
+{
+  return (int64_t)InterlockedCompareExchange64((volatile LONGLONG *)value, 0, 0);
+}
+static void store(int64_t *value, int64_t desired)
+{
+  InterlockedExchange64((volatile LONGLONG *)value, (LONGLONG)desired);
+}
+static void storeMax(int64_t *value, int64_t desired)
+{
+  LONGLONG old = InterlockedCompareExchange64((volatile LONGLONG *)value, 0, 0);
+  while (desired > old)
+  {
+    LONGLONG seen = InterlockedCompareExchange64((volatile LONGLONG *)value, (LONGLONG)desired, old);
+    if (seen == old)
+      break;
+    old = seen;
+  }
+}
+static void storeFlag(bool *flag, bool desired)
+{
+  InterlockedExchange8((volatile CHAR *)flag, (CHAR)desired);
+}
+static uintptr_t loadOwner(uintptr_t *owner)
+{
+  return (uintptr_t)InterlockedCompareExchangePointer((PVOID volatile *)owner, 0, 0);
+}
+static void storeOwner(uintptr_t *owner, uintptr_t desired)
+{
+  InterlockedExchangePointer((PVOID volatile *)owner, (PVOID)desired);
+}
+static uintptr_t getThreadId()
+{
+  return (uintptr_t)GetCurrentThreadId();
+}
+#elif defined(__linux__) || defined(__APPLE__)
+static int compareExchange(int *value, int expected, int desired)
+{
+  __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+  return expected;
+}
+static int exchange(int *value, int desired)
+{
+  return __atomic_exchange_n(value, desired, __ATOMIC_ACQ_REL);
+}
+static void increment(uint64_t *value)
+{
+  __atomic_fetch_add(value, 1, __ATOMIC_RELAXED);
+}
+static void add(uint64_t *value, uint64_t amount)
+{
+  __atomic_fetch_add(value, amount, __ATOMIC_RELAXED);
+}
+static uint64_t load(uint64_t *value)
+{
+  return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+static void store(uint64_t *value, uint64_t desired)
+{
+  __atomic_store_n(value, desired, __ATOMIC_RELAXED);
+}
+static void add(int64_t *value, int64_t amount)
+{
+  __atomic_fetch_add(value, amount, __ATOMIC_RELAXED);
+}
+static int64_t load(int64_t *value)
+{
+  return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+static void store(int64_t *value, int64_t desired)
+{
+  __atomic_store_n(value, desired, __ATOMIC_RELAXED);
+}
+static void storeMax(int64_t *value, int64_t desired)
+{
+  int64_t old = __atomic_load_n(value, __ATOMIC_RELAXED);
+  while (desired > old && !__atomic_compare_exchange_n(value, &old, desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+static void storeFlag(bool *flag, bool desired)
+{
+  __atomic_store_n(flag, desired, __ATOMIC_RELAXED);
+}
+static uintptr_t loadOwner(uintptr_t *owner)
+{
+  return __atomic_load_n(owner, __ATOMIC_RELAXED);
+}
+static void storeOwner(uintptr_t *owner, uintptr_t desired)
+{
+  __atomic_store_n(owner, desired, __ATOMIC_RELAXED);
+}
+static uintptr_t getThreadId()
+{
+  return (uintptr_t)pthread_self();
+}
+#else
+static int compareExchange(int *value, int expected, int desired)
+{
+  int old = *value;
+  if (old == expected)
+    *value = desired;
+  return old;
+}
+static int exchange(int *value, int desired)
+{
+  int old = *value;
+  *value = desired;
+  return old;
+}
+static void increment(uint64_t *value)
+{
+  (*value)++;
+}
+static void add(uint64_t *value, uint64_t amount)
+{
+  *value += amount;
+}
+static uint64_t load(uint64_t *value)
+{
+  return *value;
+}
+static void store(uint64_t *value, uint64_t desired)
+{
+  *value = desired;
+}
+static void add(int64_t *value, int64_t amount)
+{
+  *value += amount;
+}
+static int64_t load(int64_t *value)
+{
+  return *value;
+}
+static void store(int64_t *value, int64_t desired)
+{
+  *value = desired;
+}
+static void storeMax(int64_t *value, int64_t desired)
+{
+  if (desired > *value)
+    *value = desired;
+}
+static void storeFlag(bool *flag, bool desired)
+{
+  *flag = desired;
+}
+static uintptr_t loadOwner(uintptr_t *owner)
+{
+  return *owner;
+}
+static void storeOwner(uintptr_t *owner, uintptr_t desired)
+{
+  *owner = desired;
+}
+static uintptr_t getThreadId()
+{
+  return 1;
+}
+#endif
+
+// sleeps while *value is 2, until woken up or timeout_ns is passed
+static void waitLock(int *value, int64_t timeout_ns)
+{
+#if defined(__linux__)
+  struct timespec ts;
+  ts.tv_sec  = (time_t)(timeout_ns / 1000000000LL);
+  ts.tv_nsec = (long)(timeout_ns % 1000000000LL);
+  syscall(SYS_futex, value, FUTEX_WAIT_PRIVATE, 2, (timeout_ns < 0) ? NULL : &ts, NULL, 0);
+#elif defined(__APPLE__)
+  (void)value;
+  (void)timeout_ns;
+  sched_yield();
+#elif defined(_WIN32) || defined(_WIN64)
+  (void)value;
+  (void)timeout_ns;
+  SwitchToThread();
+#else
+  (void)value;
+  (void)timeout_ns;
+#endif
+}
+
+static void wakeLock(int *value)
+{
+#if defined(__linux__)
+  syscall(SYS_futex, value, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+  (void)value;
+#endif
+}
+
+PortHandler::PortHandler()
+  : packet_deadline_ns_(0),
+    peek_length_(0),
+    lock_state_(0),
+    lock_owner_(0),
+    lock_depth_(0),
+    packet_hold_(false),
+    lock_timeout_(0.0),
+    latency_(0),
+    latency_margin_ns_(0),
+    latency_floor_ns_(0),
+    status_pending_(false),
+    status_id_(0),
+    status_start_ns_(0),
+    status_wire_ns_(0),
+    stale_policy_(STALE_FLUSH_),
+    stale_corrupt_(false),
+    clock_(0),
+    wait_strategy_(WAIT_BLOCK_),
+    wait_spin_ns_(WAIT_SPIN_USEC_ * 1000),
+    is_using_(false)
+{
+  resetLockStats();
+  resetStaleStats();
+  resetWaitStats();
+  resetIoStats();
+}
+
+PortHandler::~PortHandler()
+{
+  free(latency_);
+}
+
+PortHandler *PortHandler::getPortHandler(const char *port_name)
+{
+  char        name[MAX_PORT_URI_LEN];
+  const char *query   = strchr(port_name, '?');
+  int         length  = (query != 0) ? (int)(query - port_name) : (int)strlen(port_name);
+  PortFactory factory = createSerialPort;
+
+  registerSchemes();
+
+  // the port name without the query string
+  if (length >= MAX_PORT_URI_LEN)
+    length = MAX_PORT_URI_LEN - 1;
+  memcpy(name, port_name, length);
+  name[length] = 0;
+
+  const char *separator = strstr(name, "://");
+  if (separator != 0)
+  {
+    for (int i = 0; i < port_scheme_count; i++)
+    {
+      if ((int)strlen(port_schemes[i].name) == separator - name && strncmp(port_schemes[i].name, name, separator - name) == 0)
+      {
+        factory = port_schemes[i].factory;
+        break;
+      }
+    }
+  }
+
+  PortHandler *port = factory(name);
+  if (port != 0 && query != 0)
+    port->setOptions(query + 1);
+  return port;
+}
+
+bool PortHandler::registerPortHandler(const char *scheme, PortFactory factory)
+{
+  registerSchemes();
+
+  if (strlen(scheme) >= MAX_SCHEME_LEN)
+    return false;
+
+  for (int i = 0; i < port_scheme_count; i++)
+  {
+    if (strcmp(port_schemes[i].name, scheme) == 0)
+    {
+      port_schemes[i].factory = factory;
+      return true;
+    }
+  }
+
+  if (port_scheme_count >= MAX_PORT_SCHEMES)
+    return false;
+  strcpy(port_schemes[port_scheme_count].name, scheme);
+  port_schemes[port_scheme_count].factory = factory;
+  port_scheme_count++;
+  return true;
+}
+
+bool PortHandler::isOptionTrue(const char *value)
+{
+  return (strcmp(value, "1") == 0 || strcmp(value, "true") == 0 || strcmp(value, "on") == 0);
+}
+
+bool PortHandler::setOption(const char *key, const char *value)
+{
+  if (strcmp(key, "wait") == 0)
+  {
+    if (strcmp(value, "block") == 0)
+      setWaitStrategy(WAIT_BLOCK_, getWaitSpinTime());
+    else if (strcmp(value, "spin") == 0)
+      setWaitStrategy(WAIT_SPIN_, getWaitSpinTime());
+    else if (strcmp(value, "hybrid") == 0)
+      setWaitStrategy(WAIT_HYBRID_, getWaitSpinTime());
+    else
+      return false;
+    return true;
+  }
+  if (strcmp(key, "spin_us") == 0)
+  {
+    setWaitStrategy(getWaitStrategy(), atof(value));
+    return true;
+  }
+  if (strcmp(key, "stale") == 0)
+  {
+    if (strcmp(value, "flush") == 0)
+      setStalePolicy(STALE_FLUSH_);
+    else if (strcmp(value, "drain") == 0)
+      setStalePolicy(STALE_DRAIN_);
+    else if (strcmp(value, "adaptive") == 0)
+      setStalePolicy(STALE_ADAPTIVE_);
+    else
+      return false;
+    return true;
+  }
+  if (strcmp(key, "lock_timeout") == 0)
+  {
+    setLockTimeout(atof(value));
+    return true;
+  }
+  return false;
+}
+
+bool PortHandler::setOptions(const char *options)
+{
+  bool result = true;
+
+  while (*options != 0)
+  {
+    char        key[32], value[64];
+    const char *end   = strchr(options, '&');
+    const char *equal = strchr(options, '=');
+    int         length = (end != 0) ? (int)(end - options) : (int)strlen(options);
+
+    if (equal == 0 || equal - options >= length)
+      equal = options + length;   // an option without value, such as "rs485"
+
+    int key_length    = (int)(equal - options);
+    int value_length  = (equal < options + length) ? (int)(options + length - equal - 1) : 0;
+    if (key_length > 0 && key_length < (int)sizeof(key) && value_length < (int)sizeof(value))
+    {
+      memcpy(key, options, key_length);
+      key[key_length] = 0;
+      memcpy(value, equal + 1, value_length);
+      value[value_length] = 0;
+      if (value_length == 0 && equal == options + length)
+        strcpy(value, "1");
+
+      if (setOption(key, value) == false)
+      {
+        printf("[PortHandler::setOptions] Invalid option : %s=%s\n", key, value);
+        result = false;
+      }
+    }
+    else if (length > 0)
+    {
+      printf("[PortHandler::setOptions] Invalid option : %.*s\n", length, options);
+      result = false;
+    }
+
+    options += length;
+    if (*options == '&')
+      options++;
+  }
+  return result;
+}
+
+int PortHandler::writePortV(PortSegment *segments, int count)
+{
+  int length = 0, index = 0, result;
+
+  if (count == 1)
+    return writePort(segments[0].data, segments[0].length);
+
+  for (int i = 0; i < count; i++)
+    length += segments[i].length;
+
+  uint8_t *packet = (uint8_t *)malloc(length);
+  for (int i = 0; i < count; i++)
+  {
+    memcpy(&packet[index], segments[i].data, segments[i].length);
+    index += segments[i].length;
+  }
+
+  result = writePort(packet, length);
+
+  free(packet);
+  return result;
+}
+
+int64_t PortHandler::getMonotonicNs()
+{
+  if (clock_ != 0)
+    return clock_->getMonotonicNs();
+  return getSystemNs();
+}
+
+void PortHandler::sleepUntil(int64_t time_ns)
+{
+  if (clock_ != 0)
+  {
+    clock_->sleepUntil(time_ns);
+    return;
+  }
+
+  int64_t remaining = time_ns - getSystemNs();
+  if (remaining <= 0)
+    return;
+
+#if defined(__linux__) || defined(__APPLE__)
+  struct timespec ts;
+  ts.tv_sec  = (time_t)(remaining / 1000000000LL);
+  ts.tv_nsec = (long)(remaining % 1000000000LL);
+  nanosleep(&ts, NULL);
+#elif defined(_WIN32) || defined(_WIN64)
+  Sleep((DWORD)((remaining + 999999LL) / 1000000LL));
+#elif defined(ARDUINO) || defined(__OPENCR__) || defined(__OPENCM904__)
+  delayMicroseconds((unsigned int)((remaining + 999LL) / 1000LL));
+#endif
+}
+
+void PortHandler::setPacketDeadline(int64_t deadline_ns)
+{
+  packet_deadline_ns_ = deadline_ns;
+  setPacketTimeout((double)(deadline_ns - getMonotonicNs()) / 1000000.0);
+}
+
+int64_t PortHandler::getPacketDeadline()
+{
+  return packet_deadline_ns_;
+}
+
+int64_t PortHandler::getRemainingNs()
+{
+  return packet_deadline_ns_ - getMonotonicNs();
+}
+
+bool PortHandler::tryLockPort()
+{
+  return lockPortUntil(0);
+}
+
+bool PortHandler::lockPort()
+{
+  return lockPortUntil(-1);
+}
+
+bool PortHandler::lockPort(double msec)
+{
+  if (msec < 0.0)
+    return lockPortUntil(-1);
+  if (msec == 0.0)
+    return lockPortUntil(0);
+  return lockPortUntil(getSystemNs() + (int64_t)(msec * 1000000.0));
+}
+
+bool PortHandler::lockPortUntil(int64_t deadline_ns)
+{
+  uintptr_t self = getThreadId();
+
+  // only the owner itself can find its id in lock_owner_, which the other threads read while it is stored;
+  // lock_depth_ is read and written by the owner alone
+  if (loadOwner(&lock_owner_) == self && lock_depth_ > 0)
+  {
+    lock_depth_++;
+    return true;
+  }
+
+  int64_t wait_ns   = 0;
+  bool    contended = false;
+  int     state     = compareExchange(&lock_state_, 0, 1);
+  if (state != 0)
+  {
+    if (deadline_ns == 0)
+    {
+      increment(&lock_stats_.busy_rejections);
+      return false;
+    }
+
+    // 2 tells the owner that a thread waits to be woken up
+    int64_t start = getSystemNs();
+    if (state != 2)
+      state = exchange(&lock_state_, 2);
+    while (state != 0)
+    {
+      int64_t timeout_ns = -1;
+      if (deadline_ns > 0)
+      {
+        timeout_ns = deadline_ns - getSystemNs();
+        if (timeout_ns <= 0)
+        {
+          increment(&lock_stats_.busy_rejections);
+          return false;
+        }
+      }
+      waitLock(&lock_state_, timeout_ns);
+      state = exchange(&lock_state_, 2);
+    }
+    wait_ns   = getSystemNs() - start;
+    contended = true;
+  }
+
+  storeOwner(&lock_owner_, self);
+  lock_depth_ = 1;
+  storeFlag(&is_using_, true);
+
+  // the statistics are read and reset by any thread, as those of PortIoStats
+  increment(&lock_stats_.acquisitions);
+  if (contended)
+  {
+    increment(&lock_stats_.contentions);
+    add(&lock_stats_.total_wait_ns, wait_ns);
+    storeMax(&lock_stats_.max_wait_ns, wait_ns);
+  }
+  return true;
+}
+
+void PortHandler::unlockPort()
+{
+  if (loadOwner(&lock_owner_) != getThreadId() || lock_depth_ == 0)
+    return;
+  if (--lock_depth_ > 0)
+    return;
+
+  releasePort();
+  packet_hold_  = false;
+  storeFlag(&is_using_, false);
+  storeOwner(&lock_owner_, 0);
+  if (exchange(&lock_state_, 0) == 2)
+    wakeLock(&lock_state_);
+}
+
+bool PortHandler::isPortLocked()
+{
+  return (compareExchange(&lock_state_, 0, 0) != 0);
+}
+
+bool PortHandler::beginTransaction()
+{
+  // an instruction packet whose status packet is not received yet keeps the port busy, as in the other threads
+  if (loadOwner(&lock_owner_) == getThreadId() && packet_hold_)
+    return false;
+
+  checkPort();
+  if (lockPort(lock_timeout_) == false)
+    return false;
+
+  packet_hold_ = true;
+  return true;
+}
+
+void PortHandler::endTransaction()
+{
+  if (loadOwner(&lock_owner_) != getThreadId() || packet_hold_ == false)
+    return;
+
+  packet_hold_ = false;
+  unlockPort();
+}
+
+PortLockStats PortHandler::getLockStats()
+{
+  PortLockStats stats;
+  stats.acquisitions    = load(&lock_stats_.acquisitions);
+  stats.contentions     = load(&lock_stats_.contentions);
+  stats.busy_rejections = load(&lock_stats_.busy_rejections);
+  stats.total_wait_ns   = load(&lock_stats_.total_wait_ns);
+  stats.max_wait_ns     = load(&lock_stats_.max_wait_ns);
+  return stats;
+}
+
+void PortHandler::resetLockStats()
+{
+  store(&lock_stats_.acquisitions, 0);
+  store(&lock_stats_.contentions, 0);
+  store(&lock_stats_.busy_rejections, 0);
+  store(&lock_stats_.total_wait_ns, 0);
+  store(&lock_stats_.max_wait_ns, 0);
+}
+
+void PortHandler::setAdaptiveTimeout(bool enable, double margin_msec, double floor_msec)
+{
+  latency_margin_ns_  = (int64_t)(margin_msec * 1000000.0);
+  latency_floor_ns_   = (int64_t)(floor_msec * 1000000.0);
+  status_pending_     = false;
+
+  // the estimates of all IDs are allocated only for the ports which use them
+  if (enable && latency_ == 0)
+    latency_ = (LatencyEstimate *)calloc(LATENCY_PORT_ + 1, sizeof(LatencyEstimate));
+  else if (enable == false && latency_ != 0)
+  {
+    free(latency_);
+    latency_ = 0;
+  }
+}
+
+LatencyEstimate PortHandler::getLatencyEstimate(int index)
+{
+  LatencyEstimate estimate;
+  if (latency_ == 0 || index < 0 || index > LATENCY_PORT_)
+  {
+    memset(&estimate, 0, sizeof(estimate));
+    return estimate;
+  }
+  return latency_[index];
+}
+
+void PortHandler::resetLatencyEstimates()
+{
+  if (latency_ != 0)
+    memset(latency_, 0, (LATENCY_PORT_ + 1) * sizeof(LatencyEstimate));
+}
+
+int64_t PortHandler::getAdaptiveTimeout(uint8_t id)
+{
+  if (latency_ == 0 || latency_[id].backoff >= LATENCY_MAX_BACKOFF)
+    return 0;
+
+  LatencyEstimate *estimate = &latency_[id];
+  if (estimate->samples < LATENCY_MIN_SAMPLES)
+    estimate = &latency_[LATENCY_PORT_];
+  if (estimate->samples < LATENCY_MIN_SAMPLES)
+    return 0;
+
+  int64_t timeout = estimate->mean_ns + 4 * estimate->deviation_ns;
+  if (timeout < estimate->peak_ns)
+    timeout = estimate->peak_ns;
+  timeout = (timeout + latency_margin_ns_) << latency_[id].backoff;
+  return (timeout < latency_floor_ns_) ? latency_floor_ns_ : timeout;
+}
+
+void PortHandler::setStatusTimeout(uint8_t id, uint16_t instruction_length, uint16_t status_length)
+{
+  int     baudrate  = getBaudRate();
+  int64_t byte_ns   = (baudrate > 0) ? 10000000000LL / baudrate : 0;   // 10 bits a byte on the wire
+  int64_t tx_end    = getTransmitEndNs();
+
+  status_pending_   = true;
+  status_id_        = id;
+  if (tx_end > 0)
+  {
+    // the latency is counted from the end of the instruction packet on the wire
+    status_start_ns_  = tx_end;
+    status_wire_ns_   = (int64_t)status_length * byte_ns;
+  }
+  else
+  {
+    status_start_ns_  = getMonotonicNs();
+    status_wire_ns_   = (int64_t)(instruction_length + status_length) * byte_ns;
+  }
+
+  int64_t timeout = getAdaptiveTimeout(id);
+  if (timeout == 0)
+    setPacketTimeout(status_length);
+  else
+    setPacketDeadline(status_start_ns_ + status_wire_ns_ + timeout);
+}
+
+static void addLatency(LatencyEstimate *estimate, int64_t latency)
+{
+  if (estimate->samples == 0)
+  {
+    estimate->mean_ns       = latency;
+    estimate->deviation_ns  = latency / 2;
+    estimate->peak_ns       = latency;
+  }
+  else
+  {
+    int64_t error = latency - estimate->mean_ns;
+    estimate->mean_ns       += error / 8;
+    estimate->deviation_ns  += (((error < 0) ? -error : error) - estimate->deviation_ns) / 4;
+    estimate->peak_ns       = (latency > estimate->peak_ns) ? latency : estimate->peak_ns - (estimate->peak_ns - estimate->mean_ns) / 16;
+  }
+  estimate->samples++;
+}
+
+void PortHandler::updateStatusLatency(uint8_t id, bool received)
+{
+  if (status_pending_ == false || status_id_ != id)
+    return;
+  status_pending_ = false;
+  if (latency_ == 0)
+    return;
+
+  if (received == false)
+  {
+    latency_[id].timeouts++;
+    if (latency_[id].backoff < LATENCY_MAX_BACKOFF)
+      latency_[id].backoff++;
+    return;
+  }
+
+  int64_t latency = getMonotonicNs() - status_start_ns_ - status_wire_ns_;
+  if (latency < 0)
+    latency = 0;
+  addLatency(&latency_[id], latency);
+  addLatency(&latency_[LATENCY_PORT_], latency);
+  latency_[id].backoff = 0;
+}
+
+void PortHandler::setStalePolicy(int policy)
+{
+  stale_policy_   = policy;
+  stale_corrupt_  = false;
+}
+
+bool PortHandler::flushStale()
+{
+  if (stale_policy_ == STALE_FLUSH_ || (stale_policy_ == STALE_ADAPTIVE_ && stale_corrupt_))
+  {
+    clearPort();
+    stale_corrupt_ = false;
+    stale_stats_.flushes++;
+    return true;
+  }
+
+  stale_stats_.drains++;
+  return false;
+}
+
+void PortHandler::addStalePacket(uint8_t id)
+{
+  stale_stats_.stale_packets++;
+  stale_stats_.last_stale_id = id;
+  if (id == status_id_)
+    stale_stats_.late_packets++;
+}
+
+void PortHandler::addStaleBytes(int length)
+{
+  if (length <= 0)
+    return;
+  stale_stats_.stale_bytes += length;
+  stale_corrupt_ = true;
+}
+
+void PortHandler::resetStaleStats()
+{
+  stale_stats_.flushes        = 0;
+  stale_stats_.drains         = 0;
+  stale_stats_.stale_packets  = 0;
+  stale_stats_.late_packets   = 0;
+  stale_stats_.stale_bytes    = 0;
+  stale_stats_.last_stale_id  = 0;
+}
+
+void PortHandler::setWaitStrategy(int strategy, double spin_usec)
+{
+  wait_strategy_  = (strategy >= WAIT_BLOCK_ && strategy <= WAIT_HYBRID_) ? strategy : WAIT_BLOCK_;
+  wait_spin_ns_   = (int64_t)(spin_usec * 1000.0);
+}
+
+bool PortHandler::spinPort(int64_t until_ns)
+{
+  int64_t start = getMonotonicNs();
+  int64_t now   = start;
+  bool    found = true;
+
+  while (getBytesAvailable() <= peek_length_)
+  {
+    now = getMonotonicNs();
+    if (now >= until_ns)
+    {
+      found = false;
+      break;
+    }
+  }
+  if (found)
+    now = getMonotonicNs();
+
+  countIo(&io_stats_.spin_ns, (uint64_t)(now - start));
+  return found;
+}
+
+void PortHandler::addWaitSample(int64_t start_ns, bool received, bool spun)
+{
+  PortWaitStats *stats  = &wait_stats_[wait_strategy_];
+  int64_t        now    = getMonotonicNs();
+
+  stats->waits++;
+  if (received == false)
+  {
+    stats->timeouts++;
+    countIo(&io_stats_.timeouts);
+    if (now - packet_deadline_ns_ > stats->max_overshoot_ns)
+      stats->max_overshoot_ns = now - packet_deadline_ns_;
+    return;
+  }
+
+  int64_t wait_ns = now - start_ns;
+  stats->wakeups++;
+  if (spun)
+    stats->spin_wakeups++;
+  if (wait_ns > stats->max_wait_ns)
+    stats->max_wait_ns = wait_ns;
+
+  // [0] under 1 usec, [i] from 2^(i-1) up to 2^i usec
+  int index = 0;
+  for (int64_t usec = wait_ns / 1000; usec > 0 && index < WAIT_HISTOGRAM_SIZE - 1; usec >>= 1)
+    index++;
+  stats->histogram[index]++;
+}
+
+PortWaitStats PortHandler::getWaitStats(int strategy)
+{
+  PortWaitStats stats;
+  if (strategy < WAIT_BLOCK_ || strategy > WAIT_HYBRID_)
+  {
+    memset(&stats, 0, sizeof(stats));
+    return stats;
+  }
+  return wait_stats_[strategy];
+}
+
+void PortHandler::resetWaitStats()
+{
+  memset(wait_stats_, 0, sizeof(wait_stats_));
+}
+
+void PortHandler::countIo(uint64_t *counter, uint64_t amount)
+{
+  add(counter, amount);
+}
+
+PortIoStats PortHandler::getIoStats()
+{
+  PortIoStats stats;
+  stats.bytes_in    = load(&io_stats_.bytes_in);
+  stats.bytes_out   = load(&io_stats_.bytes_out);
+  stats.reads       = load(&io_stats_.reads);
+  stats.writes      = load(&io_stats_.writes);
+  stats.zero_reads  = load(&io_stats_.zero_reads);
+  stats.ioctls      = load(&io_stats_.ioctls);
+  stats.flushes     = load(&io_stats_.flushes);
+  stats.timeouts    = load(&io_stats_.timeouts);
+  stats.blocked_ns  = load(&io_stats_.blocked_ns);
+  stats.spin_ns     = load(&io_stats_.spin_ns);
+  return stats;
+}
+
+void PortHandler::resetIoStats()
+{
+  store(&io_stats_.bytes_in, 0);
+  store(&io_stats_.bytes_out, 0);
+  store(&io_stats_.reads, 0);
+  store(&io_stats_.writes, 0);
+  store(&io_stats_.zero_reads, 0);
+  store(&io_stats_.ioctls, 0);
+  store(&io_stats_.flushes, 0);
+  store(&io_stats_.timeouts, 0);
+  store(&io_stats_.blocked_ns, 0);
+  store(&io_stats_.spin_ns, 0);
+}
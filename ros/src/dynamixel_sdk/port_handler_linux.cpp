@@ -19,27 +19,39 @@
 #if defined(__linux__)
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sched.h>
 #include <termios.h>
 #include <time.h>
-#include <sys/time.h>
+#include <sys/inotify.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <linux/serial.h>
 
 #include "port_handler_linux.h"
 
 #define LATENCY_TIMER  16  // msec (USB latency timer)
-                           // You should adjust the latency timer value. From the version Ubuntu 16.04.2, the default latency timer of the usb serial is '16 msec'.
+                           // The default latency timer, which is used when the latency timer of the port could not be read.
+                           // From the version Ubuntu 16.04.2, the default latency timer of the usb serial is '16 msec'.
                            // When you are going to use sync / bulk read, the latency timer should be loosen.
                            // the lower latency timer value, the faster communication speed.
 
                            // Note:
+                           // PortHandlerLinux::openPort() sets ASYNC_LOW_LATENCY on the port,
+                           // reads the latency timer from /sys/bus/usb-serial/devices/ttyUSBx/latency_timer,
+                           // sets it to the latency timer requested (LOW_LATENCY_TIMER by default) when it is writable,
+                           // and uses the result for the packet timeout.
+                           //
                            // You can check its value by:
                            // $ cat /sys/bus/usb-serial/devices/ttyUSB0/latency_timer
                            //
-                           // If you think that the communication is too slow, type following after plugging the usb in to change the latency timer
+                           // If the latency timer is not writable by the user, type following after plugging the usb in to change the latency timer
                            //
                            // Method 1. Type following (you should do this everytime when the usb once was plugged out or the connection was dropped)
                            // $ echo 1 | sudo tee /sys/bus/usb-serial/devices/ttyUSB0/latency_timer
@@ -55,21 +67,72 @@
                            // or if you have another good idea that can be an alternatives,
                            // please give us advice via github issue https://github.com/ROBOTIS-GIT/DynamixelSDK/issues
 
+#define LOW_LATENCY_TIMER   1   // msec (default latency timer requested by PortHandlerLinux::openPort())
+
+#define MAX_WRITE_SEGMENTS  8   // segments written by a single writev() in PortHandlerLinux::writePortV()
+
+#define RECONNECT_INTERVAL  500000000LL // nsec (the lost port is tried at least this often, even without an inotify event)
+
+#if defined(TCGETS2)
+// struct termios2 of <asm/termbits.h>, which cannot be included together with <termios.h>
+struct termios2
+{
+  tcflag_t c_iflag;
+  tcflag_t c_oflag;
+  tcflag_t c_cflag;
+  tcflag_t c_lflag;
+  cc_t     c_line;
+  cc_t     c_cc[19];
+  speed_t  c_ispeed;
+  speed_t  c_ospeed;
+};
+
+#ifndef BOTHER
+#define BOTHER  0010000
+#endif
+#ifndef IBSHIFT
+#define IBSHIFT 16
+#endif
+#endif
+
 using namespace dynamixel;
 
+static bool isDeviceGone(int error)
+{
+  // the errors of a tty whose device was unplugged, or a pty whose master was closed
+  return (error == EIO || error == ENODEV || error == ENXIO);
+}
+
 PortHandlerLinux::PortHandlerLinux(const char *port_name)
   : socket_fd_(-1),
     baudrate_(DEFAULT_BAUDRATE_),
-    packet_start_time_(0.0),
-    packet_timeout_(0.0),
-    tx_time_per_byte(0.0)
+    latency_timer_(LATENCY_TIMER),
+    latency_request_(LOW_LATENCY_TIMER),
+    rx_head_(0),
+    rx_tail_(0),
+    rs485_enabled_(false),
+    rs485_delay_before_send_(0),
+    rs485_delay_after_send_(0),
+    echo_suppression_(false),
+    echo_pending_(0),
+    tx_time_per_byte(0.0),
+    tx_end_ns_(0),
+    port_lost_(false),
+    reconnecting_(false),
+    inotify_fd_(-1),
+    reconnect_retry_ns_(0),
+    reconnect_count_(0),
+    reconnect_callback_(0),
+    reconnect_arg_(0)
 {
   is_using_ = false;
   setPortName(port_name);
+  setSysfsRoot("/sys");
 }
 
 bool PortHandlerLinux::openPort()
 {
+  closePort();
   return setBaudRate(baudrate_);
 }
 
@@ -78,11 +141,24 @@ void PortHandlerLinux::closePort()
   if(socket_fd_ != -1)
     close(socket_fd_);
   socket_fd_ = -1;
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+  echo_pending_ = 0;
+  tx_end_ns_ = 0;
+
+  // the port reopened by PortHandlerLinux::reconnect() is still lost until it is opened
+  if(reconnecting_ == false)
+  {
+    unwatchPort();
+    port_lost_ = false;
+  }
 }
 
 void PortHandlerLinux::clearPort()
 {
   tcflush(socket_fd_, TCIFLUSH);
+  countIo(&io_stats_.flushes);
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+  echo_pending_ = 0;
 }
 
 void PortHandlerLinux::setPortName(const char *port_name)
@@ -100,12 +176,19 @@ bool PortHandlerLinux::setBaudRate(const int baudrate)
 {
   int baud = getCFlagBaud(baudrate);
 
+  // change the baudrate of the opened port without reopening it
+  if(socket_fd_ != -1 && setBaudrateInPlace(baudrate) == true)
+    return true;
+
   closePort();
 
   if(baud <= 0)   // custom baudrate
   {
-    setupPort(B38400);
     baudrate_ = baudrate;
+    if(setupPort(B38400) == false)
+      return false;
+    if(setBaudrateInPlace(baudrate) == true)
+      return true;
     return setCustomBaudrate(baudrate);
   }
   else
@@ -120,61 +203,469 @@ int PortHandlerLinux::getBaudRate()
   return baudrate_;
 }
 
+void PortHandlerLinux::setSysfsRoot(const char *sysfs_root)
+{
+  strcpy(sysfs_root_, sysfs_root);
+}
+
+int PortHandlerLinux::getLatencyTimer()
+{
+  return latency_timer_;
+}
+
+bool PortHandlerLinux::setRS485(bool enable, int delay_rts_before_send, int delay_rts_after_send)
+{
+  bool was_enabled = rs485_enabled_;
+
+  rs485_enabled_            = enable;
+  rs485_delay_before_send_  = delay_rts_before_send;
+  rs485_delay_after_send_   = delay_rts_after_send;
+
+  if(socket_fd_ == -1 || (enable == false && was_enabled == false))
+    return true;
+  return setupRS485();
+}
+
+bool PortHandlerLinux::setOption(const char *key, const char *value)
+{
+  if(strcmp(key, "baud") == 0)
+  {
+    if(atoi(value) <= 0)
+      return false;
+    if(socket_fd_ != -1)
+      return setBaudRate(atoi(value));
+    baudrate_ = atoi(value);
+    return true;
+  }
+  if(strcmp(key, "latency") == 0)
+  {
+    setLatencyRequest(atoi(value));
+    return true;
+  }
+  if(strcmp(key, "rs485") == 0)
+    return setRS485(isOptionTrue(value), rs485_delay_before_send_, rs485_delay_after_send_);
+  if(strcmp(key, "rts_before") == 0)
+    return setRS485(rs485_enabled_, atoi(value), rs485_delay_after_send_);
+  if(strcmp(key, "rts_after") == 0)
+    return setRS485(rs485_enabled_, rs485_delay_before_send_, atoi(value));
+  if(strcmp(key, "echo") == 0)
+  {
+    setEchoSuppression(isOptionTrue(value));
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
+void PortHandlerLinux::setEchoSuppression(bool enable)
+{
+  echo_suppression_ = enable;
+  echo_pending_     = 0;
+}
+
 int PortHandlerLinux::getBytesAvailable()
 {
   int bytes_available;
-  ioctl(socket_fd_, FIONREAD, &bytes_available);
-  return bytes_available;
+  int buffered = rx_tail_ - rx_head_;
+
+  // the kernel is asked only when the buffered bytes are none, or all peeked already
+  if(buffered > peek_length_)
+    return buffered;
+  if(port_lost_)
+    return buffered;
+
+  countIo(&io_stats_.ioctls);
+  if(ioctl(socket_fd_, FIONREAD, &bytes_available) != 0)
+  {
+    if(isDeviceGone(errno))
+      markPortLost();
+    return buffered;
+  }
+  if(bytes_available < echo_pending_)
+    return buffered;
+  return buffered + bytes_available - echo_pending_;
 }
 
 int PortHandlerLinux::readPort(uint8_t *packet, int length)
 {
-  return read(socket_fd_, packet, length);
+  if(rx_tail_ == rx_head_ && fillBuffer() <= 0)
+    return 0;
+
+  if(length > rx_tail_ - rx_head_)
+    length = rx_tail_ - rx_head_;
+
+  memcpy(packet, &rx_buffer_[rx_head_], length);
+  consumePort(length);
+  return length;
+}
+
+int PortHandlerLinux::writePortV(PortSegment *segments, int count)
+{
+  struct iovec iov[MAX_WRITE_SEGMENTS];
+
+  if(port_lost_)
+    return -1;
+  if(count > MAX_WRITE_SEGMENTS)
+    return PortHandler::writePortV(segments, count);
+
+  for(int i = 0; i < count; i++)
+  {
+    iov[i].iov_base = segments[i].data;
+    iov[i].iov_len  = segments[i].length;
+  }
+
+  int length = writev(socket_fd_, iov, count);
+  countIo(&io_stats_.writes);
+  if(length < 0 && isDeviceGone(errno))
+    markPortLost();
+  if(length > 0)
+  {
+    countIo(&io_stats_.bytes_out, length);
+    addTransmit(length);
+  }
+  if(echo_suppression_ && length > 0)
+    echo_pending_ += length;
+  return length;
+}
+
+int PortHandlerLinux::peekPort(uint8_t **data)
+{
+  // the caller has seen every byte buffered: the bytes received since are added behind them
+  if(rx_tail_ - rx_head_ <= peek_length_)
+    fillBuffer();
+
+  *data = &rx_buffer_[rx_head_];
+  peek_length_ = rx_tail_ - rx_head_;
+  return peek_length_;
+}
+
+void PortHandlerLinux::consumePort(int length)
+{
+  rx_head_ += (length < rx_tail_ - rx_head_) ? length : rx_tail_ - rx_head_;
+  peek_length_ = 0;
+  if(rx_head_ >= rx_tail_)
+    rx_head_ = rx_tail_ = 0;
+}
+
+int PortHandlerLinux::fillBuffer()
+{
+  // the bytes left are moved to the front, so a packet cut off grows in place
+  if(rx_head_ > 0)
+  {
+    memmove(rx_buffer_, &rx_buffer_[rx_head_], rx_tail_ - rx_head_);
+    rx_tail_ -= rx_head_;
+    rx_head_ = 0;
+  }
+  if(rx_tail_ == RX_BUFFER_SIZE_ || port_lost_)
+    return 0;
+
+  // drain everything the kernel has received by a single read()
+  int length = read(socket_fd_, &rx_buffer_[rx_tail_], RX_BUFFER_SIZE_ - rx_tail_);
+  countIo(&io_stats_.reads);
+  if(length < 0 && isDeviceGone(errno))
+    markPortLost();
+  if(length <= 0)
+  {
+    countIo(&io_stats_.zero_reads);
+    return length;
+  }
+  countIo(&io_stats_.bytes_in, length);
+
+  // the bytes written come back before the response on a half-duplex bus which echoes
+  if(echo_pending_ > 0)
+  {
+    int echo_length = (length < echo_pending_) ? length : echo_pending_;
+    memmove(&rx_buffer_[rx_tail_], &rx_buffer_[rx_tail_ + echo_length], length - echo_length);
+    echo_pending_ -= echo_length;
+    length        -= echo_length;
+  }
+
+  rx_tail_ += length;
+  return length;
 }
 
 int PortHandlerLinux::writePort(uint8_t *packet, int length)
 {
-  return write(socket_fd_, packet, length);
+  if(port_lost_)
+    return -1;
+
+  int written = write(socket_fd_, packet, length);
+  countIo(&io_stats_.writes);
+  if(written < 0 && isDeviceGone(errno))
+    markPortLost();
+  if(written > 0)
+  {
+    countIo(&io_stats_.bytes_out, written);
+    addTransmit(written);
+  }
+  if(echo_suppression_ && written > 0)
+    echo_pending_ += written;
+  return written;
+}
+
+bool PortHandlerLinux::waitPort()
+{
+  struct pollfd   pfd;
+  struct timespec ts;
+
+  if(rx_tail_ - rx_head_ > peek_length_)
+    return true;
+
+  int64_t start     = getMonotonicNs();
+  int64_t remaining = packet_deadline_ns_ - start;
+  if(remaining <= 0)
+    return false;
+
+  // spin before sleeping by the wait strategy
+  if(getWaitStrategy() != WAIT_BLOCK_ && port_lost_ == false)
+  {
+    int64_t spin_end = (getWaitStrategy() == WAIT_SPIN_) ? packet_deadline_ns_ : start + (int64_t)(getWaitSpinTime() * 1000.0);
+    bool    spun     = spinBuffer((spin_end < packet_deadline_ns_) ? spin_end : packet_deadline_ns_);
+    if(spun || getWaitStrategy() == WAIT_SPIN_)
+    {
+      addWaitSample(start, spun, true);
+      return spun;
+    }
+
+    remaining = getRemainingNs();
+    if(remaining <= 0)
+    {
+      addWaitSample(start, false, false);
+      return false;
+    }
+  }
+
+  pfd.fd      = socket_fd_;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+
+  ts.tv_sec   = (time_t)(remaining / 1000000000LL);
+  ts.tv_nsec  = (long)(remaining % 1000000000LL);
+
+  int64_t blocked = getMonotonicNs();
+  int     result  = ppoll(&pfd, 1, &ts, NULL);
+  countIo(&io_stats_.blocked_ns, (uint64_t)(getMonotonicNs() - blocked));
+  if(result <= 0)
+  {
+    addWaitSample(start, false, false);
+    return false;
+  }
+
+  // the device hung up, and nothing is left to read from it
+  if((pfd.revents & POLLIN) == 0 && (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) != 0)
+  {
+    markPortLost();
+    return false;
+  }
+  addWaitSample(start, true, false);
+  return true;
+}
+
+bool PortHandlerLinux::spinBuffer(int64_t until_ns)
+{
+  int64_t start = getMonotonicNs();
+  int64_t now   = start;
+  bool    found = true;
+
+  // a non-blocking read() a pass takes the bytes arrived into the receive buffer,
+  // where FIONREAD would only count them for another read(),
+  // and the processor is yielded to the threads which wait for it, as the one serving the device may
+  while(rx_tail_ - rx_head_ <= peek_length_)
+  {
+    if(fillBuffer() <= 0 && port_lost_)
+    {
+      found = false;
+      break;
+    }
+    if(rx_tail_ - rx_head_ <= peek_length_)
+      sched_yield();
+    now = getMonotonicNs();
+    if(rx_tail_ - rx_head_ <= peek_length_ && now >= until_ns)
+    {
+      found = false;
+      break;
+    }
+  }
+  if(found)
+    now = getMonotonicNs();
+
+  countIo(&io_stats_.spin_ns, (uint64_t)(now - start));
+  return found;
 }
 
 void PortHandlerLinux::setPacketTimeout(uint16_t packet_length)
 {
-  packet_start_time_  = getCurrentTime();
-  packet_timeout_     = (tx_time_per_byte * (double)packet_length) + (LATENCY_TIMER * 2.0) + 2.0;
+  double msec = (tx_time_per_byte * (double)packet_length) + (latency_timer_ * 2.0) + 2.0;
+  setPacketDeadline(getTransmitEndNs() + (int64_t)(msec * 1000000.0));
 }
 
 void PortHandlerLinux::setPacketTimeout(double msec)
 {
-  packet_start_time_  = getCurrentTime();
-  packet_timeout_     = msec;
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
 }
 
 bool PortHandlerLinux::isPacketTimeout()
 {
-  if(getTimeSinceStart() > packet_timeout_)
-  {
-    packet_timeout_ = 0;
-    return true;
-  }
-  return false;
+  return (getRemainingNs() < 0);
+}
+
+void PortHandlerLinux::setPacketDeadline(int64_t deadline_ns)
+{
+  // no packet comes from the lost port, so the packet timeout is passed already
+  packet_deadline_ns_ = port_lost_ ? 0 : deadline_ns;
+}
+
+void PortHandlerLinux::addTransmit(int length)
+{
+  int64_t now     = getMonotonicNs();
+  int64_t byte_ns = (int64_t)(tx_time_per_byte * 1000000.0);
+  int     queued  = 0;
+
+  // write() only queues the bytes, which go out after the bytes written before
+  tx_end_ns_ = ((tx_end_ns_ > now) ? tx_end_ns_ : now) + (int64_t)length * byte_ns;
+
+  // the driver knows better when it holds more, as when the line is held by flow control
+  countIo(&io_stats_.ioctls);
+  if(ioctl(socket_fd_, TIOCOUTQ, &queued) == 0 && now + (int64_t)queued * byte_ns > tx_end_ns_)
+    tx_end_ns_ = now + (int64_t)queued * byte_ns;
+}
+
+int64_t PortHandlerLinux::getTransmitEndNs()
+{
+  int64_t now = getMonotonicNs();
+  return (tx_end_ns_ > now) ? tx_end_ns_ : now;
+}
+
+bool PortHandlerLinux::applyRealtimeProfile(RealtimeProfile *profile)
+{
+  bool result = profile->apply();
+  RealtimeProfile::prefault(rx_buffer_, sizeof(rx_buffer_));
+  return result;
+}
+
+void PortHandlerLinux::checkPort()
+{
+  if(port_lost_ == false || tryLockPort() == false)
+    return;
+
+  bool reconnected = (isPortBack() && reconnect());
+  unlockPort();
+
+  // the callback can run transactions, since the port is released
+  if(reconnected && reconnect_callback_ != 0)
+    reconnect_callback_(this, reconnect_arg_);
+}
+
+void PortHandlerLinux::setReconnectCallback(ReconnectCallback callback, void *arg)
+{
+  reconnect_callback_ = callback;
+  reconnect_arg_      = arg;
+}
+
+void PortHandlerLinux::markPortLost()
+{
+  if(port_lost_)
+    return;
+
+  if(socket_fd_ != -1)
+    close(socket_fd_);
+  socket_fd_ = -1;
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+  echo_pending_ = 0;
+
+  port_lost_ = true;
+  packet_deadline_ns_ = 0;
+  reconnect_retry_ns_ = getMonotonicNs() + RECONNECT_INTERVAL;
+  watchPort();
 }
 
-double PortHandlerLinux::getCurrentTime()
+void PortHandlerLinux::watchPort()
 {
-	struct timespec tv;
-	clock_gettime(CLOCK_REALTIME, &tv);
-	return ((double)tv.tv_sec * 1000.0 + (double)tv.tv_nsec * 0.001 * 0.001);
+  char  dir_name[sizeof(port_name_)];
+  char *slash;
+
+  unwatchPort();
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(inotify_fd_ == -1)
+    return;
+
+  // watch the directory, since the device node or the link to it is created again there
+  strcpy(dir_name, port_name_);
+  slash = strrchr(dir_name, '/');
+  if(slash == NULL)
+    strcpy(dir_name, ".");
+  else if(slash == dir_name)
+    dir_name[1] = 0;
+  else
+    *slash = 0;
+
+  // the directory may not exist until the device comes back, then the port is tried by RECONNECT_INTERVAL
+  if(inotify_add_watch(inotify_fd_, dir_name, IN_CREATE | IN_MOVED_TO | IN_ATTRIB) == -1)
+    unwatchPort();
 }
 
-double PortHandlerLinux::getTimeSinceStart()
+void PortHandlerLinux::unwatchPort()
 {
-  double time;
+  if(inotify_fd_ != -1)
+    close(inotify_fd_);
+  inotify_fd_ = -1;
+}
 
-  time = getCurrentTime() - packet_start_time_;
-  if(time < 0.0)
-    packet_start_time_ = getCurrentTime();
+bool PortHandlerLinux::isPortBack()
+{
+  bool    changed   = false;
+  bool    rewatch   = false;
+  int64_t now       = getMonotonicNs();
+
+  if(inotify_fd_ != -1)
+  {
+    const char *base_name = strrchr(port_name_, '/');
+    base_name = (base_name == NULL) ? port_name_ : base_name + 1;
+
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int  length;
+    while((length = read(inotify_fd_, events, sizeof(events))) > 0)
+    {
+      for(char *p = events; p < events + length; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len)
+      {
+        struct inotify_event *event = (struct inotify_event *)p;
+        if(event->mask & (IN_IGNORED | IN_Q_OVERFLOW))
+          rewatch = true;
+        else if(event->len > 0 && strcmp(event->name, base_name) == 0)
+          changed = true;
+      }
+    }
+  }
 
-  return time;
+  // the directory was removed or the events were lost
+  if(rewatch)
+  {
+    watchPort();
+    changed = true;
+  }
+
+  if(changed == false && now < reconnect_retry_ns_)
+    return false;
+  reconnect_retry_ns_ = now + RECONNECT_INTERVAL;
+
+  return (access(port_name_, R_OK | W_OK) == 0);
+}
+
+bool PortHandlerLinux::reconnect()
+{
+  // setBaudRate() opens the port with the baudrate, and the RS-485 and low latency settings of the lost port
+  reconnecting_ = true;
+  bool result = setBaudRate(baudrate_);
+  if(result == false)
+    closePort();
+  reconnecting_ = false;
+
+  if(result == false)
+    return false;
+
+  port_lost_ = false;
+  unwatchPort();
+  reconnect_count_++;
+  return true;
 }
 
 bool PortHandlerLinux::setupPort(int cflag_baud)
@@ -184,7 +675,9 @@ bool PortHandlerLinux::setupPort(int cflag_baud)
   socket_fd_ = open(port_name_, O_RDWR|O_NOCTTY|O_NONBLOCK);
   if(socket_fd_ < 0)
   {
-    printf("[PortHandlerLinux::SetupPort] Error opening serial port!\n");
+    // the device is tried again and again while the port is lost
+    if(reconnecting_ == false)
+      printf("[PortHandlerLinux::SetupPort] Error opening serial port!\n");
     return false;
   }
 
@@ -199,16 +692,151 @@ bool PortHandlerLinux::setupPort(int cflag_baud)
 
   // clean the buffer and activate the settings for the port
   tcflush(socket_fd_, TCIFLUSH);
+  countIo(&io_stats_.flushes);
   tcsetattr(socket_fd_, TCSANOW, &newtio);
 
+  setupLowLatency();
+  if(rs485_enabled_)
+    setupRS485();
+
   tx_time_per_byte = (1000.0 / (double)baudrate_) * 10.0;
   return true;
 }
 
+void PortHandlerLinux::setupLowLatency()
+{
+  char  path[PATH_MAX + 100];
+  FILE *fp;
+  int   latency_timer = -1;
+
+  // ask the driver for low latency (ftdi_sio also sets its latency timer to 1 msec by this)
+  struct serial_struct ss;
+  countIo(&io_stats_.ioctls);
+  if(ioctl(socket_fd_, TIOCGSERIAL, &ss) == 0 && (ss.flags & ASYNC_LOW_LATENCY) == 0)
+  {
+    ss.flags |= ASYNC_LOW_LATENCY;
+    countIo(&io_stats_.ioctls);
+    ioctl(socket_fd_, TIOCSSERIAL, &ss);
+  }
+
+  latency_timer_ = LATENCY_TIMER;
+  if(getLatencyTimerPath(path, sizeof(path)) == false)
+    return;
+
+  if((fp = fopen(path, "r")) == NULL)
+    return;
+  if(fscanf(fp, "%d", &latency_timer) != 1)
+    latency_timer = -1;
+  fclose(fp);
+
+  if(latency_timer < 0)
+    return;
+
+  // lower the latency timer to the one requested when it is permitted, and keep a lower one set by udev or the user
+  if(latency_request_ > 0 && latency_request_ < latency_timer && (fp = fopen(path, "w")) != NULL)
+  {
+    fprintf(fp, "%d", latency_request_);
+    if(fclose(fp) == 0)
+      latency_timer = latency_request_;
+  }
+
+  latency_timer_ = latency_timer;
+}
+
+bool PortHandlerLinux::setupRS485()
+{
+#if defined(TIOCSRS485)
+  struct serial_rs485 rs485;
+  memset(&rs485, 0, sizeof(rs485));
+
+  // drive RTS high while sending, and low to receive after the delay
+  if(rs485_enabled_)
+    rs485.flags = SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND;
+  rs485.delay_rts_before_send = rs485_delay_before_send_;
+  rs485.delay_rts_after_send  = rs485_delay_after_send_;
+
+  countIo(&io_stats_.ioctls);
+  if(ioctl(socket_fd_, TIOCSRS485, &rs485) < 0)
+  {
+    printf("[PortHandlerLinux::SetupRS485] TIOCSRS485 failed!\n");
+    return false;
+  }
+  return true;
+#else
+  printf("[PortHandlerLinux::SetupRS485] TIOCSRS485 is not supported!\n");
+  return false;
+#endif
+}
+
+bool PortHandlerLinux::getLatencyTimerPath(char *path, int length)
+{
+  char  real_name[PATH_MAX];
+  const char *tty_name;
+
+  // resolve symbolic links such as /dev/serial/by-id/... into /dev/ttyUSBx
+  if(realpath(port_name_, real_name) == NULL)
+    return false;
+
+  tty_name = strrchr(real_name, '/');
+  tty_name = (tty_name == NULL) ? real_name : tty_name + 1;
+
+  snprintf(path, length, "%s/bus/usb-serial/devices/%s/latency_timer", sysfs_root_, tty_name);
+  if(access(path, F_OK) == 0)
+    return true;
+
+  snprintf(path, length, "%s/class/tty/%s/device/latency_timer", sysfs_root_, tty_name);
+  if(access(path, F_OK) == 0)
+    return true;
+
+  return false;
+}
+
+bool PortHandlerLinux::setBaudrateInPlace(int speed)
+{
+#if defined(TCGETS2)
+  struct termios2 tio;
+
+  countIo(&io_stats_.ioctls);
+  if(ioctl(socket_fd_, TCGETS2, &tio) != 0)
+    return false;
+
+  // set any baudrate by BOTHER, and the input baudrate same as the output baudrate
+  tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+  tio.c_cflag |= BOTHER;
+  tio.c_ispeed = speed;
+  tio.c_ospeed = speed;
+
+  // TCSETSW2 lets the packet being written go out with the previous baudrate
+  countIo(&io_stats_.ioctls, 2);
+  if(ioctl(socket_fd_, TCSETSW2, &tio) != 0 || ioctl(socket_fd_, TCGETS2, &tio) != 0)
+    return false;
+
+  // the driver sets the closest baudrate that it can make
+  if(tio.c_ospeed < (speed_t)speed * 98 / 100 || tio.c_ospeed > (speed_t)speed * 102 / 100)
+  {
+    printf("[PortHandlerLinux::SetBaudrateInPlace] Cannot set speed to %d, closest is %d \n", speed, (int)tio.c_ospeed);
+    return false;
+  }
+
+  // bytes received with the previous baudrate are not meaningful
+  tcflush(socket_fd_, TCIFLUSH);
+  countIo(&io_stats_.flushes);
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+
+  baudrate_ = speed;
+  tx_time_per_byte = (1000.0 / (double)speed) * 10.0;
+  return true;
+#else
+  (void)speed;
+  return false;
+#endif
+}
+
 bool PortHandlerLinux::setCustomBaudrate(int speed)
 {
   // try to set a custom divisor
   struct serial_struct ss;
+  countIo(&io_stats_.ioctls);
   if(ioctl(socket_fd_, TIOCGSERIAL, &ss) != 0)
   {
     printf("[PortHandlerLinux::SetCustomBaudrate] TIOCGSERIAL failed!\n");
@@ -225,6 +853,7 @@ bool PortHandlerLinux::setCustomBaudrate(int speed)
     return false;
   }
 
+  countIo(&io_stats_.ioctls);
   if(ioctl(socket_fd_, TIOCSSERIAL, &ss) < 0)
   {
     printf("[PortHandlerLinux::SetCustomBaudrate] TIOCSSERIAL failed!\n");
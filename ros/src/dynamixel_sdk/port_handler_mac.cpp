@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <termios.h>
@@ -108,6 +109,20 @@ int PortHandlerMac::getBaudRate()
   return baudrate_;
 }
 
+bool PortHandlerMac::setOption(const char *key, const char *value)
+{
+  if(strcmp(key, "baud") == 0)
+  {
+    if(atoi(value) <= 0)
+      return false;
+    if(socket_fd_ != -1)
+      return setBaudRate(atoi(value));
+    baudrate_ = atoi(value);
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
 int PortHandlerMac::getBytesAvailable()
 {
   int bytes_available;
@@ -0,0 +1,328 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "port_handler_replay.h"
+
+#define LATENCY_TIMER   16  // msec (latency timer of the USB serial, as PortHandlerLinux)
+
+using namespace dynamixel;
+
+static uint64_t getLittleEndian(const uint8_t *data, int length)
+{
+  uint64_t value = 0;
+  for (int i = length - 1; i >= 0; i--)
+    value = (value << 8) | data[i];
+  return value;
+}
+
+PortHandlerReplay::PortHandlerReplay(const char *port_name)
+  : baudrate_(0),
+    speed_(1.0),
+    tx_time_per_byte(0.0),
+    capture_(0),
+    capture_length_(0),
+    cursor_(0),
+    anchor_ns_(0),
+    anchor_capture_ns_(0),
+    rx_head_(0),
+    rx_tail_(0),
+    packets_(0),
+    mismatches_(0)
+{
+  is_using_ = false;
+  setPortName(port_name);
+}
+
+bool PortHandlerReplay::openPort()
+{
+  closePort();
+
+  const char *path = port_name_;
+  if (strncmp(path, REPLAY_PORT_PREFIX, strlen(REPLAY_PORT_PREFIX)) == 0)
+    path += strlen(REPLAY_PORT_PREFIX);
+
+  FILE *file = fopen(path, "rb");
+  if (file == 0)
+  {
+    printf("[PortHandlerReplay::openPort] Error opening the capture file : %s\n", path);
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  if (length >= CAPTURE_MAGIC_LENGTH)
+  {
+    capture_ = (uint8_t *)malloc(length);
+    if (capture_ != 0 && fread(capture_, 1, length, file) == (size_t)length)
+      capture_length_ = length;
+  }
+  fclose(file);
+
+  if (capture_length_ == 0 || memcmp(capture_, CAPTURE_MAGIC, CAPTURE_MAGIC_LENGTH) != 0)
+  {
+    printf("[PortHandlerReplay::openPort] Not a capture file : %s\n", path);
+    closePort();
+    return false;
+  }
+
+  // the first baudrate recorded, and the start of the capture at the start of the playback
+  int64_t time_ns;
+  int     type, record_length;
+  cursor_ = CAPTURE_MAGIC_LENGTH;
+  if (getRecord(cursor_, &time_ns, &type, &record_length) == false)
+    time_ns = 0;
+  anchor_ns_          = getMonotonicNs();
+  anchor_capture_ns_  = time_ns;
+
+  for (long offset = cursor_; baudrate_ == 0 && getRecord(offset, &time_ns, &type, &record_length); offset += CAPTURE_HEADER_LENGTH + record_length)
+  {
+    if (type == PortHandlerRecord::CAPTURE_BAUD_ && record_length == 4)
+      baudrate_ = (int)getLittleEndian(&capture_[offset + CAPTURE_HEADER_LENGTH], 4);
+  }
+  return setBaudRate((baudrate_ > 0) ? baudrate_ : DEFAULT_BAUDRATE_);
+}
+
+void PortHandlerReplay::closePort()
+{
+  free(capture_);
+  capture_        = 0;
+  capture_length_ = 0;
+  cursor_         = 0;
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+}
+
+void PortHandlerReplay::clearPort()
+{
+  receive();
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+}
+
+void PortHandlerReplay::setPortName(const char *port_name)
+{
+  strncpy(port_name_, port_name, sizeof(port_name_) - 1);
+  port_name_[sizeof(port_name_) - 1] = 0;
+}
+
+char *PortHandlerReplay::getPortName()
+{
+  return port_name_;
+}
+
+bool PortHandlerReplay::setBaudRate(const int baudrate)
+{
+  baudrate_ = baudrate;
+  tx_time_per_byte = (1000.0 / (double)baudrate_) * 10.0;
+  return true;
+}
+
+int PortHandlerReplay::getBaudRate()
+{
+  return baudrate_;
+}
+
+bool PortHandlerReplay::setOption(const char *key, const char *value)
+{
+  if (strcmp(key, "baud") == 0)
+  {
+    if (atoi(value) <= 0)
+      return false;
+    return setBaudRate(atoi(value));
+  }
+  if (strcmp(key, "speed") == 0)
+  {
+    if (atof(value) < 0.0)
+      return false;
+    setSpeed(atof(value));
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
+bool PortHandlerReplay::getRecord(long offset, int64_t *time_ns, int *type, int *length)
+{
+  if (offset + CAPTURE_HEADER_LENGTH > capture_length_)
+    return false;
+
+  *time_ns  = (int64_t)getLittleEndian(&capture_[offset], 8);
+  *type     = capture_[offset + 8];
+  *length   = (int)getLittleEndian(&capture_[offset + 10], 2);
+
+  // a record cut off at the end of the file, as the recording stopped
+  return (offset + CAPTURE_HEADER_LENGTH + *length <= capture_length_);
+}
+
+bool PortHandlerReplay::isEndOfCapture()
+{
+  int64_t time_ns;
+  int     type, length;
+  return (getRecord(cursor_, &time_ns, &type, &length) == false);
+}
+
+int64_t PortHandlerReplay::getArrivalNs(int64_t time_ns)
+{
+  if (speed_ <= 0.0)
+    return anchor_ns_;
+  return anchor_ns_ + (int64_t)((double)(time_ns - anchor_capture_ns_) / speed_);
+}
+
+int64_t PortHandlerReplay::receive()
+{
+  int64_t now = getMonotonicNs();
+  int64_t time_ns;
+  int     type, length;
+
+  // the chunks read before the next chunk written, which have arrived
+  while (getRecord(cursor_, &time_ns, &type, &length))
+  {
+    if (type == PortHandlerRecord::CAPTURE_WRITE_)
+      break;
+
+    if (type == PortHandlerRecord::CAPTURE_READ_)
+    {
+      int64_t arrival = getArrivalNs(time_ns);
+      if (arrival > now)
+        return arrival;
+
+      if (rx_head_ > 0)
+      {
+        memmove(rx_buffer_, &rx_buffer_[rx_head_], rx_tail_ - rx_head_);
+        rx_tail_ -= rx_head_;
+        rx_head_ = 0;
+      }
+      if (rx_tail_ + length > RX_BUFFER_SIZE_)
+        return now;
+
+      memcpy(&rx_buffer_[rx_tail_], &capture_[cursor_ + CAPTURE_HEADER_LENGTH], length);
+      rx_tail_ += length;
+    }
+    cursor_ += CAPTURE_HEADER_LENGTH + length;
+  }
+  return -1;
+}
+
+int PortHandlerReplay::getBytesAvailable()
+{
+  receive();
+  return rx_tail_ - rx_head_;
+}
+
+int PortHandlerReplay::readPort(uint8_t *packet, int length)
+{
+  int arrived = getBytesAvailable();
+
+  if (length > arrived)
+    length = arrived;
+
+  memcpy(packet, &rx_buffer_[rx_head_], length);
+  consumePort(length);
+  return length;
+}
+
+int PortHandlerReplay::writePort(uint8_t *packet, int length)
+{
+  if (capture_ == 0)
+    return -1;
+
+  int64_t time_ns;
+  int     type, record_length;
+
+  receive();
+  packets_++;
+
+  // the chunk written in the capture, which the packet takes the place of
+  while (getRecord(cursor_, &time_ns, &type, &record_length))
+  {
+    long offset = cursor_;
+    cursor_ += CAPTURE_HEADER_LENGTH + record_length;
+    if (type != PortHandlerRecord::CAPTURE_WRITE_)
+      continue;
+
+    if (record_length != length || memcmp(&capture_[offset + CAPTURE_HEADER_LENGTH], packet, length) != 0)
+      mismatches_++;
+    anchor_ns_          = getMonotonicNs();
+    anchor_capture_ns_  = time_ns;
+    return length;
+  }
+
+  // after the end of the capture
+  mismatches_++;
+  return length;
+}
+
+int PortHandlerReplay::peekPort(uint8_t **data)
+{
+  peek_length_ = getBytesAvailable();
+
+  *data = &rx_buffer_[rx_head_];
+  return peek_length_;
+}
+
+void PortHandlerReplay::consumePort(int length)
+{
+  rx_head_ += (length < rx_tail_ - rx_head_) ? length : rx_tail_ - rx_head_;
+  peek_length_ = 0;
+  if (rx_head_ >= rx_tail_)
+    rx_head_ = rx_tail_ = 0;
+}
+
+bool PortHandlerReplay::waitPort()
+{
+  int64_t arrival = receive();
+  if (rx_tail_ - rx_head_ > peek_length_)
+    return true;
+
+  // nothing is on the way, or it arrives after the packet timeout, which is over once the deadline is passed
+  int64_t deadline = getPacketDeadline();
+  if (arrival < 0 || arrival > deadline)
+  {
+    sleepUntil(deadline + 1);
+    return false;
+  }
+
+  sleepUntil(arrival);
+  return true;
+}
+
+void PortHandlerReplay::setPacketTimeout(uint16_t packet_length)
+{
+  double msec = (tx_time_per_byte * (double)packet_length) + (LATENCY_TIMER * 2.0) + 2.0;
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+void PortHandlerReplay::setPacketTimeout(double msec)
+{
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+bool PortHandlerReplay::isPacketTimeout()
+{
+  return (getRemainingNs() < 0);
+}
+
+void PortHandlerReplay::setPacketDeadline(int64_t deadline_ns)
+{
+  packet_deadline_ns_ = deadline_ns;
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "port_handler_sim.h"
+
+#define LATENCY_TIMER   1   // msec (latency timer which PortHandlerLinux sets on the USB serial)
+
+using namespace dynamixel;
+
+PortHandlerSim::PortHandlerSim(const char *port_name)
+  : bus_(0),
+    baudrate_(DEFAULT_BAUDRATE_),
+    rx_head_(0),
+    rx_tail_(0),
+    tx_time_per_byte(0.0)
+{
+  is_using_ = false;
+  setPortName(port_name);
+}
+
+bool PortHandlerSim::openPort()
+{
+  closePort();
+  return setBaudRate(baudrate_);
+}
+
+void PortHandlerSim::closePort()
+{
+  bus_ = 0;
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+}
+
+void PortHandlerSim::clearPort()
+{
+  consumePort(getArrivedBytes());
+}
+
+void PortHandlerSim::setPortName(const char *port_name)
+{
+  strncpy(port_name_, port_name, sizeof(port_name_) - 1);
+  port_name_[sizeof(port_name_) - 1] = 0;
+}
+
+char *PortHandlerSim::getPortName()
+{
+  return port_name_;
+}
+
+bool PortHandlerSim::setBaudRate(const int baudrate)
+{
+  if (bus_ == 0)
+  {
+    const char *bus_name = port_name_;
+    if (strncmp(bus_name, SIM_PORT_PREFIX, strlen(SIM_PORT_PREFIX)) == 0)
+      bus_name += strlen(SIM_PORT_PREFIX);
+    bus_ = SimulatedBus::getBus(bus_name);
+  }
+
+  baudrate_ = baudrate;
+  tx_time_per_byte = (1000.0 / (double)baudrate_) * 10.0;
+  return true;
+}
+
+int PortHandlerSim::getBaudRate()
+{
+  return baudrate_;
+}
+
+bool PortHandlerSim::setOption(const char *key, const char *value)
+{
+  if (strcmp(key, "baud") == 0)
+  {
+    if (atoi(value) <= 0)
+      return false;
+    if (bus_ != 0)
+      return setBaudRate(atoi(value));
+    baudrate_ = atoi(value);
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
+int PortHandlerSim::getArrivedBytes()
+{
+  int64_t now = getMonotonicNs();
+  int     arrived = rx_head_;
+
+  while (arrived < rx_tail_ && rx_arrival_ns_[arrived] <= now)
+    arrived++;
+  return arrived - rx_head_;
+}
+
+int PortHandlerSim::getBytesAvailable()
+{
+  return getArrivedBytes();
+}
+
+int PortHandlerSim::readPort(uint8_t *packet, int length)
+{
+  int arrived = getArrivedBytes();
+
+  if (length > arrived)
+    length = arrived;
+
+  memcpy(packet, &rx_buffer_[rx_head_], length);
+  consumePort(length);
+  return length;
+}
+
+int PortHandlerSim::writePort(uint8_t *packet, int length)
+{
+  if (bus_ == 0)
+    return -1;
+
+  // make room for the status packets
+  if (rx_head_ > 0)
+  {
+    memmove(rx_buffer_, &rx_buffer_[rx_head_], rx_tail_ - rx_head_);
+    memmove(rx_arrival_ns_, &rx_arrival_ns_[rx_head_], (rx_tail_ - rx_head_) * sizeof(int64_t));
+    rx_tail_ -= rx_head_;
+    rx_head_ = 0;
+  }
+
+  rx_tail_ += bus_->transfer(packet, length, baudrate_, getMonotonicNs(),
+                             &rx_buffer_[rx_tail_], &rx_arrival_ns_[rx_tail_], RX_BUFFER_SIZE_ - rx_tail_);
+  return length;
+}
+
+int PortHandlerSim::peekPort(uint8_t **data)
+{
+  *data = &rx_buffer_[rx_head_];
+  peek_length_ = getArrivedBytes();
+  return peek_length_;
+}
+
+void PortHandlerSim::consumePort(int length)
+{
+  rx_head_ += (length < rx_tail_ - rx_head_) ? length : rx_tail_ - rx_head_;
+  peek_length_ = 0;
+  if (rx_head_ >= rx_tail_)
+    rx_head_ = rx_tail_ = 0;
+}
+
+bool PortHandlerSim::waitPort()
+{
+  int arrived = getArrivedBytes();
+  if (arrived > peek_length_)
+    return true;
+
+  // nothing is on the way, or it arrives after the packet timeout, which is over once the deadline is passed
+  int next = rx_head_ + arrived;
+  if (next == rx_tail_ || rx_arrival_ns_[next] > packet_deadline_ns_)
+  {
+    sleepUntil(packet_deadline_ns_ + 1);
+    return false;
+  }
+
+  // wake up once for the burst of bytes sent back to back, as the USB serial delivers them
+  int64_t byte_ns = (int64_t)(tx_time_per_byte * 1000000.0);
+  int     last    = next;
+  while (last + 1 < rx_tail_ && rx_arrival_ns_[last + 1] - rx_arrival_ns_[last] <= 2 * byte_ns && rx_arrival_ns_[last + 1] <= packet_deadline_ns_)
+    last++;
+
+  sleepUntil(rx_arrival_ns_[last]);
+  return true;
+}
+
+void PortHandlerSim::setPacketTimeout(uint16_t packet_length)
+{
+  double latency = LATENCY_TIMER + ((bus_ == 0) ? 0.0 : (double)bus_->getTransportDelay() / 1000000.0);
+  double msec = (tx_time_per_byte * (double)packet_length) + (latency * 2.0) + 2.0;
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+void PortHandlerSim::setPacketTimeout(double msec)
+{
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+bool PortHandlerSim::isPacketTimeout()
+{
+  return (getRemainingNs() < 0);
+}
+
+void PortHandlerSim::setPacketDeadline(int64_t deadline_ns)
+{
+  packet_deadline_ns_ = deadline_ns;
+}
+
+#endif
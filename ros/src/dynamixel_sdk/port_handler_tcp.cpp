@@ -0,0 +1,431 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "port_handler_tcp.h"
+
+#define GATEWAY_LATENCY   2     // msec (packing interval of the serial-to-Ethernet gateway)
+#define CONNECT_TIMEOUT   3000  // msec
+#define MAX_WRITE_SEGMENTS  8
+
+#if defined(MSG_NOSIGNAL)
+#define SEND_FLAGS  MSG_NOSIGNAL
+#else
+#define SEND_FLAGS  0
+#endif
+
+using namespace dynamixel;
+
+PortHandlerTcp::PortHandlerTcp(const char *port_name)
+  : socket_fd_(-1),
+    baudrate_(DEFAULT_BAUDRATE_),
+    rx_head_(0),
+    rx_tail_(0),
+    gateway_latency_(GATEWAY_LATENCY),
+    connect_rtt_(0.0),
+    tx_time_per_byte(0.0)
+{
+  is_using_ = false;
+  setPortName(port_name);
+}
+
+bool PortHandlerTcp::openPort()
+{
+  closePort();
+  return setBaudRate(baudrate_);
+}
+
+void PortHandlerTcp::closePort()
+{
+  if(socket_fd_ != -1)
+    close(socket_fd_);
+  socket_fd_ = -1;
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+}
+
+void PortHandlerTcp::clearPort()
+{
+  rx_head_ = rx_tail_ = peek_length_ = 0;
+  while (fillBuffer() > 0)
+    rx_head_ = rx_tail_ = peek_length_ = 0;
+}
+
+void PortHandlerTcp::setPortName(const char *port_name)
+{
+  strncpy(port_name_, port_name, sizeof(port_name_) - 1);
+  port_name_[sizeof(port_name_) - 1] = 0;
+}
+
+char *PortHandlerTcp::getPortName()
+{
+  return port_name_;
+}
+
+bool PortHandlerTcp::setBaudRate(const int baudrate)
+{
+  // the gateway keeps the baudrate of its serial side by its own configuration
+  baudrate_ = baudrate;
+  tx_time_per_byte = (1000.0 / (double)baudrate_) * 10.0;
+
+  if(socket_fd_ != -1)
+    return true;
+  return connectSocket();
+}
+
+int PortHandlerTcp::getBaudRate()
+{
+  return baudrate_;
+}
+
+bool PortHandlerTcp::setOption(const char *key, const char *value)
+{
+  if(strcmp(key, "baud") == 0)
+  {
+    if(atoi(value) <= 0)
+      return false;
+    if(socket_fd_ != -1)
+      return setBaudRate(atoi(value));
+    baudrate_ = atoi(value);
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
+void PortHandlerTcp::setGatewayLatency(double msec)
+{
+  gateway_latency_ = msec;
+}
+
+double PortHandlerTcp::getGatewayLatency()
+{
+  return gateway_latency_;
+}
+
+double PortHandlerTcp::getNetworkRtt()
+{
+#if defined(__linux__) && defined(TCP_INFO)
+  struct tcp_info info;
+  socklen_t       info_length = sizeof(info);
+
+  if(socket_fd_ != -1 && getsockopt(socket_fd_, IPPROTO_TCP, TCP_INFO, &info, &info_length) == 0 && info.tcpi_rtt > 0)
+    return (double)(info.tcpi_rtt + 4 * info.tcpi_rttvar) / 1000.0;
+#endif
+  return connect_rtt_;
+}
+
+bool PortHandlerTcp::connectSocket()
+{
+  char host[100];
+  const char *port;
+  const char *name = port_name_;
+
+  if(strncmp(name, TCP_PORT_PREFIX, strlen(TCP_PORT_PREFIX)) == 0)
+    name += strlen(TCP_PORT_PREFIX);
+
+  // "<host>:<port>", or "[<IPv6 address>]:<port>"
+  port = strrchr(name, ':');
+  if(port == 0 || port == name || (size_t)(port - name) >= sizeof(host))
+  {
+    printf("[PortHandlerTcp::connectSocket] Invalid port name %s\n", port_name_);
+    return false;
+  }
+  memcpy(host, name, port - name);
+  host[port - name] = 0;
+  port++;
+
+  if(host[0] == '[' && host[strlen(host) - 1] == ']')
+  {
+    host[strlen(host) - 1] = 0;
+    memmove(host, host + 1, strlen(host));
+  }
+
+  struct addrinfo hints;
+  struct addrinfo *result, *ai;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if(getaddrinfo(host, port, &hints, &result) != 0)
+  {
+    printf("[PortHandlerTcp::connectSocket] Error resolving %s\n", port_name_);
+    return false;
+  }
+
+  for(ai = result; ai != 0; ai = ai->ai_next)
+  {
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if(fd < 0)
+      continue;
+
+    // connect without blocking, so that an unreachable gateway fails after CONNECT_TIMEOUT
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    int64_t start = getMonotonicNs();
+    int     error = 0;
+
+    if(connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+    {
+      struct pollfd pfd;
+      socklen_t     error_length = sizeof(error);
+
+      pfd.fd      = fd;
+      pfd.events  = POLLOUT;
+      pfd.revents = 0;
+
+      if(errno != EINPROGRESS || poll(&pfd, 1, CONNECT_TIMEOUT) <= 0
+         || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length) != 0 || error != 0)
+      {
+        close(fd);
+        continue;
+      }
+    }
+    connect_rtt_ = (double)(getMonotonicNs() - start) / 1000000.0;
+
+    fcntl(fd, F_SETFL, flags);
+
+    // every instruction packet has to go out at once, not to wait for the acknowledgement of the previous one
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#if defined(SO_NOSIGPIPE)
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    socket_fd_ = fd;
+    break;
+  }
+  freeaddrinfo(result);
+
+  if(socket_fd_ == -1)
+  {
+    printf("[PortHandlerTcp::connectSocket] Error connecting to %s\n", port_name_);
+    return false;
+  }
+  return true;
+}
+
+int PortHandlerTcp::getBytesAvailable()
+{
+  int bytes_available = 0;
+  int buffered        = rx_tail_ - rx_head_;
+
+  // the socket is asked only when the buffered bytes are none, or all peeked already
+  if(buffered > peek_length_)
+    return buffered;
+
+  if(socket_fd_ != -1)
+  {
+    countIo(&io_stats_.ioctls);
+    ioctl(socket_fd_, FIONREAD, &bytes_available);
+  }
+  return buffered + bytes_available;
+}
+
+int PortHandlerTcp::readPort(uint8_t *packet, int length)
+{
+  if(rx_tail_ == rx_head_ && fillBuffer() <= 0)
+    return 0;
+
+  if(length > rx_tail_ - rx_head_)
+    length = rx_tail_ - rx_head_;
+
+  memcpy(packet, &rx_buffer_[rx_head_], length);
+  consumePort(length);
+  return length;
+}
+
+int PortHandlerTcp::writePort(uint8_t *packet, int length)
+{
+  if(socket_fd_ == -1)
+    return -1;
+
+  int written = send(socket_fd_, packet, length, SEND_FLAGS);
+  countIo(&io_stats_.writes);
+  if(written > 0)
+    countIo(&io_stats_.bytes_out, written);
+  return written;
+}
+
+int PortHandlerTcp::writePortV(PortSegment *segments, int count)
+{
+  struct iovec  iov[MAX_WRITE_SEGMENTS];
+  struct msghdr msg;
+
+  if(count > MAX_WRITE_SEGMENTS)
+    return PortHandler::writePortV(segments, count);
+  if(socket_fd_ == -1)
+    return -1;
+
+  for(int i = 0; i < count; i++)
+  {
+    iov[i].iov_base = segments[i].data;
+    iov[i].iov_len  = segments[i].length;
+  }
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov    = iov;
+  msg.msg_iovlen = count;
+
+  int written = sendmsg(socket_fd_, &msg, SEND_FLAGS);
+  countIo(&io_stats_.writes);
+  if(written > 0)
+    countIo(&io_stats_.bytes_out, written);
+  return written;
+}
+
+int PortHandlerTcp::peekPort(uint8_t **data)
+{
+  // the caller has seen every byte buffered: the bytes received since are added behind them
+  if(rx_tail_ - rx_head_ <= peek_length_)
+    fillBuffer();
+
+  *data = &rx_buffer_[rx_head_];
+  peek_length_ = rx_tail_ - rx_head_;
+  return peek_length_;
+}
+
+void PortHandlerTcp::consumePort(int length)
+{
+  rx_head_ += (length < rx_tail_ - rx_head_) ? length : rx_tail_ - rx_head_;
+  peek_length_ = 0;
+  if(rx_head_ >= rx_tail_)
+    rx_head_ = rx_tail_ = 0;
+}
+
+int PortHandlerTcp::fillBuffer()
+{
+  if(socket_fd_ == -1)
+    return -1;
+
+  // the bytes left are moved to the front, so a packet cut off grows in place
+  if(rx_head_ > 0)
+  {
+    memmove(rx_buffer_, &rx_buffer_[rx_head_], rx_tail_ - rx_head_);
+    rx_tail_ -= rx_head_;
+    rx_head_ = 0;
+  }
+  if(rx_tail_ == RX_BUFFER_SIZE_)
+    return 0;
+
+  // drain everything the socket has received by a single recv()
+  int length = recv(socket_fd_, &rx_buffer_[rx_tail_], RX_BUFFER_SIZE_ - rx_tail_, MSG_DONTWAIT);
+  countIo(&io_stats_.reads);
+  if(length <= 0)
+    countIo(&io_stats_.zero_reads);
+  if(length == 0)
+  {
+    // the gateway closed the connection; writePort() fails from now on until the port is opened again
+    printf("[PortHandlerTcp::fillBuffer] Connection to %s is closed\n", port_name_);
+    close(socket_fd_);
+    socket_fd_ = -1;
+    return -1;
+  }
+  if(length < 0)
+    return length;
+
+  countIo(&io_stats_.bytes_in, length);
+  rx_tail_ += length;
+  return length;
+}
+
+bool PortHandlerTcp::waitPort()
+{
+  struct pollfd pfd;
+
+  if(rx_tail_ - rx_head_ > peek_length_)
+    return true;
+
+  int64_t start     = getMonotonicNs();
+  int64_t remaining = packet_deadline_ns_ - start;
+  if(remaining <= 0 || socket_fd_ == -1)
+    return false;
+
+  // spin before sleeping by the wait strategy
+  if(getWaitStrategy() != WAIT_BLOCK_)
+  {
+    int64_t spin_end = (getWaitStrategy() == WAIT_SPIN_) ? packet_deadline_ns_ : start + (int64_t)(getWaitSpinTime() * 1000.0);
+    bool    spun     = spinPort((spin_end < packet_deadline_ns_) ? spin_end : packet_deadline_ns_);
+    if(spun || getWaitStrategy() == WAIT_SPIN_)
+    {
+      addWaitSample(start, spun, true);
+      return spun;
+    }
+
+    remaining = getRemainingNs();
+    if(remaining <= 0)
+    {
+      addWaitSample(start, false, false);
+      return false;
+    }
+  }
+
+  pfd.fd      = socket_fd_;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+
+  int64_t blocked = getMonotonicNs();
+#if defined(__linux__)
+  struct timespec ts;
+  ts.tv_sec   = (time_t)(remaining / 1000000000LL);
+  ts.tv_nsec  = (long)(remaining % 1000000000LL);
+
+  bool received = (ppoll(&pfd, 1, &ts, NULL) > 0);
+#else
+  bool received = (poll(&pfd, 1, (int)((remaining + 999999LL) / 1000000LL)) > 0);
+#endif
+  countIo(&io_stats_.blocked_ns, (uint64_t)(getMonotonicNs() - blocked));
+  addWaitSample(start, received, false);
+  return received;
+}
+
+void PortHandlerTcp::setPacketTimeout(uint16_t packet_length)
+{
+  double msec = (tx_time_per_byte * (double)packet_length) + getNetworkRtt() + gateway_latency_ + 2.0;
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+void PortHandlerTcp::setPacketTimeout(double msec)
+{
+  setPacketDeadline(getMonotonicNs() + (int64_t)(msec * 1000000.0));
+}
+
+bool PortHandlerTcp::isPacketTimeout()
+{
+  return (getRemainingNs() < 0);
+}
+
+void PortHandlerTcp::setPacketDeadline(int64_t deadline_ns)
+{
+  packet_deadline_ns_ = deadline_ns;
+}
+
+#endif
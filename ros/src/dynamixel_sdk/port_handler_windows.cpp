@@ -22,6 +22,7 @@
 #include "port_handler_windows.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -93,6 +94,20 @@ int PortHandlerWindows::getBaudRate()
   return baudrate_;
 }
 
+bool PortHandlerWindows::setOption(const char *key, const char *value)
+{
+  if (strcmp(key, "baud") == 0)
+  {
+    if (atoi(value) <= 0)
+      return false;
+    if (serial_handle_ != INVALID_HANDLE_VALUE)
+      return setBaudRate(atoi(value));
+    baudrate_ = atoi(value);
+    return true;
+  }
+  return PortHandler::setOption(key, value);
+}
+
 int PortHandlerWindows::getBytesAvailable()
 {
   DWORD retbyte = 2;
@@ -125,14 +125,13 @@ int Protocol1PacketHandler::txPacket(PortHandler *port, uint8_t *txpacket)
   uint8_t total_packet_length    = txpacket[PKT_LENGTH] + 4; // 4: HEADER0 HEADER1 ID LENGTH
   uint8_t written_packet_length  = 0;
 
-  if (port->is_using_)
+  if (port->beginTransaction() == false)
     return COMM_PORT_BUSY;
-  port->is_using_ = true;
 
   // check max packet length
   if (total_packet_length > TXPACKET_MAX_LEN)
   {
-    port->is_using_ = false;
+    port->endTransaction();
     return COMM_TX_ERROR;
   }
 
@@ -146,58 +145,189 @@ int Protocol1PacketHandler::txPacket(PortHandler *port, uint8_t *txpacket)
   txpacket[total_packet_length - 1] = ~checksum;
 
   // tx packet
-  port->clearPort();
+  if (port->flushStale() == false)
+    drainPort(port);
   written_packet_length = port->writePort(txpacket, total_packet_length);
   if (total_packet_length != written_packet_length)
   {
-    port->is_using_ = false;
+    port->endTransaction();
     return COMM_TX_FAIL;
   }
 
   return COMM_SUCCESS;
 }
 
+int Protocol1PacketHandler::txPacketV(PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length)
+{
+  uint8_t checksum               = 0;
+  uint16_t head_length           = 0;
+  uint16_t total_packet_length   = 0;
+  uint16_t written_packet_length = 0;
+
+  // check max packet length
+  // (LENGTH is one byte and wraps with long parameters: check them before it is used)
+  if (param_length + 6 > TXPACKET_MAX_LEN)  // 6: HEADER0 HEADER1 ID LENGTH INST CHKSUM
+    return COMM_TX_ERROR;
+
+  head_length           = (uint8_t)(txpacket[PKT_LENGTH] - param_length) + 4 - 1;
+  // 4: HEADER0 HEADER1 ID LENGTH, 1: CHKSUM
+  total_packet_length   = head_length + param_length + 1; // 1: CHKSUM
+  if (total_packet_length > TXPACKET_MAX_LEN)
+    return COMM_TX_ERROR;
+
+  if (port->beginTransaction() == false)
+    return COMM_PORT_BUSY;
+
+  // make packet header
+  txpacket[PKT_HEADER0]   = 0xFF;
+  txpacket[PKT_HEADER1]   = 0xFF;
+
+  // add a checksum to the packet
+  for (uint16_t idx = 2; idx < head_length; idx++)   // except header
+    checksum += txpacket[idx];
+  for (uint16_t idx = 0; idx < param_length; idx++)
+    checksum += param[idx];
+  checksum = ~checksum;
+
+  // tx packet: header, caller's parameters and checksum without copying them together
+  // (a packet without param, as a write of length 0 or a whole packet, has no param segment)
+  PortSegment segments[3];
+  int         segment_count = 0;
+  segments[segment_count].data = txpacket;   segments[segment_count++].length = head_length;
+  if (param_length > 0)
+  {
+    segments[segment_count].data = param;    segments[segment_count++].length = param_length;
+  }
+  segments[segment_count].data = &checksum; segments[segment_count++].length = 1;
+
+  if (port->flushStale() == false)
+    drainPort(port);
+  written_packet_length = port->writePortV(segments, segment_count);
+  if (total_packet_length != written_packet_length)
+  {
+    port->endTransaction();
+    return COMM_TX_FAIL;
+  }
+
+  return COMM_SUCCESS;
+}
+
+void Protocol1PacketHandler::drainPort(PortHandler *port)
+{
+  uint8_t rxpacket[RXPACKET_MAX_LEN];
+  int     rx_length   = 0;
+  int     read_length = 0;
+  int     stale_bytes = 0;
+
+  // the bytes left are parsed as they are read, until the port has no more
+  while ((read_length = port->readPort(&rxpacket[rx_length], RXPACKET_MAX_LEN - rx_length)) > 0)
+  {
+    rx_length += read_length;
+
+    int idx = 0;
+    while (rx_length - idx >= 6)    // minimum length of a status packet
+    {
+      uint8_t *packet = &rxpacket[idx];
+      int packet_length = packet[PKT_LENGTH] + PKT_LENGTH + 1;
+
+      if (packet[PKT_HEADER0] != 0xFF || packet[PKT_HEADER1] != 0xFF ||
+          packet[PKT_ID] > 0xFD || packet[PKT_ERROR] > 0x7F || packet_length > RXPACKET_MAX_LEN)
+      {
+        stale_bytes++;
+        idx++;
+        continue;
+      }
+
+      // the rest of the packet is not read yet
+      if (rx_length - idx < packet_length)
+        break;
+
+      uint8_t checksum = 0;
+      for (int i = 2; i < packet_length - 1; i++)   // except header, checksum
+        checksum += packet[i];
+
+      if ((uint8_t)~checksum == packet[packet_length - 1])
+      {
+        port->addStalePacket(packet[PKT_ID]);
+        idx += packet_length;
+      }
+      else
+      {
+        stale_bytes++;
+        idx++;
+      }
+    }
+
+    memmove(&rxpacket[0], &rxpacket[idx], rx_length - idx);
+    rx_length -= idx;
+  }
+
+  // with a packet cut off by the end of the bytes received
+  port->addStaleBytes(stale_bytes + rx_length);
+}
+
+// removes bytes at the beginning of those received, in the port buffer or in rxpacket
+static void removeBytes(PortHandler *port, bool in_place, uint8_t **data, int *rx_length, int length)
+{
+  if (in_place)
+  {
+    port->consumePort(length);
+    *rx_length = port->peekPort(data);
+    return;
+  }
+
+  for (int s = 0; s < *rx_length - length; s++)
+    (*data)[s] = (*data)[length + s];
+  *rx_length -= length;
+}
+
 int Protocol1PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
 {
   int     result         = COMM_TX_FAIL;
 
   uint8_t checksum       = 0;
-  uint8_t rx_length      = 0;
+  uint8_t *data          = 0;
+  int     rx_length      = 0;
   uint8_t wait_length    = 6;    // minimum length (HEADER0 HEADER1 ID LENGTH ERROR CHKSUM)
 
+  // the packet is parsed in place in the port buffer, or read into rxpacket when the port has no buffer
+  rx_length = port->peekPort(&data);
+  bool    in_place       = (data != 0);
+  if (in_place == false)
+    data = rxpacket;
+
   while(true)
   {
-    rx_length += port->readPort(&rxpacket[rx_length], wait_length - rx_length);
+    if (in_place == false)
+      rx_length += port->readPort(&rxpacket[rx_length], wait_length - rx_length);
     if (rx_length >= wait_length)
     {
-      uint8_t idx = 0;
+      int idx = 0;
 
       // find packet header
       for (idx = 0; idx < (rx_length - 1); idx++)
       {
-        if (rxpacket[idx] == 0xFF && rxpacket[idx+1] == 0xFF)
+        if (data[idx] == 0xFF && data[idx+1] == 0xFF)
           break;
       }
 
       if (idx == 0)   // found at the beginning of the packet
       {
-        if (rxpacket[PKT_ID] > 0xFD ||                  // unavailable ID
-            rxpacket[PKT_LENGTH] > RXPACKET_MAX_LEN ||  // unavailable Length
-            rxpacket[PKT_ERROR] > 0x7F)                 // unavailable Error
+        if (data[PKT_ID] > 0xFD ||                  // unavailable ID
+            data[PKT_LENGTH] > RXPACKET_MAX_LEN ||  // unavailable Length
+            data[PKT_ERROR] > 0x7F)                 // unavailable Error
         {
             // remove the first byte in the packet
-            for (uint16_t s = 0; s < rx_length - 1; s++)
-              rxpacket[s] = rxpacket[1 + s];
-            //memcpy(&rxpacket[0], &rxpacket[idx], rx_length - idx);
-            rx_length -= 1;
+            removeBytes(port, in_place, &data, &rx_length, 1);
             continue;
         }
 
         // re-calculate the exact length of the rx packet
-        if (wait_length != rxpacket[PKT_LENGTH] + PKT_LENGTH + 1)
+        if (wait_length != data[PKT_LENGTH] + PKT_LENGTH + 1)
         {
-          wait_length = rxpacket[PKT_LENGTH] + PKT_LENGTH + 1;
-          continue;
+          wait_length = data[PKT_LENGTH] + PKT_LENGTH + 1;
+          if (in_place == false)
+            continue;
         }
 
         if (rx_length < wait_length)
@@ -217,17 +347,20 @@ int Protocol1PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
           }
           else
           {
+            port->waitPort();
+            if (in_place)
+              rx_length = port->peekPort(&data);
             continue;
           }
         }
 
         // calculate checksum
         for (uint16_t i = 2; i < wait_length - 1; i++)   // except header, checksum
-          checksum += rxpacket[i];
+          checksum += data[i];
         checksum = ~checksum;
 
         // verify checksum
-        if (rxpacket[wait_length - 1] == checksum)
+        if (data[wait_length - 1] == checksum)
         {
           result = COMM_SUCCESS;
         }
@@ -240,10 +373,7 @@ int Protocol1PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
       else
       {
         // remove unnecessary packets
-        for (uint16_t s = 0; s < rx_length - idx; s++)
-          rxpacket[s] = rxpacket[idx + s];
-        //memcpy(&rxpacket[0], &rxpacket[idx], rx_length - idx);
-        rx_length -= idx;
+        removeBytes(port, in_place, &data, &rx_length, idx);
       }
     }
     else
@@ -261,20 +391,50 @@ int Protocol1PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
         }
         break;
       }
+
+      // sleep until the rest of the packet arrives
+      port->waitPort();
+      if (in_place)
+        rx_length = port->peekPort(&data);
     }
   }
-  port->is_using_ = false;
+
+  // the packet is taken out of the port buffer, and the bytes after it are left for the next one
+  if (in_place)
+  {
+    if (rx_length > wait_length)
+      rx_length = wait_length;
+    if (result == COMM_SUCCESS)
+      memcpy(rxpacket, data, rx_length);
+    port->consumePort(rx_length);
+  }
+  port->endTransaction();
+
+  if (result == COMM_RX_CORRUPT)
+    port->addStaleBytes(rx_length);
 
   return result;
 }
 
 // NOT for BulkRead instruction
 int Protocol1PacketHandler::txRxPacket(PortHandler *port, uint8_t *txpacket, uint8_t *rxpacket, uint8_t *error)
+{
+  return txRxPacketV(port, txpacket, 0, 0, rxpacket, error);
+}
+
+// NOT for BulkRead instruction
+int Protocol1PacketHandler::txRxPacketV(PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length, uint8_t *rxpacket, uint8_t *error)
 {
   int result = COMM_TX_FAIL;
 
+  // the status packets skipped for another ID are received in the same transaction
+  PortTransaction transaction(port);
+  if (transaction.isLocked() == false)
+    return COMM_PORT_BUSY;
+
   // tx packet
-  result = txPacket(port, txpacket);
+  // (txPacketV() does not write past the packet without param: txpacket may hold the header only)
+  result = txPacketV(port, txpacket, param, param_length);
   if (result != COMM_SUCCESS)
     return result;
 
@@ -286,25 +446,31 @@ int Protocol1PacketHandler::txRxPacket(PortHandler *port, uint8_t *txpacket, uin
   // (Instruction == action) == no need to wait for status packet
   if (txpacket[PKT_ID] == BROADCAST_ID || txpacket[PKT_INSTRUCTION] == INST_ACTION)
   {
-    port->is_using_ = false;
+    port->endTransaction();
     return result;
   }
 
   // set packet timeout
+  uint16_t instruction_length = txpacket[PKT_LENGTH] + 4;
   if (txpacket[PKT_INSTRUCTION] == INST_READ)
   {
-    port->setPacketTimeout((uint16_t)(txpacket[PKT_PARAMETER0+1] + 6));
+    port->setStatusTimeout(txpacket[PKT_ID], instruction_length, (uint16_t)(txpacket[PKT_PARAMETER0+1] + 6));
   }
   else
   {
-    port->setPacketTimeout((uint16_t)6); // HEADER0 HEADER1 ID LENGTH ERROR CHECKSUM
+    port->setStatusTimeout(txpacket[PKT_ID], instruction_length, (uint16_t)6); // HEADER0 HEADER1 ID LENGTH ERROR CHECKSUM
   }
 
   // rx packet
   do {
     result = rxPacket(port, rxpacket);
+    if (result == COMM_SUCCESS && txpacket[PKT_ID] != rxpacket[PKT_ID])
+      port->addStalePacket(rxpacket[PKT_ID]);
   } while (result == COMM_SUCCESS && txpacket[PKT_ID] != rxpacket[PKT_ID]);
 
+  if (result == COMM_SUCCESS || result == COMM_RX_TIMEOUT)
+    port->updateStatusLatency(txpacket[PKT_ID], result == COMM_SUCCESS);
+
   if (result == COMM_SUCCESS && txpacket[PKT_ID] == rxpacket[PKT_ID])
   {
     if (error != 0)
@@ -409,6 +575,8 @@ int Protocol1PacketHandler::readRx(PortHandler *port, uint8_t id, uint16_t lengt
 
   do {
     result = rxPacket(port, rxpacket);
+    if (result == COMM_SUCCESS && rxpacket[PKT_ID] != id)
+      port->addStalePacket(rxpacket[PKT_ID]);
   } while (result == COMM_SUCCESS && rxpacket[PKT_ID] != id);
 
   if (result == COMM_SUCCESS && rxpacket[PKT_ID] == id)
@@ -531,23 +699,17 @@ int Protocol1PacketHandler::writeTxOnly(PortHandler *port, uint8_t id, uint16_t
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length+7);
-  //uint8_t *txpacket           = new uint8_t[length+7];
+  uint8_t txpacket[6]         = {0};
+  // 6: HEADER0 HEADER1 ID LEN INST ADDR (data and checksum are sent from their own buffers)
 
   txpacket[PKT_ID]            = id;
   txpacket[PKT_LENGTH]        = length+3;
   txpacket[PKT_INSTRUCTION]   = INST_WRITE;
   txpacket[PKT_PARAMETER0]    = (uint8_t)address;
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+1+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+1], data, length);
-
-  result = txPacket(port, txpacket);
-  port->is_using_ = false;
+  result = txPacketV(port, txpacket, data, length);
+  port->endTransaction();
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -555,8 +717,7 @@ int Protocol1PacketHandler::writeTxRx(PortHandler *port, uint8_t id, uint16_t ad
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length+7); //#6->7
-  //uint8_t *txpacket           = new uint8_t[length+7];
+  uint8_t txpacket[6]         = {0};
   uint8_t rxpacket[6]         = {0};
 
   txpacket[PKT_ID]            = id;
@@ -564,14 +725,8 @@ int Protocol1PacketHandler::writeTxRx(PortHandler *port, uint8_t id, uint16_t ad
   txpacket[PKT_INSTRUCTION]   = INST_WRITE;
   txpacket[PKT_PARAMETER0]    = (uint8_t)address;
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+1+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+1], data, length);
-
-  result = txRxPacket(port, txpacket, rxpacket, error);
+  result = txRxPacketV(port, txpacket, data, length, rxpacket, error);
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -612,23 +767,17 @@ int Protocol1PacketHandler::regWriteTxOnly(PortHandler *port, uint8_t id, uint16
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length+6);
-  //uint8_t *txpacket           = new uint8_t[length+6];
+  uint8_t txpacket[6]         = {0};
+  // 6: HEADER0 HEADER1 ID LEN INST ADDR (data and checksum are sent from their own buffers)
 
   txpacket[PKT_ID]            = id;
   txpacket[PKT_LENGTH]        = length+3;
   txpacket[PKT_INSTRUCTION]   = INST_REG_WRITE;
   txpacket[PKT_PARAMETER0]    = (uint8_t)address;
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+1+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+1], data, length);
-
-  result = txPacket(port, txpacket);
-  port->is_using_ = false;
+  result = txPacketV(port, txpacket, data, length);
+  port->endTransaction();
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -636,8 +785,7 @@ int Protocol1PacketHandler::regWriteTxRx(PortHandler *port, uint8_t id, uint16_t
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length+6);
-  //uint8_t *txpacket           = new uint8_t[length+6];
+  uint8_t txpacket[6]         = {0};
   uint8_t rxpacket[6]         = {0};
 
   txpacket[PKT_ID]            = id;
@@ -645,14 +793,8 @@ int Protocol1PacketHandler::regWriteTxRx(PortHandler *port, uint8_t id, uint16_t
   txpacket[PKT_INSTRUCTION]   = INST_REG_WRITE;
   txpacket[PKT_PARAMETER0]    = (uint8_t)address;
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+1+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+1], data, length);
+  result = txRxPacketV(port, txpacket, data, length, rxpacket, error);
 
-  result = txRxPacket(port, txpacket, rxpacket, error);
-
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -665,9 +807,8 @@ int Protocol1PacketHandler::syncWriteTxOnly(PortHandler *port, uint16_t start_ad
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(param_length+8);
-  // 8: HEADER0 HEADER1 ID LEN INST START_ADDR DATA_LEN ... CHKSUM
-  //uint8_t *txpacket           = new uint8_t[param_length + 8];
+  uint8_t txpacket[7]         = {0};
+  // 7: HEADER0 HEADER1 ID LEN INST START_ADDR DATA_LEN (param and checksum are sent from their own buffers)
 
   txpacket[PKT_ID]            = BROADCAST_ID;
   txpacket[PKT_LENGTH]        = param_length + 4; // 4: INST START_ADDR DATA_LEN ... CHKSUM
@@ -675,14 +816,8 @@ int Protocol1PacketHandler::syncWriteTxOnly(PortHandler *port, uint16_t start_ad
   txpacket[PKT_PARAMETER0+0]  = start_address;
   txpacket[PKT_PARAMETER0+1]  = data_length;
 
-  for (uint16_t s = 0; s < param_length; s++)
-    txpacket[PKT_PARAMETER0+2+s] = param[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+2], param, param_length);
-
-  result = txRxPacket(port, txpacket, 0, 0);
+  result = txRxPacketV(port, txpacket, param, param_length, 0, 0);
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -690,20 +825,15 @@ int Protocol1PacketHandler::bulkReadTx(PortHandler *port, uint8_t *param, uint16
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(param_length+7);
-  // 7: HEADER0 HEADER1 ID LEN INST 0x00 ... CHKSUM
-  //uint8_t *txpacket           = new uint8_t[param_length + 7];
+  uint8_t txpacket[6]         = {0};
+  // 6: HEADER0 HEADER1 ID LEN INST 0x00 (param and checksum are sent from their own buffers)
 
   txpacket[PKT_ID]            = BROADCAST_ID;
   txpacket[PKT_LENGTH]        = param_length + 3; // 3: INST 0x00 ... CHKSUM
   txpacket[PKT_INSTRUCTION]   = INST_BULK_READ;
   txpacket[PKT_PARAMETER0+0]  = 0x00;
 
-  for (uint16_t s = 0; s < param_length; s++)
-    txpacket[PKT_PARAMETER0+1+s] = param[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+1], param, param_length);
-
-  result = txPacket(port, txpacket);
+  result = txPacketV(port, txpacket, param, param_length);
   if (result == COMM_SUCCESS)
   {
     int wait_length = 0;
@@ -712,8 +842,6 @@ int Protocol1PacketHandler::bulkReadTx(PortHandler *port, uint8_t *param, uint16
     port->setPacketTimeout((uint16_t)wait_length);
   }
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
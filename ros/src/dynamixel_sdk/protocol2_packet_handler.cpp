@@ -188,7 +188,7 @@ unsigned short Protocol2PacketHandler::updateCRC(uint16_t crc_accum, uint8_t *da
   return crc_accum;
 }
 
-void Protocol2PacketHandler::addStuffing(uint8_t *packet)
+bool Protocol2PacketHandler::addStuffing(uint8_t *packet)
 {
   int i = 0, index = 0;
   int packet_length_in = DXL_MAKEWORD(packet[PKT_LENGTH_L], packet[PKT_LENGTH_H]);
@@ -201,6 +201,8 @@ void Protocol2PacketHandler::addStuffing(uint8_t *packet)
   index = PKT_INSTRUCTION;
   for (i = 0; i < packet_length_in - 2; i++)  // except CRC
   {
+    if (index + 4 > TXPACKET_MAX_LEN)   // 4: stuffed byte and CRC16
+      return false;
     temp[index++] = packet[i+PKT_INSTRUCTION];
     if (packet[i+PKT_INSTRUCTION] == 0xFD && packet[i+PKT_INSTRUCTION-1] == 0xFF && packet[i+PKT_INSTRUCTION-2] == 0xFF)
     {   // FF FF FD
@@ -212,17 +214,29 @@ void Protocol2PacketHandler::addStuffing(uint8_t *packet)
   temp[index++] = packet[PKT_INSTRUCTION+packet_length_in-1];
 
 
-  //////////////////////////
-  if (packet_length_in != packet_length_out)
-    packet = (uint8_t *)realloc(packet, index * sizeof(uint8_t));
-
-  ///////////////////////////
-
+  // packet has room for TXPACKET_MAX_LEN bytes
   for (uint16_t s = 0; s < index; s++)
     packet[s] = temp[s];
   //memcpy(packet, temp, index);
   packet[PKT_LENGTH_L] = DXL_LOBYTE(packet_length_out);
   packet[PKT_LENGTH_H] = DXL_HIBYTE(packet_length_out);
+  return true;
+}
+
+bool Protocol2PacketHandler::needStuffing(uint8_t *txpacket, uint16_t head_length, uint8_t *param, uint16_t param_length)
+{
+  uint8_t prev0 = txpacket[PKT_INSTRUCTION-2];
+  uint8_t prev1 = txpacket[PKT_INSTRUCTION-1];
+
+  for (uint16_t i = PKT_INSTRUCTION; i < head_length + param_length; i++)
+  {
+    uint8_t data = (i < head_length) ? txpacket[i] : param[i - head_length];
+    if (data == 0xFD && prev1 == 0xFF && prev0 == 0xFF)
+      return true;  // FF FF FD
+    prev0 = prev1;
+    prev1 = data;
+  }
+  return false;
 }
 
 void Protocol2PacketHandler::removeStuffing(uint8_t *packet)
@@ -250,25 +264,89 @@ void Protocol2PacketHandler::removeStuffing(uint8_t *packet)
 
 int Protocol2PacketHandler::txPacket(PortHandler *port, uint8_t *txpacket)
 {
-  uint16_t total_packet_length   = 0;
+  uint16_t total_packet_length   = DXL_MAKEWORD(txpacket[PKT_LENGTH_L], txpacket[PKT_LENGTH_H]) + 7;
+  // 7: HEADER0 HEADER1 HEADER2 RESERVED ID LENGTH_L LENGTH_H
   uint16_t written_packet_length = 0;
+  uint8_t  stuffed[TXPACKET_MAX_LEN];
+  uint8_t *packet                = txpacket;
 
-  if (port->is_using_)
+  // check max packet length
+  if (total_packet_length > TXPACKET_MAX_LEN)
+    return COMM_TX_ERROR;
+
+  if (port->beginTransaction() == false)
     return COMM_PORT_BUSY;
-  port->is_using_ = true;
 
   // byte stuffing for header
-  addStuffing(txpacket);
+  // (txpacket has room for the packet without stuffing only: the stuffed packet is made apart from it)
+  if (needStuffing(txpacket, total_packet_length - 2, 0, 0))   // 2: CRC16
+  {
+    for (uint16_t s = 0; s < total_packet_length; s++)
+      stuffed[s] = txpacket[s];
+    if (addStuffing(stuffed) == false)
+    {
+      port->endTransaction();
+      return COMM_TX_ERROR;
+    }
+    packet              = stuffed;
+    total_packet_length = DXL_MAKEWORD(packet[PKT_LENGTH_L], packet[PKT_LENGTH_H]) + 7;
+  }
 
-  // check max packet length
-  total_packet_length = DXL_MAKEWORD(txpacket[PKT_LENGTH_L], txpacket[PKT_LENGTH_H]) + 7;
+  // make packet header
+  packet[PKT_HEADER0]   = 0xFF;
+  packet[PKT_HEADER1]   = 0xFF;
+  packet[PKT_HEADER2]   = 0xFD;
+  packet[PKT_RESERVED]  = 0x00;
+
+  // add CRC16
+  uint16_t crc = updateCRC(0, packet, total_packet_length - 2);    // 2: CRC16
+  packet[total_packet_length - 2] = DXL_LOBYTE(crc);
+  packet[total_packet_length - 1] = DXL_HIBYTE(crc);
+
+  // tx packet
+  if (port->flushStale() == false)
+    drainPort(port);
+  written_packet_length = port->writePort(packet, total_packet_length);
+  if (total_packet_length != written_packet_length)
+  {
+    port->endTransaction();
+    return COMM_TX_FAIL;
+  }
+
+  return COMM_SUCCESS;
+}
+
+int Protocol2PacketHandler::txPacketV(PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length)
+{
+  uint16_t total_packet_length   = DXL_MAKEWORD(txpacket[PKT_LENGTH_L], txpacket[PKT_LENGTH_H]) + 7;
   // 7: HEADER0 HEADER1 HEADER2 RESERVED ID LENGTH_L LENGTH_H
+  uint16_t head_length           = total_packet_length - param_length - 2;   // 2: CRC16
+  uint16_t written_packet_length = 0;
+  uint8_t  crc_packet[2];
+
+  // check max packet length
   if (total_packet_length > TXPACKET_MAX_LEN)
-  {
-    port->is_using_ = false;
     return COMM_TX_ERROR;
+
+  // byte stuffing changes the packet: gather it and send it by txPacket()
+  if (needStuffing(txpacket, head_length, param, param_length))
+  {
+    uint8_t *packet = (uint8_t *)malloc(total_packet_length);
+
+    for (uint16_t s = 0; s < head_length; s++)
+      packet[s] = txpacket[s];
+    for (uint16_t s = 0; s < param_length; s++)
+      packet[head_length + s] = param[s];
+
+    int result = txPacket(port, packet);
+
+    free(packet);
+    return result;
   }
 
+  if (port->beginTransaction() == false)
+    return COMM_PORT_BUSY;
+
   // make packet header
   txpacket[PKT_HEADER0]   = 0xFF;
   txpacket[PKT_HEADER1]   = 0xFF;
@@ -276,63 +354,147 @@ int Protocol2PacketHandler::txPacket(PortHandler *port, uint8_t *txpacket)
   txpacket[PKT_RESERVED]  = 0x00;
 
   // add CRC16
-  uint16_t crc = updateCRC(0, txpacket, total_packet_length - 2);    // 2: CRC16
-  txpacket[total_packet_length - 2] = DXL_LOBYTE(crc);
-  txpacket[total_packet_length - 1] = DXL_HIBYTE(crc);
+  uint16_t crc = updateCRC(0, txpacket, head_length);
+  crc = updateCRC(crc, param, param_length);
+  crc_packet[0] = DXL_LOBYTE(crc);
+  crc_packet[1] = DXL_HIBYTE(crc);
+
+  // tx packet: header, caller's parameters and CRC16 without copying them together
+  // (a packet without param, as a write of length 0 or a whole packet, has no param segment)
+  PortSegment segments[3];
+  int         segment_count = 0;
+  segments[segment_count].data = txpacket;   segments[segment_count++].length = head_length;
+  if (param_length > 0)
+  {
+    segments[segment_count].data = param;    segments[segment_count++].length = param_length;
+  }
+  segments[segment_count].data = crc_packet; segments[segment_count++].length = 2;
 
-  // tx packet
-  port->clearPort();
-  written_packet_length = port->writePort(txpacket, total_packet_length);
+  if (port->flushStale() == false)
+    drainPort(port);
+  written_packet_length = port->writePortV(segments, segment_count);
   if (total_packet_length != written_packet_length)
   {
-    port->is_using_ = false;
+    port->endTransaction();
     return COMM_TX_FAIL;
   }
 
   return COMM_SUCCESS;
 }
 
+void Protocol2PacketHandler::drainPort(PortHandler *port)
+{
+  uint8_t rxpacket[RXPACKET_MAX_LEN];
+  int     rx_length   = 0;
+  int     read_length = 0;
+  int     stale_bytes = 0;
+
+  // the bytes left are parsed as they are read, until the port has no more
+  while ((read_length = port->readPort(&rxpacket[rx_length], RXPACKET_MAX_LEN - rx_length)) > 0)
+  {
+    rx_length += read_length;
+
+    int idx = 0;
+    while (rx_length - idx >= 11)   // minimum length of a status packet
+    {
+      uint8_t *packet = &rxpacket[idx];
+      int packet_length = DXL_MAKEWORD(packet[PKT_LENGTH_L], packet[PKT_LENGTH_H]) + PKT_LENGTH_H + 1;
+
+      if (packet[PKT_HEADER0] != 0xFF || packet[PKT_HEADER1] != 0xFF || packet[PKT_HEADER2] != 0xFD ||
+          packet[PKT_RESERVED] != 0x00 || packet[PKT_ID] > 0xFC || packet[PKT_INSTRUCTION] != 0x55 ||
+          packet_length > RXPACKET_MAX_LEN)
+      {
+        stale_bytes++;
+        idx++;
+        continue;
+      }
+
+      // the rest of the packet is not read yet
+      if (rx_length - idx < packet_length)
+        break;
+
+      if (updateCRC(0, packet, packet_length - 2) == DXL_MAKEWORD(packet[packet_length - 2], packet[packet_length - 1]))
+      {
+        port->addStalePacket(packet[PKT_ID]);
+        idx += packet_length;
+      }
+      else
+      {
+        stale_bytes++;
+        idx++;
+      }
+    }
+
+    memmove(&rxpacket[0], &rxpacket[idx], rx_length - idx);
+    rx_length -= idx;
+  }
+
+  // with a packet cut off by the end of the bytes received
+  port->addStaleBytes(stale_bytes + rx_length);
+}
+
+// removes bytes at the beginning of those received, in the port buffer or in rxpacket
+static void removeBytes(PortHandler *port, bool in_place, uint8_t **data, int *rx_length, int length)
+{
+  if (in_place)
+  {
+    port->consumePort(length);
+    *rx_length = port->peekPort(data);
+    return;
+  }
+
+  for (int s = 0; s < *rx_length - length; s++)
+    (*data)[s] = (*data)[length + s];
+  *rx_length -= length;
+}
+
 int Protocol2PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
 {
   int     result         = COMM_TX_FAIL;
 
-  uint16_t rx_length     = 0;
+  uint8_t *data          = 0;
+  int      rx_length     = 0;
   uint16_t wait_length   = 11; // minimum length (HEADER0 HEADER1 HEADER2 RESERVED ID LENGTH_L LENGTH_H INST ERROR CRC16_L CRC16_H)
 
+  // the packet is parsed in place in the port buffer, or read into rxpacket when the port has no buffer
+  rx_length = port->peekPort(&data);
+  bool     in_place      = (data != 0);
+  if (in_place == false)
+    data = rxpacket;
+
   while(true)
   {
-    rx_length += port->readPort(&rxpacket[rx_length], wait_length - rx_length);
+    if (in_place == false)
+      rx_length += port->readPort(&rxpacket[rx_length], wait_length - rx_length);
     if (rx_length >= wait_length)
     {
-      uint16_t idx = 0;
+      int idx = 0;
 
       // find packet header
       for (idx = 0; idx < (rx_length - 3); idx++)
       {
-        if ((rxpacket[idx] == 0xFF) && (rxpacket[idx+1] == 0xFF) && (rxpacket[idx+2] == 0xFD) && (rxpacket[idx+3] != 0xFD))
+        if ((data[idx] == 0xFF) && (data[idx+1] == 0xFF) && (data[idx+2] == 0xFD) && (data[idx+3] != 0xFD))
           break;
       }
 
       if (idx == 0)   // found at the beginning of the packet
       {
-        if (rxpacket[PKT_RESERVED] != 0x00 ||
-           rxpacket[PKT_ID] > 0xFC ||
-           DXL_MAKEWORD(rxpacket[PKT_LENGTH_L], rxpacket[PKT_LENGTH_H]) > RXPACKET_MAX_LEN ||
-           rxpacket[PKT_INSTRUCTION] != 0x55)
+        if (data[PKT_RESERVED] != 0x00 ||
+           data[PKT_ID] > 0xFC ||
+           DXL_MAKEWORD(data[PKT_LENGTH_L], data[PKT_LENGTH_H]) > RXPACKET_MAX_LEN ||
+           data[PKT_INSTRUCTION] != 0x55)
         {
           // remove the first byte in the packet
-          for (uint16_t s = 0; s < rx_length - 1; s++)
-            rxpacket[s] = rxpacket[1 + s];
-          //memcpy(&rxpacket[0], &rxpacket[idx], rx_length - idx);
-          rx_length -= 1;
+          removeBytes(port, in_place, &data, &rx_length, 1);
           continue;
         }
 
         // re-calculate the exact length of the rx packet
-        if (wait_length != DXL_MAKEWORD(rxpacket[PKT_LENGTH_L], rxpacket[PKT_LENGTH_H]) + PKT_LENGTH_H + 1)
+        if (wait_length != DXL_MAKEWORD(data[PKT_LENGTH_L], data[PKT_LENGTH_H]) + PKT_LENGTH_H + 1)
         {
-          wait_length = DXL_MAKEWORD(rxpacket[PKT_LENGTH_L], rxpacket[PKT_LENGTH_H]) + PKT_LENGTH_H + 1;
-          continue;
+          wait_length = DXL_MAKEWORD(data[PKT_LENGTH_L], data[PKT_LENGTH_H]) + PKT_LENGTH_H + 1;
+          if (in_place == false)
+            continue;
         }
 
         if (rx_length < wait_length)
@@ -352,13 +514,16 @@ int Protocol2PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
           }
           else
           {
+            port->waitPort();
+            if (in_place)
+              rx_length = port->peekPort(&data);
             continue;
           }
         }
 
         // verify CRC16
-        uint16_t crc = DXL_MAKEWORD(rxpacket[wait_length-2], rxpacket[wait_length-1]);
-        if (updateCRC(0, rxpacket, wait_length - 2) == crc)
+        uint16_t crc = DXL_MAKEWORD(data[wait_length-2], data[wait_length-1]);
+        if (updateCRC(0, data, wait_length - 2) == crc)
         {
           result = COMM_SUCCESS;
         }
@@ -371,10 +536,7 @@ int Protocol2PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
       else
       {
         // remove unnecessary packets
-        for (uint16_t s = 0; s < rx_length - idx; s++)
-          rxpacket[s] = rxpacket[idx + s];
-        //memcpy(&rxpacket[0], &rxpacket[idx], rx_length - idx);
-        rx_length -= idx;
+        removeBytes(port, in_place, &data, &rx_length, idx);
       }
     }
     else
@@ -392,9 +554,27 @@ int Protocol2PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
         }
         break;
       }
+
+      // sleep until the rest of the packet arrives
+      port->waitPort();
+      if (in_place)
+        rx_length = port->peekPort(&data);
     }
   }
-  port->is_using_ = false;
+
+  // the packet is taken out of the port buffer, and the bytes after it are left for the next one
+  if (in_place)
+  {
+    if (rx_length > wait_length)
+      rx_length = wait_length;
+    if (result == COMM_SUCCESS)
+      memcpy(rxpacket, data, rx_length);
+    port->consumePort(rx_length);
+  }
+  port->endTransaction();
+
+  if (result == COMM_RX_CORRUPT)
+    port->addStaleBytes(rx_length);
 
   if (result == COMM_SUCCESS)
     removeStuffing(rxpacket);
@@ -404,11 +584,23 @@ int Protocol2PacketHandler::rxPacket(PortHandler *port, uint8_t *rxpacket)
 
 // NOT for BulkRead / SyncRead instruction
 int Protocol2PacketHandler::txRxPacket(PortHandler *port, uint8_t *txpacket, uint8_t *rxpacket, uint8_t *error)
+{
+  return txRxPacketV(port, txpacket, 0, 0, rxpacket, error);
+}
+
+// NOT for BulkRead / SyncRead instruction
+int Protocol2PacketHandler::txRxPacketV(PortHandler *port, uint8_t *txpacket, uint8_t *param, uint16_t param_length, uint8_t *rxpacket, uint8_t *error)
 {
   int result = COMM_TX_FAIL;
 
+  // the status packets skipped for another ID are received in the same transaction
+  PortTransaction transaction(port);
+  if (transaction.isLocked() == false)
+    return COMM_PORT_BUSY;
+
   // tx packet
-  result = txPacket(port, txpacket);
+  // (txPacketV() does not write past the packet without param: txpacket may hold the header only)
+  result = txPacketV(port, txpacket, param, param_length);
   if (result != COMM_SUCCESS)
     return result;
 
@@ -420,26 +612,32 @@ int Protocol2PacketHandler::txRxPacket(PortHandler *port, uint8_t *txpacket, uin
   // (Instruction == action) == no need to wait for status packet
   if (txpacket[PKT_ID] == BROADCAST_ID || txpacket[PKT_INSTRUCTION] == INST_ACTION)
   {
-    port->is_using_ = false;
+    port->endTransaction();
     return result;
   }
 
   // set packet timeout
+  uint16_t instruction_length = DXL_MAKEWORD(txpacket[PKT_LENGTH_L], txpacket[PKT_LENGTH_H]) + 7;
   if (txpacket[PKT_INSTRUCTION] == INST_READ)
   {
-    port->setPacketTimeout((uint16_t)(DXL_MAKEWORD(txpacket[PKT_PARAMETER0+2], txpacket[PKT_PARAMETER0+3]) + 11));
+    port->setStatusTimeout(txpacket[PKT_ID], instruction_length, (uint16_t)(DXL_MAKEWORD(txpacket[PKT_PARAMETER0+2], txpacket[PKT_PARAMETER0+3]) + 11));
   }
   else
   {
-    port->setPacketTimeout((uint16_t)11);
+    port->setStatusTimeout(txpacket[PKT_ID], instruction_length, (uint16_t)11);
     // HEADER0 HEADER1 HEADER2 RESERVED ID LENGTH_L LENGTH_H INST ERROR CRC16_L CRC16_H
   }
 
   // rx packet
   do {
     result = rxPacket(port, rxpacket);
+    if (result == COMM_SUCCESS && txpacket[PKT_ID] != rxpacket[PKT_ID])
+      port->addStalePacket(rxpacket[PKT_ID]);
   } while (result == COMM_SUCCESS && txpacket[PKT_ID] != rxpacket[PKT_ID]);
 
+  if (result == COMM_SUCCESS || result == COMM_RX_TIMEOUT)
+    port->updateStatusLatency(txpacket[PKT_ID], result == COMM_SUCCESS);
+
   if (result == COMM_SUCCESS && txpacket[PKT_ID] == rxpacket[PKT_ID])
   {
     if (error != 0)
@@ -497,7 +695,7 @@ int Protocol2PacketHandler::broadcastPing(PortHandler *port, std::vector<uint8_t
   result = txPacket(port, txpacket);
   if (result != COMM_SUCCESS)
   {
-    port->is_using_ = false;
+    port->endTransaction();
     return result;
   }
 
@@ -509,9 +707,10 @@ int Protocol2PacketHandler::broadcastPing(PortHandler *port, std::vector<uint8_t
     rx_length += port->readPort(&rxpacket[rx_length], wait_length - rx_length);
     if (port->isPacketTimeout() == true)// || rx_length >= wait_length)
       break;
+    port->waitPort();
   }
 
-  port->is_using_ = false;
+  port->endTransaction();
 
   if (rx_length == 0)
     return COMM_RX_TIMEOUT;
@@ -645,6 +844,8 @@ int Protocol2PacketHandler::readRx(PortHandler *port, uint8_t id, uint16_t lengt
 
   do {
     result = rxPacket(port, rxpacket);
+    if (result == COMM_SUCCESS && rxpacket[PKT_ID] != id)
+      port->addStalePacket(rxpacket[PKT_ID]);
   } while (result == COMM_SUCCESS && rxpacket[PKT_ID] != id);
 
   if (result == COMM_SUCCESS && rxpacket[PKT_ID] == id)
@@ -770,8 +971,8 @@ int Protocol2PacketHandler::writeTxOnly(PortHandler *port, uint8_t id, uint16_t
 {
   int result                  = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length+12);
-  //uint8_t *txpacket           = new uint8_t[length+12];
+  uint8_t txpacket[10]        = {0};
+  // 10: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST ADDR_L ADDR_H (data and CRC16 are sent from their own buffers)
 
   txpacket[PKT_ID]            = id;
   txpacket[PKT_LENGTH_L]      = DXL_LOBYTE(length+5);
@@ -780,15 +981,9 @@ int Protocol2PacketHandler::writeTxOnly(PortHandler *port, uint8_t id, uint16_t
   txpacket[PKT_PARAMETER0+0]  = (uint8_t)DXL_LOBYTE(address);
   txpacket[PKT_PARAMETER0+1]  = (uint8_t)DXL_HIBYTE(address);
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+2+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+2], data, length);
+  result = txPacketV(port, txpacket, data, length);
+  port->endTransaction();
 
-  result = txPacket(port, txpacket);
-  port->is_using_ = false;
-
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -796,8 +991,7 @@ int Protocol2PacketHandler::writeTxRx(PortHandler *port, uint8_t id, uint16_t ad
 {
   int result                  = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length + 12);
-  //uint8_t *txpacket           = new uint8_t[length+12];
+  uint8_t txpacket[10]        = {0};
   uint8_t rxpacket[11]        = {0};
 
   txpacket[PKT_ID]            = id;
@@ -807,14 +1001,8 @@ int Protocol2PacketHandler::writeTxRx(PortHandler *port, uint8_t id, uint16_t ad
   txpacket[PKT_PARAMETER0+0]  = (uint8_t)DXL_LOBYTE(address);
   txpacket[PKT_PARAMETER0+1]  = (uint8_t)DXL_HIBYTE(address);
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+2+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+2], data, length);
+  result = txRxPacketV(port, txpacket, data, length, rxpacket, error);
 
-  result = txRxPacket(port, txpacket, rxpacket, error);
-
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -855,8 +1043,7 @@ int Protocol2PacketHandler::regWriteTxOnly(PortHandler *port, uint8_t id, uint16
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length + 12);
-  //uint8_t *txpacket           = new uint8_t[length+12];
+  uint8_t txpacket[10]        = {0};
 
   txpacket[PKT_ID]            = id;
   txpacket[PKT_LENGTH_L]      = DXL_LOBYTE(length+5);
@@ -865,15 +1052,9 @@ int Protocol2PacketHandler::regWriteTxOnly(PortHandler *port, uint8_t id, uint16
   txpacket[PKT_PARAMETER0+0]  = (uint8_t)DXL_LOBYTE(address);
   txpacket[PKT_PARAMETER0+1]  = (uint8_t)DXL_HIBYTE(address);
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+2+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+2], data, length);
-
-  result = txPacket(port, txpacket);
-  port->is_using_ = false;
+  result = txPacketV(port, txpacket, data, length);
+  port->endTransaction();
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -881,8 +1062,7 @@ int Protocol2PacketHandler::regWriteTxRx(PortHandler *port, uint8_t id, uint16_t
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(length + 12);
-  //uint8_t *txpacket           = new uint8_t[length+12];
+  uint8_t txpacket[10]        = {0};
   uint8_t rxpacket[11]        = {0};
 
   txpacket[PKT_ID]            = id;
@@ -892,14 +1072,8 @@ int Protocol2PacketHandler::regWriteTxRx(PortHandler *port, uint8_t id, uint16_t
   txpacket[PKT_PARAMETER0+0]  = (uint8_t)DXL_LOBYTE(address);
   txpacket[PKT_PARAMETER0+1]  = (uint8_t)DXL_HIBYTE(address);
 
-  for (uint16_t s = 0; s < length; s++)
-    txpacket[PKT_PARAMETER0+2+s] = data[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+2], data, length);
-
-  result = txRxPacket(port, txpacket, rxpacket, error);
+  result = txRxPacketV(port, txpacket, data, length, rxpacket, error);
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -907,8 +1081,8 @@ int Protocol2PacketHandler::syncReadTx(PortHandler *port, uint16_t start_address
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(param_length + 14);
-  // 14: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST START_ADDR_L START_ADDR_H DATA_LEN_L DATA_LEN_H CRC16_L CRC16_H
+  uint8_t txpacket[12]        = {0};
+  // 12: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST START_ADDR_L START_ADDR_H DATA_LEN_L DATA_LEN_H (param and CRC16 are sent from their own buffers)
 
   txpacket[PKT_ID]            = BROADCAST_ID;
   txpacket[PKT_LENGTH_L]      = DXL_LOBYTE(param_length + 7); // 7: INST START_ADDR_L START_ADDR_H DATA_LEN_L DATA_LEN_H CRC16_L CRC16_H
@@ -919,15 +1093,10 @@ int Protocol2PacketHandler::syncReadTx(PortHandler *port, uint16_t start_address
   txpacket[PKT_PARAMETER0+2]  = DXL_LOBYTE(data_length);
   txpacket[PKT_PARAMETER0+3]  = DXL_HIBYTE(data_length);
 
-  for (uint16_t s = 0; s < param_length; s++)
-    txpacket[PKT_PARAMETER0+4+s] = param[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+4], param, param_length);
-
-  result = txPacket(port, txpacket);
+  result = txPacketV(port, txpacket, param, param_length);
   if (result == COMM_SUCCESS)
     port->setPacketTimeout((uint16_t)((11 + data_length) * param_length));
 
-  free(txpacket);
   return result;
 }
 
@@ -935,9 +1104,8 @@ int Protocol2PacketHandler::syncWriteTxOnly(PortHandler *port, uint16_t start_ad
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(param_length + 14);
-  //uint8_t *txpacket           = new uint8_t[param_length + 14];
-  // 14: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST START_ADDR_L START_ADDR_H DATA_LEN_L DATA_LEN_H CRC16_L CRC16_H
+  uint8_t txpacket[12]        = {0};
+  // 12: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST START_ADDR_L START_ADDR_H DATA_LEN_L DATA_LEN_H (param and CRC16 are sent from their own buffers)
 
   txpacket[PKT_ID]            = BROADCAST_ID;
   txpacket[PKT_LENGTH_L]      = DXL_LOBYTE(param_length + 7); // 7: INST START_ADDR_L START_ADDR_H DATA_LEN_L DATA_LEN_H CRC16_L CRC16_H
@@ -948,14 +1116,8 @@ int Protocol2PacketHandler::syncWriteTxOnly(PortHandler *port, uint16_t start_ad
   txpacket[PKT_PARAMETER0+2]  = DXL_LOBYTE(data_length);
   txpacket[PKT_PARAMETER0+3]  = DXL_HIBYTE(data_length);
 
-  for (uint16_t s = 0; s < param_length; s++)
-    txpacket[PKT_PARAMETER0+4+s] = param[s];
-  //memcpy(&txpacket[PKT_PARAMETER0+4], param, param_length);
-
-  result = txRxPacket(port, txpacket, 0, 0);
+  result = txRxPacketV(port, txpacket, param, param_length, 0, 0);
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -963,20 +1125,15 @@ int Protocol2PacketHandler::bulkReadTx(PortHandler *port, uint8_t *param, uint16
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(param_length + 10);
-  //uint8_t *txpacket           = new uint8_t[param_length + 10];
-  // 10: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST CRC16_L CRC16_H
+  uint8_t txpacket[8]         = {0};
+  // 8: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST (param and CRC16 are sent from their own buffers)
 
   txpacket[PKT_ID]            = BROADCAST_ID;
   txpacket[PKT_LENGTH_L]      = DXL_LOBYTE(param_length + 3); // 3: INST CRC16_L CRC16_H
   txpacket[PKT_LENGTH_H]      = DXL_HIBYTE(param_length + 3); // 3: INST CRC16_L CRC16_H
   txpacket[PKT_INSTRUCTION]   = INST_BULK_READ;
 
-  for (uint16_t s = 0; s < param_length; s++)
-    txpacket[PKT_PARAMETER0+s] = param[s];
-  //memcpy(&txpacket[PKT_PARAMETER0], param, param_length);
-
-  result = txPacket(port, txpacket);
+  result = txPacketV(port, txpacket, param, param_length);
   if (result == COMM_SUCCESS)
   {
     int wait_length = 0;
@@ -985,8 +1142,6 @@ int Protocol2PacketHandler::bulkReadTx(PortHandler *port, uint8_t *param, uint16
     port->setPacketTimeout((uint16_t)wait_length);
   }
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
 
@@ -994,22 +1149,15 @@ int Protocol2PacketHandler::bulkWriteTxOnly(PortHandler *port, uint8_t *param, u
 {
   int result                 = COMM_TX_FAIL;
 
-  uint8_t *txpacket           = (uint8_t *)malloc(param_length + 10);
-  //uint8_t *txpacket           = new uint8_t[param_length + 10];
-  // 10: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST CRC16_L CRC16_H
+  uint8_t txpacket[8]         = {0};
+  // 8: HEADER0 HEADER1 HEADER2 RESERVED ID LEN_L LEN_H INST (param and CRC16 are sent from their own buffers)
 
   txpacket[PKT_ID]            = BROADCAST_ID;
   txpacket[PKT_LENGTH_L]      = DXL_LOBYTE(param_length + 3); // 3: INST CRC16_L CRC16_H
   txpacket[PKT_LENGTH_H]      = DXL_HIBYTE(param_length + 3); // 3: INST CRC16_L CRC16_H
   txpacket[PKT_INSTRUCTION]   = INST_BULK_WRITE;
 
-  for (uint16_t s = 0; s < param_length; s++)
-    txpacket[PKT_PARAMETER0+s] = param[s];
-  //memcpy(&txpacket[PKT_PARAMETER0], param, param_length);
-
-  result = txRxPacket(port, txpacket, 0, 0);
+  result = txRxPacketV(port, txpacket, param, param_length, 0, 0);
 
-  free(txpacket);
-  //delete[] txpacket;
   return result;
 }
@@ -0,0 +1,261 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <alloca.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "realtime_profile.h"
+
+#define DEFAULT_PRIORITY        80
+#define DEFAULT_TIMER_SLACK     1         // nsec
+#define DEFAULT_STACK_PREFAULT  262144    // bytes
+
+using namespace dynamixel;
+
+static const char *step_name[RealtimeProfile::STEP_COUNT_] =
+{
+  "scheduler",
+  "cpu affinity",
+  "memory lock",
+  "timer slack",
+  "prefault"
+};
+
+static int getStepIndex(int step)
+{
+  int index = 0;
+  while ((step >> index) != 1)
+    index++;
+  return index;
+}
+
+static int64_t getMonotonicTime()
+{
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return (int64_t)tv.tv_sec * 1000000000LL + (int64_t)tv.tv_nsec;
+}
+
+RealtimeProfile::RealtimeProfile()
+  : policy_(SCHED_FIFO),
+    priority_(DEFAULT_PRIORITY),
+    cpu_(-1),
+    lock_memory_(true),
+    timer_slack_ns_(DEFAULT_TIMER_SLACK),
+    prefault_stack_(DEFAULT_STACK_PREFAULT),
+    requested_(0),
+    applied_(0)
+{
+  memset(errors_, 0, sizeof(errors_));
+}
+
+void RealtimeProfile::setScheduler(int policy, int priority)
+{
+  policy_   = policy;
+  priority_ = priority;
+}
+
+void RealtimeProfile::setCpu(int cpu)
+{
+  cpu_ = cpu;
+}
+
+void RealtimeProfile::setMemoryLock(bool enable)
+{
+  lock_memory_ = enable;
+}
+
+void RealtimeProfile::setTimerSlack(long nsec)
+{
+  timer_slack_ns_ = nsec;
+}
+
+void RealtimeProfile::setStackPrefault(int length)
+{
+  prefault_stack_ = length;
+}
+
+void RealtimeProfile::setResult(Step step, int error)
+{
+  requested_ |= step;
+  errors_[getStepIndex(step)] = error;
+  if (error == 0)
+    applied_ |= step;
+}
+
+bool RealtimeProfile::apply()
+{
+  requested_  = 0;
+  applied_    = 0;
+  memset(errors_, 0, sizeof(errors_));
+
+  if (policy_ >= 0)
+  {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = (policy_ == SCHED_OTHER) ? 0 : priority_;
+    // EPERM without CAP_SYS_NICE or RLIMIT_RTPRIO; the thread keeps its policy
+    setResult(SCHEDULER, pthread_setschedparam(pthread_self(), policy_, &param));
+  }
+
+  if (cpu_ >= 0)
+  {
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_, &cpu_set);
+    setResult(AFFINITY, pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set));
+#else
+    setResult(AFFINITY, ENOTSUP);
+#endif
+  }
+
+  if (lock_memory_)
+  {
+    // ENOMEM or EPERM when RLIMIT_MEMLOCK is too small for the process
+    setResult(MEMORY_LOCK, (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) ? 0 : errno);
+#if defined(__GLIBC__)
+    if (applied_ & MEMORY_LOCK)
+    {
+      // the memory freed is kept for the next allocation, instead of being returned and faulted in again
+      mallopt(M_TRIM_THRESHOLD, -1);
+      mallopt(M_MMAP_MAX, 0);
+    }
+#endif
+  }
+
+  if (timer_slack_ns_ > 0)
+  {
+#if defined(__linux__)
+    setResult(TIMER_SLACK, (prctl(PR_SET_TIMERSLACK, (unsigned long)timer_slack_ns_, 0, 0, 0) == 0) ? 0 : errno);
+#else
+    setResult(TIMER_SLACK, ENOTSUP);
+#endif
+  }
+
+  if (prefault_stack_ > 0)
+  {
+    prefault(alloca(prefault_stack_), prefault_stack_);
+    setResult(PREFAULT, 0);
+  }
+
+  return (applied_ == requested_);
+}
+
+int RealtimeProfile::getError(Step step)
+{
+  return errors_[getStepIndex(step)];
+}
+
+void RealtimeProfile::getReport(char *report, int length)
+{
+  int index = 0;
+
+  if (length <= 0)
+    return;
+  report[0] = 0;
+
+  for (int i = 0; i < STEP_COUNT_ && index < length; i++)
+  {
+    int n;
+    if ((requested_ & (1 << i)) == 0)
+      n = snprintf(&report[index], length - index, "%-13s not requested\n", step_name[i]);
+    else if (applied_ & (1 << i))
+      n = snprintf(&report[index], length - index, "%-13s applied\n", step_name[i]);
+    else
+      n = snprintf(&report[index], length - index, "%-13s not applied: %s\n", step_name[i], strerror(errors_[i]));
+    if (n < 0)
+      break;
+    index += n;
+  }
+}
+
+void RealtimeProfile::prefault(void *buffer, int length)
+{
+  volatile uint8_t *bytes = (volatile uint8_t *)buffer;
+  long page = sysconf(_SC_PAGESIZE);
+
+  if (page <= 0)
+    page = 4096;
+  for (int i = 0; i < length; i += (int)page)
+    bytes[i] = bytes[i];
+  if (length > 0)
+    bytes[length - 1] = bytes[length - 1];
+}
+
+JitterStats RealtimeProfile::measureJitter(int64_t period_ns, int count)
+{
+  JitterStats stats;
+  memset(&stats, 0, sizeof(stats));
+  stats.period_ns = period_ns;
+  if (count <= 0 || period_ns <= 0)
+    return stats;
+
+  int64_t *latency = (int64_t *)malloc(count * sizeof(int64_t));
+  int64_t  next    = getMonotonicTime() + period_ns;
+  int64_t  sum     = 0;
+
+  for (int i = 0; i < count; i++)
+  {
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec  = (time_t)(next / 1000000000LL);
+    ts.tv_nsec = (long)(next % 1000000000LL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) { }
+#else
+    int64_t remaining = next - getMonotonicTime();
+    if (remaining > 0)
+    {
+      struct timespec ts;
+      ts.tv_sec  = (time_t)(remaining / 1000000000LL);
+      ts.tv_nsec = (long)(remaining % 1000000000LL);
+      nanosleep(&ts, NULL);
+    }
+#endif
+    latency[i] = getMonotonicTime() - next;
+    sum += latency[i];
+    next += period_ns;
+  }
+
+  std::sort(latency, latency + count);
+  stats.count   = count;
+  stats.min_ns  = latency[0];
+  stats.mean_ns = sum / count;
+  stats.p99_ns  = latency[(count * 99) / 100];
+  stats.max_ns  = latency[count - 1];
+
+  free(latency);
+  return stats;
+}
+
+#endif
@@ -0,0 +1,1053 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <asm/termbits.h>
+#endif
+
+#include "simulated_bus.h"
+#include "packet_handler.h"
+
+#define SIM_PACKET_MAX_LEN      (4*1024)
+#define SIM_RESPONSE_MAX_LEN    (16*1024)   // status bytes kept by the pseudo-terminal thread
+
+// Control table addresses of Protocol 1.0 (AX / RX / MX series)
+#define P1_ADDR_MODEL_NUMBER        0
+#define P1_ADDR_FIRMWARE_VERSION    2
+#define P1_ADDR_ID                  3
+#define P1_ADDR_BAUD_RATE           4
+#define P1_ADDR_RETURN_DELAY_TIME   5
+#define P1_ADDR_STATUS_RETURN_LEVEL 16
+
+// Control table addresses of Protocol 2.0 (X series)
+#define P2_ADDR_MODEL_NUMBER        0
+#define P2_ADDR_FIRMWARE_VERSION    6
+#define P2_ADDR_ID                  7
+#define P2_ADDR_BAUD_RATE           8
+#define P2_ADDR_RETURN_DELAY_TIME   9
+#define P2_ADDR_STATUS_RETURN_LEVEL 68
+
+// Protocol 1.0 error bits
+#define P1_ERRBIT_RANGE         8
+#define P1_ERRBIT_CHECKSUM      16
+#define P1_ERRBIT_INSTRUCTION   64
+
+// Protocol 2.0 error numbers
+#define P2_ERRNUM_INSTRUCTION   2
+#define P2_ERRNUM_CRC           3
+#define P2_ERRNUM_DATA_LENGTH   5
+#define P2_ERRNUM_ACCESS        7
+
+#define INST_CLEAR              16      // 0x10
+
+#define P2_PKT_INSTRUCTION      7
+
+using namespace dynamixel;
+
+static const int p2_baudrate_table[] = { 9600, 57600, 115200, 1000000, 2000000, 3000000, 4000000, 4500000 };
+
+static std::vector<SimulatedBus *> bus_list;
+static pthread_mutex_t bus_list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool isBaudRateMatched(int baudrate, int bus_baudrate)
+{
+  // UART tolerates about 3% of baudrate error
+  int64_t diff = (int64_t)baudrate - (int64_t)bus_baudrate;
+  if (diff < 0)
+    diff = -diff;
+  return (diff * 100 <= (int64_t)bus_baudrate * 3);
+}
+
+static uint16_t updateCRC(uint16_t crc_accum, uint8_t *data_blk_ptr, int data_blk_size)
+{
+  // CRC-16 (polynomial 0x8005) of Protocol 2.0
+  for (int j = 0; j < data_blk_size; j++)
+  {
+    crc_accum ^= (uint16_t)data_blk_ptr[j] << 8;
+    for (int b = 0; b < 8; b++)
+      crc_accum = (crc_accum & 0x8000) ? (uint16_t)((crc_accum << 1) ^ 0x8005) : (uint16_t)(crc_accum << 1);
+  }
+  return crc_accum;
+}
+
+SimulatedDevice::SimulatedDevice(uint8_t id, float protocol_version, uint16_t model_number, int baudrate, uint16_t control_table_size)
+  : protocol_version_(protocol_version),
+    baudrate_(baudrate),
+    default_baudrate_(baudrate),
+    control_table_size_(control_table_size < 128 ? 128 : control_table_size),
+    reg_pending_(false),
+    reg_address_(0),
+    reg_length_(0)
+{
+  control_table_  = (uint8_t *)calloc(control_table_size_, 1);
+  default_table_  = (uint8_t *)calloc(control_table_size_, 1);
+  reg_data_       = (uint8_t *)calloc(control_table_size_, 1);
+
+  control_table_[P1_ADDR_MODEL_NUMBER]   = DXL_LOBYTE(model_number);
+  control_table_[P1_ADDR_MODEL_NUMBER+1] = DXL_HIBYTE(model_number);
+  setID(id);
+  setBaudRate(baudrate);
+  setReturnDelayTime(250);
+  setStatusReturnLevel(2);
+
+  memcpy(default_table_, control_table_, control_table_size_);
+}
+
+SimulatedDevice::~SimulatedDevice()
+{
+  free(control_table_);
+  free(default_table_);
+  free(reg_data_);
+}
+
+uint16_t SimulatedDevice::getAddressID()
+{
+  return (protocol_version_ == 1.0) ? P1_ADDR_ID : P2_ADDR_ID;
+}
+
+uint16_t SimulatedDevice::getAddressBaudRate()
+{
+  return (protocol_version_ == 1.0) ? P1_ADDR_BAUD_RATE : P2_ADDR_BAUD_RATE;
+}
+
+uint16_t SimulatedDevice::getAddressReturnDelayTime()
+{
+  return (protocol_version_ == 1.0) ? P1_ADDR_RETURN_DELAY_TIME : P2_ADDR_RETURN_DELAY_TIME;
+}
+
+uint16_t SimulatedDevice::getAddressStatusReturnLevel()
+{
+  return (protocol_version_ == 1.0) ? P1_ADDR_STATUS_RETURN_LEVEL : P2_ADDR_STATUS_RETURN_LEVEL;
+}
+
+uint8_t SimulatedDevice::getID()
+{
+  return control_table_[getAddressID()];
+}
+
+void SimulatedDevice::setID(uint8_t id)
+{
+  control_table_[getAddressID()] = id;
+}
+
+void SimulatedDevice::setBaudRate(int baudrate)
+{
+  baudrate_ = baudrate;
+
+  if (protocol_version_ == 1.0)
+  {
+    // baudrate = 2000000 / (value + 1)
+    int value = (2000000 + baudrate / 2) / baudrate - 1;
+    if (value >= 0 && value <= 254)
+      control_table_[P1_ADDR_BAUD_RATE] = (uint8_t)value;
+  }
+  else
+  {
+    for (uint8_t value = 0; value < sizeof(p2_baudrate_table) / sizeof(p2_baudrate_table[0]); value++)
+    {
+      if (p2_baudrate_table[value] == baudrate)
+        control_table_[P2_ADDR_BAUD_RATE] = value;
+    }
+  }
+}
+
+int64_t SimulatedDevice::getReturnDelayNs()
+{
+  return (int64_t)control_table_[getAddressReturnDelayTime()] * 2000;
+}
+
+void SimulatedDevice::setReturnDelayTime(uint8_t return_delay_time)
+{
+  control_table_[getAddressReturnDelayTime()] = return_delay_time;
+}
+
+uint8_t SimulatedDevice::getStatusReturnLevel()
+{
+  return control_table_[getAddressStatusReturnLevel()];
+}
+
+void SimulatedDevice::setStatusReturnLevel(uint8_t status_return_level)
+{
+  control_table_[getAddressStatusReturnLevel()] = status_return_level;
+}
+
+bool SimulatedDevice::readControlTable(uint16_t address, uint16_t length, uint8_t *data)
+{
+  if ((int)address + (int)length > control_table_size_)
+    return false;
+
+  memcpy(data, &control_table_[address], length);
+  return true;
+}
+
+bool SimulatedDevice::writeControlTable(uint16_t address, uint16_t length, uint8_t *data)
+{
+  if ((int)address + (int)length > control_table_size_)
+    return false;
+
+  memcpy(&control_table_[address], data, length);
+
+  uint16_t addr_baudrate = getAddressBaudRate();
+  if (address <= addr_baudrate && addr_baudrate < address + length)
+  {
+    uint8_t value = control_table_[addr_baudrate];
+    if (protocol_version_ == 1.0)
+    {
+      if (value == 250)
+        baudrate_ = 2250000;
+      else if (value == 251)
+        baudrate_ = 2500000;
+      else if (value == 252)
+        baudrate_ = 3000000;
+      else
+        baudrate_ = 2000000 / (value + 1);
+    }
+    else if (value < sizeof(p2_baudrate_table) / sizeof(p2_baudrate_table[0]))
+    {
+      baudrate_ = p2_baudrate_table[value];
+    }
+  }
+  return true;
+}
+
+bool SimulatedDevice::regWriteControlTable(uint16_t address, uint16_t length, uint8_t *data)
+{
+  if ((int)address + (int)length > control_table_size_)
+    return false;
+
+  memcpy(reg_data_, data, length);
+  reg_address_  = address;
+  reg_length_   = length;
+  reg_pending_  = true;
+  return true;
+}
+
+bool SimulatedDevice::action()
+{
+  if (reg_pending_ == false)
+    return false;
+
+  reg_pending_ = false;
+  return writeControlTable(reg_address_, reg_length_, reg_data_);
+}
+
+void SimulatedDevice::factoryReset(bool keep_id, bool keep_baudrate)
+{
+  uint8_t id        = getID();
+  uint8_t baud_data = control_table_[getAddressBaudRate()];
+
+  memcpy(control_table_, default_table_, control_table_size_);
+  reg_pending_ = false;
+
+  if (keep_id)
+    setID(id);
+  if (keep_baudrate)
+    control_table_[getAddressBaudRate()] = baud_data;
+  else
+    baudrate_ = default_baudrate_;
+}
+
+SimulatedBus *SimulatedBus::getBus(const char *name)
+{
+  SimulatedBus *bus = 0;
+
+  pthread_mutex_lock(&bus_list_lock);
+  for (unsigned int i = 0; i < bus_list.size(); i++)
+  {
+    if (strcmp(bus_list[i]->getName(), name) == 0)
+    {
+      bus = bus_list[i];
+      break;
+    }
+  }
+  if (bus == 0)
+  {
+    bus = new SimulatedBus(name);
+    bus_list.push_back(bus);
+  }
+  pthread_mutex_unlock(&bus_list_lock);
+  return bus;
+}
+
+void SimulatedBus::removeBus(const char *name)
+{
+  SimulatedBus *bus = 0;
+
+  pthread_mutex_lock(&bus_list_lock);
+  for (unsigned int i = 0; i < bus_list.size(); i++)
+  {
+    if (strcmp(bus_list[i]->getName(), name) == 0)
+    {
+      bus = bus_list[i];
+      bus_list.erase(bus_list.begin() + i);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&bus_list_lock);
+
+  // the server thread of the bus is joined out of the lock
+  delete bus;
+}
+
+SimulatedBus::SimulatedBus(const char *name)
+  : transport_delay_ns_(0),
+    bus_free_ns_(0),
+    response_(0),
+    response_arrival_ns_(0),
+    response_max_(0),
+    response_length_(0),
+    response_end_ns_(0),
+    byte_ns_(0)
+#if defined(__linux__)
+    , server_fd_(-1),
+    server_baudrate_(0),
+    pty_slave_fd_(-1),
+    server_running_(false)
+#endif
+{
+  strncpy(name_, name, sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = 0;
+  pthread_mutex_init(&lock_, NULL);
+}
+
+SimulatedBus::~SimulatedBus()
+{
+#if defined(__linux__)
+  closeServer();
+#endif
+  clearDevices();
+  pthread_mutex_destroy(&lock_);
+}
+
+SimulatedDevice *SimulatedBus::addDevice(SimulatedDevice *device)
+{
+  pthread_mutex_lock(&lock_);
+  devices_.push_back(device);
+  pthread_mutex_unlock(&lock_);
+  return device;
+}
+
+SimulatedDevice *SimulatedBus::addDevice(uint8_t id, float protocol_version, uint16_t model_number, int baudrate)
+{
+  return addDevice(new SimulatedDevice(id, protocol_version, model_number, baudrate));
+}
+
+SimulatedDevice *SimulatedBus::getDevice(uint8_t id, float protocol_version)
+{
+  SimulatedDevice *device = 0;
+
+  pthread_mutex_lock(&lock_);
+  for (unsigned int i = 0; i < devices_.size(); i++)
+  {
+    if (devices_[i]->getID() == id && devices_[i]->getProtocolVersion() == protocol_version)
+    {
+      device = devices_[i];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&lock_);
+  return device;
+}
+
+void SimulatedBus::clearDevices()
+{
+  pthread_mutex_lock(&lock_);
+  for (unsigned int i = 0; i < devices_.size(); i++)
+    delete devices_[i];
+  devices_.clear();
+  pthread_mutex_unlock(&lock_);
+}
+
+SimulatedDevice *SimulatedBus::findDevice(uint8_t id, float protocol_version, int baudrate)
+{
+  for (unsigned int i = 0; i < devices_.size(); i++)
+  {
+    SimulatedDevice *device = devices_[i];
+    if (device->getID() == id && device->getProtocolVersion() == protocol_version && isBaudRateMatched(device->getBaudRate(), baudrate))
+      return device;
+  }
+  return 0;
+}
+
+int SimulatedBus::transfer(uint8_t *packet, int length, int baudrate, int64_t sent_ns, uint8_t *response, int64_t *arrival_ns, int response_max, int *taken_length)
+{
+  uint8_t  rxpacket[SIM_PACKET_MAX_LEN];
+  int      index    = 0;
+
+  // one transfer at a time holds the bus, as the half-duplex bus does
+  pthread_mutex_lock(&lock_);
+  int64_t  start_ns = (sent_ns > bus_free_ns_) ? sent_ns : bus_free_ns_;
+
+  response_             = response;
+  response_arrival_ns_  = arrival_ns;
+  response_max_         = response_max;
+  response_length_      = 0;
+  response_end_ns_      = start_ns;
+  byte_ns_              = (baudrate > 0) ? 10000000000LL / baudrate : 0;  // 10 bits a byte
+
+  while (index + 6 <= length)
+  {
+    int packet_length = 0;
+    uint8_t *p = &packet[index];
+
+    if (p[0] == 0xFF && p[1] == 0xFF && p[2] == 0xFD && p[3] == 0x00 && index + 7 <= length)
+      packet_length = 7 + DXL_MAKEWORD(p[5], p[6]);   // Protocol 2.0
+    else if (p[0] == 0xFF && p[1] == 0xFF && p[2] != 0xFF && p[2] != 0xFD)
+      packet_length = 4 + p[3];                       // Protocol 1.0
+    else
+    {
+      index++;
+      continue;
+    }
+
+    if (packet_length > SIM_PACKET_MAX_LEN)
+    {
+      index++;
+      continue;
+    }
+    if (index + packet_length > length)
+      break;
+
+    // the devices answer after the whole instruction packet is on the bus
+    int64_t end_ns = start_ns + (int64_t)(index + packet_length) * byte_ns_;
+    if (end_ns > response_end_ns_)
+      response_end_ns_ = end_ns;
+
+    memcpy(rxpacket, p, packet_length);
+    if (p[2] == 0xFD)
+      handlePacket2(rxpacket, baudrate);
+    else
+      handlePacket1(rxpacket, baudrate);
+
+    index += packet_length;
+  }
+
+  int64_t end_ns = start_ns + (int64_t)length * byte_ns_;
+  bus_free_ns_ = (end_ns > response_end_ns_) ? end_ns : response_end_ns_;
+
+  response_ = 0;
+  response_arrival_ns_ = 0;
+  int response_length = response_length_;
+  pthread_mutex_unlock(&lock_);
+
+  if (taken_length != 0)
+    *taken_length = index;
+  return response_length;
+}
+
+void SimulatedBus::appendResponse(uint8_t *packet, int length, int64_t start_ns)
+{
+  for (int i = 0; i < length && response_length_ < response_max_; i++)
+  {
+    response_[response_length_] = packet[i];
+    response_arrival_ns_[response_length_] = start_ns + (int64_t)(i + 1) * byte_ns_ + transport_delay_ns_;
+    response_length_++;
+  }
+  response_end_ns_ = start_ns + (int64_t)length * byte_ns_;
+}
+
+void SimulatedBus::sendStatus1(SimulatedDevice *device, uint8_t error, uint8_t *param, uint16_t param_length)
+{
+  uint8_t  status[SIM_PACKET_MAX_LEN];
+  uint8_t  checksum = 0;
+
+  if (param_length > 250)
+    return;
+
+  status[0] = 0xFF;
+  status[1] = 0xFF;
+  status[2] = device->getID();
+  status[3] = (uint8_t)(param_length + 2);
+  status[4] = error;
+  if (param_length > 0)
+    memcpy(&status[5], param, param_length);
+
+  for (int i = 2; i < param_length + 5; i++)
+    checksum += status[i];
+  status[param_length + 5] = ~checksum;
+
+  appendResponse(status, param_length + 6, response_end_ns_ + device->getReturnDelayNs());
+}
+
+void SimulatedBus::sendStatus2(SimulatedDevice *device, uint8_t error, uint8_t *param, uint16_t param_length)
+{
+  uint8_t  status[SIM_PACKET_MAX_LEN];
+  int      index = 0;
+
+  if (param_length > SIM_PACKET_MAX_LEN * 2 / 3 - 16)
+    return;
+
+  status[index++] = 0xFF;
+  status[index++] = 0xFF;
+  status[index++] = 0xFD;
+  status[index++] = 0x00;
+  status[index++] = device->getID();
+  index += 2;   // length
+  status[index++] = INST_STATUS;
+  status[index++] = error;
+
+  for (int i = 0; i < param_length; i++)
+  {
+    status[index++] = param[i];
+    if (status[index-1] == 0xFD && status[index-2] == 0xFF && status[index-3] == 0xFF)
+      status[index++] = 0xFD;   // byte stuffing
+  }
+
+  status[5] = DXL_LOBYTE(index - 7 + 2);
+  status[6] = DXL_HIBYTE(index - 7 + 2);
+
+  uint16_t crc = updateCRC(0, status, index);
+  status[index++] = DXL_LOBYTE(crc);
+  status[index++] = DXL_HIBYTE(crc);
+
+  appendResponse(status, index, response_end_ns_ + device->getReturnDelayNs());
+}
+
+void SimulatedBus::sendReadStatus(SimulatedDevice *device, uint16_t address, uint16_t length)
+{
+  if (device->getStatusReturnLevel() < 1)
+    return;
+
+  uint8_t *data = (uint8_t *)malloc(length > 0 ? length : 1);
+
+  if (device->readControlTable(address, length, data) == false)
+  {
+    if (device->getProtocolVersion() == 1.0)
+      sendStatus1(device, P1_ERRBIT_RANGE, 0, 0);
+    else
+      sendStatus2(device, P2_ERRNUM_ACCESS, 0, 0);
+  }
+  else
+  {
+    if (device->getProtocolVersion() == 1.0)
+      sendStatus1(device, 0, data, length);
+    else
+      sendStatus2(device, 0, data, length);
+  }
+
+  free(data);
+}
+
+void SimulatedBus::handlePacket1(uint8_t *packet, int baudrate)
+{
+  uint8_t   id            = packet[2];
+  uint8_t   instruction   = packet[4];
+  uint8_t  *param         = &packet[5];
+  int       param_length  = packet[3] - 2;
+  uint8_t   checksum      = 0;
+
+  if (param_length < 0)
+    return;
+
+  for (int i = 2; i < param_length + 5; i++)
+    checksum += packet[i];
+  checksum = ~checksum;
+
+  SimulatedDevice *device = (id == BROADCAST_ID) ? 0 : findDevice(id, 1.0, baudrate);
+  bool reply = (device != 0 && device->getStatusReturnLevel() >= 2);
+
+  if (checksum != packet[param_length + 5])
+  {
+    if (reply)
+      sendStatus1(device, P1_ERRBIT_CHECKSUM, 0, 0);
+    return;
+  }
+
+  switch (instruction)
+  {
+    case INST_PING:
+      if (device != 0)
+        sendStatus1(device, 0, 0, 0);
+      break;
+
+    case INST_READ:
+      if (device != 0 && param_length == 2)
+        sendReadStatus(device, param[0], param[1]);
+      break;
+
+    case INST_WRITE:
+    case INST_REG_WRITE:
+      if (param_length < 1)
+        break;
+      for (unsigned int i = 0; i < devices_.size(); i++)
+      {
+        SimulatedDevice *target = devices_[i];
+        if (target->getProtocolVersion() != 1.0 || isBaudRateMatched(target->getBaudRate(), baudrate) == false)
+          continue;
+        if (id != BROADCAST_ID && target != device)
+          continue;
+
+        // the status packet goes out with the ID and baudrate before the write
+        bool result = ((int)param[0] + param_length - 1 <= target->getControlTableSize());
+        if (target == device && reply)
+          sendStatus1(device, result ? 0 : P1_ERRBIT_RANGE, 0, 0);
+        if (instruction == INST_WRITE)
+          target->writeControlTable(param[0], param_length - 1, &param[1]);
+        else
+          target->regWriteControlTable(param[0], param_length - 1, &param[1]);
+      }
+      break;
+
+    case INST_ACTION:
+      for (unsigned int i = 0; i < devices_.size(); i++)
+      {
+        SimulatedDevice *target = devices_[i];
+        if (target->getProtocolVersion() != 1.0 || isBaudRateMatched(target->getBaudRate(), baudrate) == false)
+          continue;
+        if (id == BROADCAST_ID || target == device)
+          target->action();
+      }
+      if (reply)
+        sendStatus1(device, 0, 0, 0);
+      break;
+
+    case INST_FACTORY_RESET:
+      if (device != 0)
+      {
+        if (reply)
+          sendStatus1(device, 0, 0, 0);
+        device->factoryReset(false, false);
+      }
+      break;
+
+    case INST_SYNC_WRITE:
+    {
+      if (id != BROADCAST_ID || param_length < 2)
+        break;
+      uint8_t address     = param[0];
+      uint8_t data_length = param[1];
+      for (int i = 2; i + 1 + data_length <= param_length; i += 1 + data_length)
+      {
+        SimulatedDevice *target = findDevice(param[i], 1.0, baudrate);
+        if (target != 0)
+          target->writeControlTable(address, data_length, &param[i + 1]);
+      }
+      break;
+    }
+
+    case INST_BULK_READ:
+      if (id != BROADCAST_ID)
+        break;
+      // 0x00, then LEN, ID, ADDR of each device
+      for (int i = 1; i + 3 <= param_length; i += 3)
+      {
+        SimulatedDevice *target = findDevice(param[i + 1], 1.0, baudrate);
+        if (target != 0)
+          sendReadStatus(target, param[i + 2], param[i]);
+      }
+      break;
+
+    default:
+      if (reply)
+        sendStatus1(device, P1_ERRBIT_INSTRUCTION, 0, 0);
+      break;
+  }
+}
+
+void SimulatedBus::handlePacket2(uint8_t *packet, int baudrate)
+{
+  uint8_t   id            = packet[4];
+  int       packet_length = DXL_MAKEWORD(packet[5], packet[6]);
+  uint8_t   instruction   = packet[7];
+  uint8_t  *param         = &packet[8];
+
+  if (packet_length < 3)
+    return;
+
+  SimulatedDevice *device = (id == BROADCAST_ID) ? 0 : findDevice(id, 2.0, baudrate);
+  bool reply = (device != 0 && device->getStatusReturnLevel() >= 2);
+
+  uint16_t crc = DXL_MAKEWORD(packet[packet_length + 5], packet[packet_length + 6]);
+  if (updateCRC(0, packet, packet_length + 5) != crc)
+  {
+    if (reply)
+      sendStatus2(device, P2_ERRNUM_CRC, 0, 0);
+    return;
+  }
+
+  // remove byte stuffing (FF FF FD FD -> FF FF FD) after the instruction
+  int index = P2_PKT_INSTRUCTION;
+  for (int i = P2_PKT_INSTRUCTION; i < packet_length + 5; i++)
+  {
+    packet[index++] = packet[i];
+    if (packet[index-1] == 0xFD && packet[index-2] == 0xFF && packet[index-3] == 0xFF && i + 1 < packet_length + 5 && packet[i+1] == 0xFD)
+      i++;
+  }
+  int param_length = index - P2_PKT_INSTRUCTION - 1;
+
+  switch (instruction)
+  {
+    case INST_PING:
+    {
+      uint8_t ping_param[3];
+      if (device != 0)
+      {
+        device->readControlTable(P2_ADDR_MODEL_NUMBER, 2, &ping_param[0]);
+        device->readControlTable(P2_ADDR_FIRMWARE_VERSION, 1, &ping_param[2]);
+        sendStatus2(device, 0, ping_param, 3);
+      }
+      else if (id == BROADCAST_ID)
+      {
+        // all devices answer in order of ID
+        for (int target_id = 0; target_id <= MAX_ID; target_id++)
+        {
+          SimulatedDevice *target = findDevice(target_id, 2.0, baudrate);
+          if (target == 0)
+            continue;
+          target->readControlTable(P2_ADDR_MODEL_NUMBER, 2, &ping_param[0]);
+          target->readControlTable(P2_ADDR_FIRMWARE_VERSION, 1, &ping_param[2]);
+          sendStatus2(target, 0, ping_param, 3);
+        }
+      }
+      break;
+    }
+
+    case INST_READ:
+      if (device == 0)
+        break;
+      if (param_length != 4)
+        sendStatus2(device, P2_ERRNUM_DATA_LENGTH, 0, 0);
+      else
+        sendReadStatus(device, DXL_MAKEWORD(param[0], param[1]), DXL_MAKEWORD(param[2], param[3]));
+      break;
+
+    case INST_WRITE:
+    case INST_REG_WRITE:
+    {
+      if (param_length < 2)
+        break;
+      uint16_t address = DXL_MAKEWORD(param[0], param[1]);
+      for (unsigned int i = 0; i < devices_.size(); i++)
+      {
+        SimulatedDevice *target = devices_[i];
+        if (target->getProtocolVersion() != 2.0 || isBaudRateMatched(target->getBaudRate(), baudrate) == false)
+          continue;
+        if (id != BROADCAST_ID && target != device)
+          continue;
+
+        // the status packet goes out with the ID and baudrate before the write
+        bool result = ((int)address + param_length - 2 <= target->getControlTableSize());
+        if (target == device && reply)
+          sendStatus2(device, result ? 0 : P2_ERRNUM_ACCESS, 0, 0);
+        if (instruction == INST_WRITE)
+          target->writeControlTable(address, param_length - 2, &param[2]);
+        else
+          target->regWriteControlTable(address, param_length - 2, &param[2]);
+      }
+      break;
+    }
+
+    case INST_ACTION:
+      for (unsigned int i = 0; i < devices_.size(); i++)
+      {
+        SimulatedDevice *target = devices_[i];
+        if (target->getProtocolVersion() != 2.0 || isBaudRateMatched(target->getBaudRate(), baudrate) == false)
+          continue;
+        if (id == BROADCAST_ID || target == device)
+          target->action();
+      }
+      if (reply)
+        sendStatus2(device, 0, 0, 0);
+      break;
+
+    case INST_FACTORY_RESET:
+      if (device != 0)
+      {
+        uint8_t option = (param_length > 0) ? param[0] : 0xFF;
+        if (reply)
+          sendStatus2(device, 0, 0, 0);
+        device->factoryReset(option == 0x01 || option == 0x02, option == 0x02);
+      }
+      break;
+
+    case INST_REBOOT:
+    case INST_CLEAR:
+      if (reply)
+        sendStatus2(device, 0, 0, 0);
+      break;
+
+    case INST_SYNC_READ:
+      if (id != BROADCAST_ID || param_length < 4)
+        break;
+      // the devices answer in order of the ID list
+      for (int i = 4; i < param_length; i++)
+      {
+        SimulatedDevice *target = findDevice(param[i], 2.0, baudrate);
+        if (target != 0)
+          sendReadStatus(target, DXL_MAKEWORD(param[0], param[1]), DXL_MAKEWORD(param[2], param[3]));
+      }
+      break;
+
+    case INST_SYNC_WRITE:
+    {
+      if (id != BROADCAST_ID || param_length < 4)
+        break;
+      uint16_t address     = DXL_MAKEWORD(param[0], param[1]);
+      uint16_t data_length = DXL_MAKEWORD(param[2], param[3]);
+      for (int i = 4; i + 1 + data_length <= param_length; i += 1 + data_length)
+      {
+        SimulatedDevice *target = findDevice(param[i], 2.0, baudrate);
+        if (target != 0)
+          target->writeControlTable(address, data_length, &param[i + 1]);
+      }
+      break;
+    }
+
+    case INST_BULK_READ:
+      if (id != BROADCAST_ID)
+        break;
+      // ID, ADDR_L, ADDR_H, LEN_L, LEN_H of each device
+      for (int i = 0; i + 5 <= param_length; i += 5)
+      {
+        SimulatedDevice *target = findDevice(param[i], 2.0, baudrate);
+        if (target != 0)
+          sendReadStatus(target, DXL_MAKEWORD(param[i + 1], param[i + 2]), DXL_MAKEWORD(param[i + 3], param[i + 4]));
+      }
+      break;
+
+    case INST_BULK_WRITE:
+      if (id != BROADCAST_ID)
+        break;
+      // ID, ADDR_L, ADDR_H, LEN_L, LEN_H, DATA of each device
+      for (int i = 0; i + 5 <= param_length; )
+      {
+        uint16_t data_length = DXL_MAKEWORD(param[i + 3], param[i + 4]);
+        if (i + 5 + data_length > param_length)
+          break;
+        SimulatedDevice *target = findDevice(param[i], 2.0, baudrate);
+        if (target != 0)
+          target->writeControlTable(DXL_MAKEWORD(param[i + 1], param[i + 2]), data_length, &param[i + 5]);
+        i += 5 + data_length;
+      }
+      break;
+
+    default:
+      if (reply)
+        sendStatus2(device, P2_ERRNUM_INSTRUCTION, 0, 0);
+      break;
+  }
+}
+
+#if defined(__linux__)
+
+bool SimulatedBus::openPty(char *slave_name, int length)
+{
+  closeServer();
+
+  server_fd_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (server_fd_ < 0)
+    return false;
+
+  if (grantpt(server_fd_) != 0 || unlockpt(server_fd_) != 0 || ptsname_r(server_fd_, slave_name, length) != 0)
+  {
+    closeServer();
+    return false;
+  }
+
+  // keep the slave opened, or the master hangs up while the port is closed
+  pty_slave_fd_ = open(slave_name, O_RDWR | O_NOCTTY);
+  server_baudrate_ = 0;
+
+  return startServer();
+}
+
+int SimulatedBus::listenTcp(int port, int baudrate)
+{
+  struct sockaddr_in addr;
+  socklen_t addr_length = sizeof(addr);
+  int       reuse = 1;
+
+  closeServer();
+
+  server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (server_fd_ < 0)
+    return 0;
+  setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family       = AF_INET;
+  addr.sin_addr.s_addr  = htonl(INADDR_LOOPBACK);
+  addr.sin_port         = htons((uint16_t)port);
+
+  if (bind(server_fd_, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(server_fd_, 1) != 0 ||
+      getsockname(server_fd_, (struct sockaddr *)&addr, &addr_length) != 0)
+  {
+    closeServer();
+    return 0;
+  }
+
+  server_baudrate_ = baudrate;
+  if (startServer() == false)
+    return 0;
+  return ntohs(addr.sin_port);
+}
+
+bool SimulatedBus::startServer()
+{
+  server_running_ = true;
+  if (pthread_create(&server_thread_, 0, serverThread, this) != 0)
+  {
+    server_running_ = false;
+    closeServer();
+    return false;
+  }
+  return true;
+}
+
+void SimulatedBus::closeServer()
+{
+  if (server_running_)
+  {
+    __atomic_store_n(&server_running_, false, __ATOMIC_RELEASE);
+    pthread_join(server_thread_, 0);
+  }
+  if (pty_slave_fd_ != -1)
+    close(pty_slave_fd_);
+  if (server_fd_ != -1)
+    close(server_fd_);
+  pty_slave_fd_ = -1;
+  server_fd_ = -1;
+}
+
+void *SimulatedBus::serverThread(void *bus)
+{
+  ((SimulatedBus *)bus)->serve();
+  return 0;
+}
+
+int SimulatedBus::getPtyBaudRate()
+{
+  struct termios2 tio;
+
+  // the master reports the settings of the slave
+  if (ioctl(server_fd_, TCGETS2, &tio) != 0)
+    return 0;
+  return (int)tio.c_ospeed;
+}
+
+void SimulatedBus::serve()
+{
+  uint8_t  *packet    = (uint8_t *)malloc(SIM_PACKET_MAX_LEN);
+  uint8_t  *response  = (uint8_t *)malloc(SIM_RESPONSE_MAX_LEN);
+  int64_t  *arrival   = (int64_t *)malloc(SIM_RESPONSE_MAX_LEN * sizeof(int64_t));
+  int       head = 0, tail = 0;
+  int       pending = 0;  // bytes of an instruction packet which the next read completes
+  int64_t   byte_ns = 0;  // of the last transfer, as byte_ns_ is changed by the other users of the bus
+
+  // the pseudo-terminal is served as it is, and the TCP connection is accepted below
+  bool  is_tcp  = (server_baudrate_ > 0);
+  int   fd      = is_tcp ? -1 : server_fd_;
+
+  while (__atomic_load_n(&server_running_, __ATOMIC_ACQUIRE))
+  {
+    struct timespec tv, ts;
+    struct pollfd   pfd;
+
+    clock_gettime(CLOCK_MONOTONIC, &tv);
+    int64_t now = (int64_t)tv.tv_sec * 1000000000LL + tv.tv_nsec;
+
+    // write the burst of status bytes when its last byte arrives
+    int64_t timeout = 10000000LL;
+    if (head < tail)
+    {
+      int last = head;
+      while (last + 1 < tail && arrival[last + 1] - arrival[last] <= 2 * byte_ns)
+        last++;
+
+      if (arrival[last] <= now)
+      {
+        int written = write(fd, &response[head], last + 1 - head);
+        if (written > 0)
+          head += written;
+        if (head == tail)
+          head = tail = 0;
+        continue;
+      }
+      if (arrival[last] - now < timeout)
+        timeout = arrival[last] - now;
+    }
+
+    pfd.fd      = (fd == -1) ? server_fd_ : fd;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+    ts.tv_sec   = (time_t)(timeout / 1000000000LL);
+    ts.tv_nsec  = (long)(timeout % 1000000000LL);
+    if (ppoll(&pfd, 1, &ts, NULL) <= 0 || (pfd.revents & (POLLIN | POLLHUP)) == 0)
+      continue;
+
+    if (fd == -1)
+    {
+      int nodelay = 1;
+      fd = accept(server_fd_, 0, 0);
+      if (fd != -1)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+      continue;
+    }
+
+    int length = read(fd, &packet[pending], SIM_PACKET_MAX_LEN - pending);
+    if (length <= 0)
+    {
+      // the gateway waits for the next connection
+      if (is_tcp && (length == 0 || errno != EAGAIN))
+      {
+        close(fd);
+        fd = -1;
+        head = tail = pending = 0;
+      }
+      continue;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &tv);
+    now = (int64_t)tv.tv_sec * 1000000000LL + tv.tv_nsec;
+    length += pending;
+    int taken    = 0;
+    int baudrate = is_tcp ? server_baudrate_ : getPtyBaudRate();
+    byte_ns = (baudrate > 0) ? 10000000000LL / baudrate : 0;
+    tail += transfer(packet, length, baudrate, now,
+                     &response[tail], &arrival[tail], SIM_RESPONSE_MAX_LEN - tail, &taken);
+
+    // the instruction packet may be split into reads as the bytes come
+    pending = length - taken;
+    if (pending == SIM_PACKET_MAX_LEN)
+      pending = 0;
+    memmove(packet, &packet[taken], pending);
+  }
+
+  if (is_tcp && fd != -1)
+    close(fd);
+
+  free(packet);
+  free(response);
+  free(arrival);
+}
+
+#endif
+
+#endif
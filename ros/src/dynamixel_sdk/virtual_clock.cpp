@@ -0,0 +1,50 @@
+/*******************************************************************************
+* Copyright 2017 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include "virtual_clock.h"
+
+using namespace dynamixel;
+
+VirtualClock::VirtualClock(int64_t start_ns)
+  : now_ns_(start_ns)
+{
+}
+
+int64_t VirtualClock::getMonotonicNs()
+{
+  return __atomic_load_n(&now_ns_, __ATOMIC_ACQUIRE);
+}
+
+void VirtualClock::sleepUntil(int64_t time_ns)
+{
+  // the threads sharing the clock move it to the latest of their times
+  int64_t now = __atomic_load_n(&now_ns_, __ATOMIC_ACQUIRE);
+  while (now < time_ns)
+  {
+    if (__atomic_compare_exchange_n(&now_ns_, &now, time_ns, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      break;
+  }
+}
+
+void VirtualClock::advance(int64_t nsec)
+{
+  if (nsec > 0)
+    __atomic_add_fetch(&now_ns_, nsec, __ATOMIC_ACQ_REL);
+}
+
+#endif